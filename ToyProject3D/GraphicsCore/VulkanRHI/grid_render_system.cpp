@@ -1,4 +1,6 @@
 #include "grid_render_system.hpp"
+#include "lve_command_stats.hpp"
+#include "lve_profiler.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -35,7 +37,7 @@ void GridRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetlayou
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(GridPushConstants);
 
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetlayout };
+  const std::array<VkDescriptorSetLayout, 1> descriptorSetLayouts{ globalSetlayout };
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -65,11 +67,14 @@ void GridRenderSystem::createPipeline(VkRenderPass renderPass) {
 
 void GridRenderSystem::renderGrid(
 	FrameInfo& frameInfo,
-	LveGameObject& gridObject)
+	LveGameObject& gridObject,
+	LveModel& gridModel)
 {
+  LVE_PROFILE_FUNCTION();
+  assert(frameInfo.globalDescriptorSet != VK_NULL_HANDLE && "Frame info needs a descriptor set");
   lvePipeline->bind(frameInfo.commandBuffer);
 
-  vkCmdBindDescriptorSets(
+  cmd::bindDescriptorSets(
 	  frameInfo.commandBuffer,
 	  VK_PIPELINE_BIND_POINT_GRAPHICS,
 	  pipelineLayout,
@@ -82,7 +87,7 @@ void GridRenderSystem::renderGrid(
   GridPushConstants push{};
   push.modelMatrix = gridObject.transform.mat4();
 
-  vkCmdPushConstants(
+  cmd::pushConstants(
 	  frameInfo.commandBuffer,
 	  pipelineLayout,
 	  VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
@@ -90,8 +95,8 @@ void GridRenderSystem::renderGrid(
 	  sizeof(GridPushConstants),
 	  &push);
 
-  gridObject.model->bind(frameInfo.commandBuffer);
-  gridObject.model->draw(frameInfo.commandBuffer);
+  gridModel.bind(frameInfo.commandBuffer);
+  gridModel.draw(frameInfo.commandBuffer);
 }
 
 }  // namespace lve
@@ -21,7 +21,8 @@ class GridRenderSystem {
 
   void renderGrid(
 	  FrameInfo& frameInfo,
-	  LveGameObject& gridObject);
+	  LveGameObject& gridObject,
+	  LveModel& gridModel);
 
  private:
   void createPipelineLayout(VkDescriptorSetLayout globalSetlayout);
@@ -0,0 +1,94 @@
+#include "lve_allocation_counter.hpp"
+
+#ifdef LVE_TRACK_ALLOCATIONS
+
+// std
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// constant initialized, allocations before main are counted too
+std::atomic<uint64_t> allocationCount{0};
+
+void *countedAllocate(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void *countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+  return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+  // aligned_alloc wants a multiple of the alignment
+  return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+}
+
+void freeAligned(void *pointer) {
+#ifdef _WIN32
+  _aligned_free(pointer);
+#else
+  std::free(pointer);
+#endif
+}
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+  if (void *pointer = countedAllocate(size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return countedAllocate(size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return countedAllocate(size);
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  if (void *pointer = countedAllocateAligned(size, alignment)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+// the nothrow deletes forward to these by default
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  freeAligned(pointer);
+}
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+  freeAligned(pointer);
+}
+
+namespace lve {
+
+uint64_t LveAllocationCounter::getCount() {
+  return allocationCount.load(std::memory_order_relaxed);
+}
+
+}  // namespace lve
+
+#else
+
+namespace lve {
+
+uint64_t LveAllocationCounter::getCount() { return 0; }
+
+}  // namespace lve
+
+#endif
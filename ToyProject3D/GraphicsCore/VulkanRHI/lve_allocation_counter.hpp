@@ -0,0 +1,29 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Counts calls of the global operator new on all threads. FirstApp::run uses it to check that the
+// steady frame loop never goes to the heap: temporaries come from the frame arenas, containers
+// that live across frames are reserved up front, and a run with a frame limit fails if anything
+// was allocated after its warmup frames. malloc calls of C libraries (GLFW, the Vulkan loader and
+// driver) are not seen.
+//
+// Counting compiles in with LVE_TRACK_ALLOCATIONS, which makes lve_allocation_counter.cpp replace
+// the global allocation functions with counting ones over malloc. Without it enabled is false and
+// getCount() stays 0.
+class LveAllocationCounter {
+ public:
+#ifdef LVE_TRACK_ALLOCATIONS
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  // allocations since the program started
+  static uint64_t getCount();
+};
+
+}  // namespace lve
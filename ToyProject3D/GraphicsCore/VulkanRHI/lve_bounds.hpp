@@ -0,0 +1,104 @@
+#pragma once
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+
+namespace lve {
+
+// axis aligned bounding box, empty when min > max on any axis
+struct LveAabb {
+  glm::vec3 min{0.f};
+  glm::vec3 max{0.f};
+
+  glm::vec3 center() const { return 0.5f * (min + max); }
+  glm::vec3 extent() const { return 0.5f * (max - min); }
+
+  // half the surface area, the probability measure of the surface area heuristic
+  float halfArea() const {
+    const glm::vec3 size = max - min;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+  }
+
+  bool contains(const LveAabb &other) const {
+    return glm::all(glm::lessThanEqual(min, other.min)) &&
+           glm::all(glm::greaterThanEqual(max, other.max));
+  }
+  bool overlaps(const LveAabb &other) const {
+    return glm::all(glm::lessThanEqual(min, other.max)) &&
+           glm::all(glm::greaterThanEqual(max, other.min));
+  }
+
+  // squared distance from point to the box, 0 inside
+  float distanceSquared(const glm::vec3 &point) const {
+    const glm::vec3 outside = glm::max(glm::max(min - point, point - max), glm::vec3{0.f});
+    return glm::dot(outside, outside);
+  }
+
+  // Entry distance of origin + t * direction into the box in [tMin, tMax], or a negative value
+  // if it misses. inverseDirection is 1 / direction, infinite components are fine.
+  float intersectRay(
+      const glm::vec3 &origin, const glm::vec3 &inverseDirection, float tMin, float tMax) const {
+    const glm::vec3 t0 = (min - origin) * inverseDirection;
+    const glm::vec3 t1 = (max - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar = glm::max(t0, t1);
+    const float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, tMin));
+    const float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+    return enter <= exit ? enter : -1.f;
+  }
+
+  static LveAabb merge(const LveAabb &a, const LveAabb &b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+  }
+
+  // bounds of the box after transform, tight for the box's corners (Arvo, Graphics Gems 1990)
+  LveAabb transformed(const glm::mat4 &transform) const {
+    const glm::vec3 transformedCenter = glm::vec3{transform * glm::vec4{center(), 1.f}};
+    const glm::mat3 absolute{
+        glm::abs(glm::vec3{transform[0]}),
+        glm::abs(glm::vec3{transform[1]}),
+        glm::abs(glm::vec3{transform[2]})};
+    const glm::vec3 transformedExtent = absolute * extent();
+    return {transformedCenter - transformedExtent, transformedCenter + transformedExtent};
+  }
+};
+
+// View frustum as six inward facing planes, dot(plane.xyz, p) + plane.w >= 0 inside.
+struct LveFrustum {
+  enum class Overlap { Outside, Intersects, Inside };
+
+  std::array<glm::vec4, 6> planes{};
+
+  // planes of projection * view for the engine's [0, 1] clip depth (Gribb and Hartmann 2001)
+  static LveFrustum fromViewProjection(const glm::mat4 &viewProjection) {
+    const glm::mat4 m = glm::transpose(viewProjection);  // columns are now clip space rows
+    LveFrustum frustum{};
+    frustum.planes = {m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]};
+    for (glm::vec4 &plane : frustum.planes) {
+      plane /= glm::length(glm::vec3{plane});
+    }
+    return frustum;
+  }
+
+  Overlap classify(const LveAabb &box) const {
+    const glm::vec3 center = box.center();
+    const glm::vec3 extent = box.extent();
+    Overlap result = Overlap::Inside;
+    for (const glm::vec4 &plane : planes) {
+      const float distance = glm::dot(glm::vec3{plane}, center) + plane.w;
+      const float radius = glm::dot(glm::abs(glm::vec3{plane}), extent);
+      if (distance < -radius) {
+        return Overlap::Outside;
+      }
+      if (distance < radius) {
+        result = Overlap::Intersects;
+      }
+    }
+    return result;
+  }
+};
+
+}  // namespace lve
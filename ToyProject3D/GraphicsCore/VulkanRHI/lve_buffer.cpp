@@ -48,8 +48,9 @@ namespace lve {
 
 	LveBuffer::~LveBuffer() {
 		unmap();
-		vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-		vkFreeMemory(lveDevice.device(), memory, nullptr);
+		// frames in flight may still read from this buffer
+		lveDevice.deletionQueue().destroyBuffer(buffer);
+		lveDevice.deletionQueue().freeMemory(memory);
 	}
 
 	/**
@@ -87,7 +88,7 @@ namespace lve {
 	 * @param offset (Optional) Byte offset from beginning of mapped region
 	 *
 	 */
-	void LveBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset) {
+	void LveBuffer::writeToBuffer(const void *data, VkDeviceSize size, VkDeviceSize offset) {
 		assert(mapped && "Cannot copy to unmapped buffer");
 
 		if (size == VK_WHOLE_SIZE) {
@@ -163,7 +164,7 @@ namespace lve {
 	 * @param index Used in offset calculation
 	 *
 	 */
-	void LveBuffer::writeToIndex(void *data, int index) {
+	void LveBuffer::writeToIndex(const void *data, int index) {
 		writeToBuffer(data, instanceSize, index * alignmentSize);
 	}
 
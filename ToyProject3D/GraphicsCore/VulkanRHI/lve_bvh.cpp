@@ -0,0 +1,390 @@
+#include "lve_bvh.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace lve {
+
+// SAH candidates per axis and split, 16 is close to a full sweep for a fraction of the cost
+constexpr int SAH_BINS = 16;
+
+std::vector<uint32_t> LveBvh::build(const std::vector<Item> &items) {
+  nodes.clear();
+  leafBounds.clear();
+  root = NULL_NODE;
+  freeList = NULL_NODE;
+  nodes.reserve(2 * items.size());
+  leafBounds.reserve(2 * items.size());
+
+  std::vector<uint32_t> proxies(items.size());
+  std::vector<BuildLeaf> leaves(items.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    const uint32_t leaf = allocateNode();
+    nodes[leaf].bounds = {items[i].bounds.min - margin, items[i].bounds.max + margin};
+    nodes[leaf].userData = items[i].userData;
+    nodes[leaf].height = 0;
+    leafBounds[leaf] = items[i].bounds;
+    proxies[i] = leaf;
+    leaves[i] = makeBuildLeaf(leaf);
+  }
+  proxyCount = items.size();
+
+  if (!leaves.empty()) {
+    root = buildRange(leaves.data(), leaves.size(), NULL_NODE);
+  }
+  return proxies;
+}
+
+void LveBvh::rebuild() {
+  std::vector<BuildLeaf> leaves;
+  leaves.reserve(proxyCount);
+  for (uint32_t node = 0; node < nodes.size(); node++) {
+    if (nodes[node].height == 0) {
+      leaves.push_back(makeBuildLeaf(node));
+    } else if (nodes[node].height > 0) {
+      freeNode(node);
+    }
+  }
+  root = leaves.empty() ? NULL_NODE : buildRange(leaves.data(), leaves.size(), NULL_NODE);
+}
+
+uint32_t LveBvh::createProxy(const LveAabb &bounds, uint32_t userData) {
+  const uint32_t leaf = allocateNode();
+  nodes[leaf].bounds = {bounds.min - margin, bounds.max + margin};
+  nodes[leaf].userData = userData;
+  nodes[leaf].height = 0;
+  leafBounds[leaf] = bounds;
+  insertLeaf(leaf);
+  proxyCount++;
+  return leaf;
+}
+
+void LveBvh::destroyProxy(uint32_t proxy) {
+  assert(proxy < nodes.size() && nodes[proxy].height == 0 && "Invalid BVH proxy");
+  removeLeaf(proxy);
+  freeNode(proxy);
+  proxyCount--;
+}
+
+bool LveBvh::moveProxy(uint32_t proxy, const LveAabb &bounds) {
+  assert(proxy < nodes.size() && nodes[proxy].height == 0 && "Invalid BVH proxy");
+  leafBounds[proxy] = bounds;
+  if (nodes[proxy].bounds.contains(bounds)) {
+    return false;
+  }
+
+  const LveAabb enlarged{bounds.min - margin, bounds.max + margin};
+  if (!enlarged.overlaps(nodes[proxy].bounds)) {
+    // moved somewhere else entirely, refitting would stretch every ancestor across the gap
+    removeLeaf(proxy);
+    nodes[proxy].bounds = enlarged;
+    insertLeaf(proxy);
+    return true;
+  }
+  nodes[proxy].bounds = enlarged;
+  refitAncestors(nodes[proxy].parent);
+  return true;
+}
+
+float LveBvh::getSahCost() const {
+  if (root == NULL_NODE || nodes[root].isLeaf()) {
+    return 0.f;
+  }
+  float area = 0.f;
+  for (const Node &node : nodes) {
+    if (node.height > 0) {
+      area += node.bounds.halfArea();
+    }
+  }
+  return area / nodes[root].bounds.halfArea();
+}
+
+std::vector<std::pair<uint32_t, float>> LveBvh::queryNearest(
+    const glm::vec3 &point, size_t k) const {
+  using Entry = std::pair<float, uint32_t>;  // squared distance, node
+  std::vector<Entry> nearest;  // max-heap of the best k so far
+  if (root == NULL_NODE || k == 0) {
+    return {};
+  }
+  nearest.reserve(k + 1);
+
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  open.push({nodes[root].bounds.distanceSquared(point), root});
+  while (!open.empty()) {
+    const auto [distance, node] = open.top();
+    open.pop();
+    if (nearest.size() == k && distance >= nearest.front().first) {
+      break;
+    }
+    const Node &current = nodes[node];
+    if (current.isLeaf()) {
+      nearest.push_back({leafBounds[node].distanceSquared(point), node});
+      std::push_heap(nearest.begin(), nearest.end());
+      if (nearest.size() > k) {
+        std::pop_heap(nearest.begin(), nearest.end());
+        nearest.pop_back();
+      }
+      continue;
+    }
+    for (uint32_t child : current.children) {
+      const float childDistance = nodes[child].bounds.distanceSquared(point);
+      if (nearest.size() < k || childDistance < nearest.front().first) {
+        open.push({childDistance, child});
+      }
+    }
+  }
+
+  std::sort_heap(nearest.begin(), nearest.end());
+  std::vector<std::pair<uint32_t, float>> result;
+  result.reserve(nearest.size());
+  for (const auto &[distance, leaf] : nearest) {
+    result.push_back({nodes[leaf].userData, distance});
+  }
+  return result;
+}
+
+uint32_t LveBvh::allocateNode() {
+  if (freeList == NULL_NODE) {
+    nodes.emplace_back();
+    leafBounds.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+  }
+  const uint32_t node = freeList;
+  freeList = nodes[node].parent;
+  nodes[node] = Node{};
+  return node;
+}
+
+void LveBvh::freeNode(uint32_t node) {
+  nodes[node] = Node{};
+  nodes[node].parent = freeList;
+  freeList = node;
+}
+
+LveBvh::BuildLeaf LveBvh::makeBuildLeaf(uint32_t leaf) const {
+  return {nodes[leaf].bounds, nodes[leaf].bounds.center(), leaf};
+}
+
+uint32_t LveBvh::buildRange(BuildLeaf *leaves, size_t count, uint32_t parent) {
+  if (count == 1) {
+    nodes[leaves[0].node].parent = parent;
+    return leaves[0].node;
+  }
+
+  LveAabb centroidBounds{leaves[0].centroid, leaves[0].centroid};
+  for (size_t i = 1; i < count; i++) {
+    centroidBounds.min = glm::min(centroidBounds.min, leaves[i].centroid);
+    centroidBounds.max = glm::max(centroidBounds.max, leaves[i].centroid);
+  }
+  const glm::vec3 centroidSize = centroidBounds.max - centroidBounds.min;
+  const glm::vec3 binScale{
+      centroidSize.x > 0.f ? SAH_BINS / centroidSize.x : 0.f,
+      centroidSize.y > 0.f ? SAH_BINS / centroidSize.y : 0.f,
+      centroidSize.z > 0.f ? SAH_BINS / centroidSize.z : 0.f};
+  auto binOf = [&](const BuildLeaf &leaf, int axis) {
+    const float offset = leaf.centroid[axis] - centroidBounds.min[axis];
+    return std::min(SAH_BINS - 1, static_cast<int>(offset * binScale[axis]));
+  };
+
+  // all three axes binned in one pass over the leaves
+  std::array<std::array<LveAabb, SAH_BINS>, 3> binBounds;
+  std::array<std::array<size_t, SAH_BINS>, 3> binCounts{};
+  for (size_t i = 0; i < count; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const int bin = binOf(leaves[i], axis);
+      LveAabb &bounds = binBounds[axis][bin];
+      bounds = binCounts[axis][bin] == 0 ? leaves[i].bounds
+                                         : LveAabb::merge(bounds, leaves[i].bounds);
+      binCounts[axis][bin]++;
+    }
+  }
+
+  // cost of a split is area * count on both sides, the constant node costs don't change the pick
+  float bestCost = std::numeric_limits<float>::max();
+  int bestAxis = -1;
+  int bestBin = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    if (centroidSize[axis] <= 0.f) {
+      continue;
+    }
+    const auto &bounds = binBounds[axis];
+    const auto &counts = binCounts[axis];
+
+    // right side costs of splitting after each bin, then a sweep from the left
+    std::array<float, SAH_BINS> rightCosts{};
+    LveAabb right{};
+    size_t rightCount = 0;
+    for (int bin = SAH_BINS - 1; bin > 0; bin--) {
+      if (counts[bin] > 0) {
+        right = rightCount == 0 ? bounds[bin] : LveAabb::merge(right, bounds[bin]);
+        rightCount += counts[bin];
+      }
+      rightCosts[bin - 1] = rightCount == 0 ? 0.f : right.halfArea() * rightCount;
+    }
+    LveAabb left{};
+    size_t leftCount = 0;
+    for (int bin = 0; bin < SAH_BINS - 1; bin++) {
+      if (counts[bin] > 0) {
+        left = leftCount == 0 ? bounds[bin] : LveAabb::merge(left, bounds[bin]);
+        leftCount += counts[bin];
+      }
+      if (leftCount == 0 || leftCount == count) {
+        continue;
+      }
+      const float cost = left.halfArea() * leftCount + rightCosts[bin];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestBin = bin;
+      }
+    }
+  }
+
+  size_t middle = count / 2;
+  if (bestAxis >= 0) {
+    BuildLeaf *split = std::partition(leaves, leaves + count, [&](const BuildLeaf &leaf) {
+      return binOf(leaf, bestAxis) <= bestBin;
+    });
+    middle = static_cast<size_t>(split - leaves);
+  }
+  // identical centroids give no split, halves keep the depth logarithmic then
+  if (middle == 0 || middle == count) {
+    middle = count / 2;
+  }
+
+  const uint32_t node = allocateNode();
+  const uint32_t first = buildRange(leaves, middle, node);
+  const uint32_t second = buildRange(leaves + middle, count - middle, node);
+  nodes[node].parent = parent;
+  nodes[node].children[0] = first;
+  nodes[node].children[1] = second;
+  updateNode(node);
+  return node;
+}
+
+void LveBvh::insertLeaf(uint32_t leaf) {
+  if (root == NULL_NODE) {
+    root = leaf;
+    nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // descend towards the sibling whose pairing with the leaf adds the least area, stopping where
+  // pairing with the current subtree is cheaper than going further (Box2D's b2DynamicTree)
+  const LveAabb bounds = nodes[leaf].bounds;
+  uint32_t sibling = root;
+  while (!nodes[sibling].isLeaf()) {
+    const Node &current = nodes[sibling];
+    const float combinedArea = LveAabb::merge(current.bounds, bounds).halfArea();
+    const float cost = 2.f * combinedArea;
+    // every node below gets at least this much larger
+    const float inheritedCost = 2.f * (combinedArea - current.bounds.halfArea());
+
+    float childCosts[2];
+    for (int i = 0; i < 2; i++) {
+      const Node &child = nodes[current.children[i]];
+      const float area = LveAabb::merge(child.bounds, bounds).halfArea();
+      childCosts[i] = (child.isLeaf() ? area : area - child.bounds.halfArea()) + inheritedCost;
+    }
+    if (cost < childCosts[0] && cost < childCosts[1]) {
+      break;
+    }
+    sibling = current.children[childCosts[0] < childCosts[1] ? 0 : 1];
+  }
+
+  const uint32_t oldParent = nodes[sibling].parent;
+  const uint32_t newParent = allocateNode();
+  nodes[newParent].parent = oldParent;
+  nodes[newParent].children[0] = sibling;
+  nodes[newParent].children[1] = leaf;
+  nodes[sibling].parent = newParent;
+  nodes[leaf].parent = newParent;
+  if (oldParent == NULL_NODE) {
+    root = newParent;
+  } else {
+    Node &parent = nodes[oldParent];
+    parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+  }
+  refitAncestors(newParent);
+}
+
+void LveBvh::removeLeaf(uint32_t leaf) {
+  if (leaf == root) {
+    root = NULL_NODE;
+    return;
+  }
+
+  const uint32_t parent = nodes[leaf].parent;
+  const uint32_t grandParent = nodes[parent].parent;
+  const uint32_t sibling = nodes[parent].children[nodes[parent].children[0] == leaf ? 1 : 0];
+  nodes[sibling].parent = grandParent;
+  freeNode(parent);
+  nodes[leaf].parent = NULL_NODE;
+  if (grandParent == NULL_NODE) {
+    root = sibling;
+    return;
+  }
+  Node &grand = nodes[grandParent];
+  grand.children[grand.children[0] == parent ? 0 : 1] = sibling;
+  refitAncestors(grandParent);
+}
+
+void LveBvh::refitAncestors(uint32_t node) {
+  while (node != NULL_NODE) {
+    rotate(node);
+    updateNode(node);
+    node = nodes[node].parent;
+  }
+}
+
+void LveBvh::rotate(uint32_t node) {
+  // Swapping one child of node with a grandchild under the other child keeps node's bounds but
+  // changes that other child's. Of the up to four swaps take the one shrinking it the most.
+  float bestGain = 0.f;
+  int bestChild = -1;  // child whose own child is swapped out
+  int bestGrandChild = -1;
+  for (int child = 0; child < 2; child++) {
+    const Node &target = nodes[nodes[node].children[child]];
+    if (target.isLeaf()) {
+      continue;
+    }
+    const LveAabb &moved = nodes[nodes[node].children[1 - child]].bounds;
+    for (int grandChild = 0; grandChild < 2; grandChild++) {
+      // moved takes grandChild's place next to the grandchild that stays
+      const LveAabb &kept = nodes[target.children[1 - grandChild]].bounds;
+      const float gain = target.bounds.halfArea() - LveAabb::merge(moved, kept).halfArea();
+      if (gain > bestGain) {
+        bestGain = gain;
+        bestChild = child;
+        bestGrandChild = grandChild;
+      }
+    }
+  }
+  if (bestChild < 0) {
+    return;
+  }
+
+  const uint32_t target = nodes[node].children[bestChild];
+  const uint32_t moved = nodes[node].children[1 - bestChild];
+  const uint32_t swapped = nodes[target].children[bestGrandChild];
+  nodes[node].children[1 - bestChild] = swapped;
+  nodes[swapped].parent = node;
+  nodes[target].children[bestGrandChild] = moved;
+  nodes[moved].parent = target;
+  updateNode(target);
+}
+
+void LveBvh::updateNode(uint32_t node) {
+  Node &current = nodes[node];
+  const Node &first = nodes[current.children[0]];
+  const Node &second = nodes[current.children[1]];
+  current.bounds = LveAabb::merge(first.bounds, second.bounds);
+  current.height = 1 + std::max(first.height, second.height);
+}
+
+}  // namespace lve
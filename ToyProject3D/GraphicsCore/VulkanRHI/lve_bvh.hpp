@@ -0,0 +1,187 @@
+#pragma once
+
+#include "lve_bounds.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+// Dynamic bounding volume hierarchy over axis aligned boxes, each leaf a proxy carrying a user
+// value such as an entity index.
+//
+// build and rebuild create the tree top-down with a binned surface area heuristic, for static
+// content or after many changes. createProxy inserts a single leaf next to its cheapest sibling,
+// moveProxy refits the leaf's ancestors and rotates subtrees along the way where that lowers the
+// surface area (Kopta et al., "Fast, Effective BVH Updates for Animated Scenes", 2012). Leaves
+// are stored enlarged by a margin, so small movements leave the tree untouched.
+//
+// Overlap, frustum and ray queries walk the tree without a stack through parent links and
+// callbacks receive the user value; they may run on several threads at once but not alongside
+// changes. Queries test leaves against their exact bounds, not the enlarged ones.
+class LveBvh {
+ public:
+  static constexpr uint32_t NULL_NODE = ~0u;
+
+  struct Item {
+    LveAabb bounds{};
+    uint32_t userData = 0;
+  };
+
+  explicit LveBvh(float margin = 0.1f) : margin{margin} {}
+
+  LveBvh(const LveBvh &) = delete;
+  LveBvh &operator=(const LveBvh &) = delete;
+
+  // replaces the tree with a SAH build over items, returns the proxy of each item in order
+  std::vector<uint32_t> build(const std::vector<Item> &items);
+  // SAH build over the current proxies, which keep their ids
+  void rebuild();
+
+  uint32_t createProxy(const LveAabb &bounds, uint32_t userData);
+  void destroyProxy(uint32_t proxy);
+  // true if the tree had to change, false if bounds still fit the proxy's enlarged bounds
+  bool moveProxy(uint32_t proxy, const LveAabb &bounds);
+
+  uint32_t getUserData(uint32_t proxy) const { return nodes[proxy].userData; }
+  const LveAabb &getBounds(uint32_t proxy) const { return leafBounds[proxy]; }
+  size_t size() const { return proxyCount; }
+  // longest path from the root to a leaf, counted in edges
+  int getHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+  // sum of internal node surface areas relative to the root's, lower traverses faster
+  float getSahCost() const;
+
+  // calls function(userData) for every proxy whose bounds overlap box
+  template <typename Function>
+  void queryOverlap(const LveAabb &box, Function &&function) const {
+    traverse(
+        [&box](const LveAabb &bounds) {
+          return box.overlaps(bounds) ? LveFrustum::Overlap::Intersects
+                                      : LveFrustum::Overlap::Outside;
+        },
+        [&](uint32_t leaf, bool) {
+          if (box.overlaps(leafBounds[leaf])) {
+            function(nodes[leaf].userData);
+          }
+        });
+  }
+
+  // calls function(userData) for every proxy at least partly inside frustum, subtrees entirely
+  // inside are reported without further tests
+  template <typename Function>
+  void queryFrustum(const LveFrustum &frustum, Function &&function) const {
+    traverse(
+        [&frustum](const LveAabb &bounds) { return frustum.classify(bounds); },
+        [&](uint32_t leaf, bool inside) {
+          if (inside || frustum.classify(leafBounds[leaf]) != LveFrustum::Overlap::Outside) {
+            function(nodes[leaf].userData);
+          }
+        });
+  }
+
+  // Calls function(userData, t) for proxies hit by origin + t * direction with t in [0, tMax]
+  // in no particular order. function returns the new tMax, e.g. t after an exact hit to only
+  // look for closer ones, or the old one to see every hit.
+  template <typename Function>
+  void queryRay(
+      const glm::vec3 &origin, const glm::vec3 &direction, float tMax, Function &&function) const {
+    const glm::vec3 inverseDirection = 1.f / direction;
+    traverse(
+        [&](const LveAabb &bounds) {
+          return bounds.intersectRay(origin, inverseDirection, 0.f, tMax) >= 0.f
+                     ? LveFrustum::Overlap::Intersects
+                     : LveFrustum::Overlap::Outside;
+        },
+        [&](uint32_t leaf, bool) {
+          const float t = leafBounds[leaf].intersectRay(origin, inverseDirection, 0.f, tMax);
+          if (t >= 0.f) {
+            tMax = function(nodes[leaf].userData, t);
+          }
+        });
+  }
+
+  // The k proxies with bounds nearest to point, closest first, as (userData, squared
+  // distance). Best-first, so this one keeps a queue of nodes to visit.
+  std::vector<std::pair<uint32_t, float>> queryNearest(const glm::vec3 &point, size_t k) const;
+
+ private:
+  struct Node {
+    LveAabb bounds{};  // enlarged by margin for leaves
+    uint32_t parent = NULL_NODE;  // next free node while unused
+    uint32_t children[2] = {NULL_NODE, NULL_NODE};
+    uint32_t userData = 0;
+    int32_t height = -1;  // 0 for leaves, -1 while unused
+
+    bool isLeaf() const { return children[0] == NULL_NODE; }
+  };
+
+  // Depth-first walk without a stack: a node is entered from its parent, then left towards its
+  // second child after returning from the first, and towards its parent after the second.
+  // classify decides whether to descend, leaf(node, inside) sees the leaves of entered nodes.
+  template <typename Classify, typename Leaf>
+  void traverse(Classify &&classify, Leaf &&leaf) const {
+    uint32_t node = root;
+    uint32_t previous = NULL_NODE;
+    uint32_t insideRoot = NULL_NODE;  // subtree classified Inside, skipped tests below it
+    while (node != NULL_NODE) {
+      const Node &current = nodes[node];
+      uint32_t next;
+      if (previous == current.parent) {
+        if (current.isLeaf()) {
+          leaf(node, insideRoot != NULL_NODE);
+          next = current.parent;
+        } else {
+          LveFrustum::Overlap overlap = LveFrustum::Overlap::Inside;
+          if (insideRoot == NULL_NODE) {
+            overlap = classify(current.bounds);
+            if (overlap == LveFrustum::Overlap::Inside) {
+              insideRoot = node;
+            }
+          }
+          next = overlap == LveFrustum::Overlap::Outside ? current.parent : current.children[0];
+        }
+      } else if (previous == current.children[0]) {
+        next = current.children[1];
+      } else {
+        next = current.parent;
+      }
+      if (next == current.parent && node == insideRoot) {
+        insideRoot = NULL_NODE;
+      }
+      previous = node;
+      node = next;
+    }
+  }
+
+  // leaf copy a build sorts, contiguous so the binning passes don't chase node indices
+  struct BuildLeaf {
+    LveAabb bounds{};
+    glm::vec3 centroid{};
+    uint32_t node = NULL_NODE;
+  };
+
+  uint32_t allocateNode();
+  void freeNode(uint32_t node);
+  BuildLeaf makeBuildLeaf(uint32_t leaf) const;
+  uint32_t buildRange(BuildLeaf *leaves, size_t count, uint32_t parent);
+  void insertLeaf(uint32_t leaf);
+  void removeLeaf(uint32_t leaf);
+  // refits bounds and heights from node up to the root, rotating where it helps
+  void refitAncestors(uint32_t node);
+  void rotate(uint32_t node);
+  void updateNode(uint32_t node);
+
+  float margin;
+  std::vector<Node> nodes;
+  std::vector<LveAabb> leafBounds;  // exact bounds by node, only meaningful for leaves
+  uint32_t root = NULL_NODE;
+  uint32_t freeList = NULL_NODE;
+  size_t proxyCount = 0;
+};
+
+}  // namespace lve
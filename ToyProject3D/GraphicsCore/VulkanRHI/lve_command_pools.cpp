@@ -0,0 +1,84 @@
+#include "lve_command_pools.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveCommandPools::LveCommandPools(LveDevice &device, int framesInFlight, int threadCount)
+    : lveDevice{device}, threadCount{threadCount} {
+  assert(threadCount > 0 && "Command pools need at least one thread");
+  pools.resize(static_cast<size_t>(framesInFlight) * threadCount);
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  for (auto &threadPool : pools) {
+    if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &threadPool.pool) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create frame command pool!");
+    }
+  }
+}
+
+LveCommandPools::~LveCommandPools() {
+  // destroying a pool frees its command buffers
+  for (auto &threadPool : pools) {
+    vkDestroyCommandPool(lveDevice.device(), threadPool.pool, nullptr);
+  }
+}
+
+void LveCommandPools::beginFrame(int frameIndex) {
+  currentFrameIndex = frameIndex;
+  for (uint32_t threadIndex = 0; threadIndex < static_cast<uint32_t>(threadCount); threadIndex++) {
+    ThreadPool &pool = threadPool(frameIndex, threadIndex);
+    if (pool.primaries.used == 0 && pool.secondaries.used == 0) {
+      continue;
+    }
+    if (vkResetCommandPool(lveDevice.device(), pool.pool, 0) != VK_SUCCESS) {
+      throw std::runtime_error("failed to reset frame command pool!");
+    }
+    pool.primaries.used = 0;
+    pool.secondaries.used = 0;
+  }
+}
+
+VkCommandBuffer LveCommandPools::allocatePrimary(uint32_t threadIndex) {
+  assert(threadIndex < static_cast<uint32_t>(threadCount) && "Thread index out of range");
+  ThreadPool &pool = threadPool(currentFrameIndex, threadIndex);
+  return allocate(pool.pool, pool.primaries, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+VkCommandBuffer LveCommandPools::allocateSecondary(uint32_t threadIndex) {
+  assert(threadIndex < static_cast<uint32_t>(threadCount) && "Thread index out of range");
+  ThreadPool &pool = threadPool(currentFrameIndex, threadIndex);
+  return allocate(pool.pool, pool.secondaries, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+}
+
+void LveCommandPools::reserveSecondaries(size_t count) {
+  for (auto &pool : pools) {
+    pool.secondaries.buffers.reserve(count);
+  }
+}
+
+VkCommandBuffer LveCommandPools::allocate(
+    VkCommandPool pool, CommandBufferList &list, VkCommandBufferLevel level) {
+  if (list.used == list.buffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = level;
+    allocInfo.commandPool = pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate command buffers!");
+    }
+    list.buffers.push_back(commandBuffer);
+  }
+  return list.buffers[list.used++];
+}
+
+}  // namespace lve
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Command buffers for recording frames, possibly on several threads. Every (frame in flight,
+// thread) pair owns a transient pool, so threads never share a pool and a frame slot's pools can
+// be reset as a whole with vkResetCommandPool once the frame has completed. Buffers are never
+// freed individually: the reset puts every buffer of the pool back on its free list.
+class LveCommandPools {
+ public:
+  LveCommandPools(LveDevice &device, int framesInFlight, int threadCount);
+  ~LveCommandPools();
+
+  LveCommandPools(const LveCommandPools &) = delete;
+  LveCommandPools &operator=(const LveCommandPools &) = delete;
+
+  // resets every pool of the frame slot, the slot's previous frame must have completed
+  void beginFrame(int frameIndex);
+
+  // Command buffers of the current frame from the pool of threadIndex. Only the thread owning
+  // threadIndex may allocate, record and end buffers of that pool during the frame.
+  VkCommandBuffer allocatePrimary(uint32_t threadIndex);
+  VkCommandBuffer allocateSecondary(uint32_t threadIndex);
+  // sizes the lists of every pool up front, the buffers themselves are still allocated on demand
+  void reserveSecondaries(size_t count);
+
+  int getThreadCount() const { return threadCount; }
+
+ private:
+  // buffers [0, used) were handed out this frame, the rest are free
+  struct CommandBufferList {
+    std::vector<VkCommandBuffer> buffers;
+    size_t used = 0;
+  };
+
+  struct ThreadPool {
+    VkCommandPool pool = VK_NULL_HANDLE;
+    CommandBufferList primaries;
+    CommandBufferList secondaries;
+  };
+
+  ThreadPool &threadPool(int frameIndex, uint32_t threadIndex) {
+    return pools[frameIndex * threadCount + threadIndex];
+  }
+  VkCommandBuffer allocate(
+      VkCommandPool pool, CommandBufferList &list, VkCommandBufferLevel level);
+
+  LveDevice &lveDevice;
+  int threadCount;
+  int currentFrameIndex = 0;
+  std::vector<ThreadPool> pools;  // framesInFlight * threadCount, grouped by frame
+};
+
+}  // namespace lve
@@ -0,0 +1,313 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+// Commands recorded through the lve::cmd wrappers below. Counting only happens in builds with
+// LVE_ENABLE_COMMAND_STATS, otherwise the wrappers are plain forwarding inlines and every
+// counter stays zero.
+struct LveCommandStats {
+  uint32_t draws = 0;              // vkCmdDraw, vkCmdDrawIndexed and vkCmdDrawIndexedIndirect
+  uint32_t indexedDraws = 0;
+  uint32_t indirectDraws = 0;      // commands read by vkCmdDrawIndexedIndirect, not counted above
+  uint64_t indexedPrimitives = 0;  // triangles, indexed draws always use triangle lists
+  uint32_t pipelineBinds = 0;
+  uint32_t descriptorSetBinds = 0;  // sets, a call binding two sets counts twice
+  uint64_t pushConstantBytes = 0;
+  uint32_t vertexBufferBinds = 0;
+  uint32_t indexBufferBinds = 0;
+  uint32_t barriers = 0;  // memory, buffer and image barriers of vkCmdPipelineBarrier
+  uint32_t renderPasses = 0;
+
+  LveCommandStats &operator+=(const LveCommandStats &other) {
+    draws += other.draws;
+    indexedDraws += other.indexedDraws;
+    indirectDraws += other.indirectDraws;
+    indexedPrimitives += other.indexedPrimitives;
+    pipelineBinds += other.pipelineBinds;
+    descriptorSetBinds += other.descriptorSetBinds;
+    pushConstantBytes += other.pushConstantBytes;
+    vertexBufferBinds += other.vertexBufferBinds;
+    indexBufferBinds += other.indexBufferBinds;
+    barriers += other.barriers;
+    renderPasses += other.renderPasses;
+    return *this;
+  }
+};
+
+// Per frame totals plus a breakdown by named scope (usually one per render system). The
+// collector bound to the recording thread receives the counts of the lve::cmd wrappers.
+class LveCommandStatsCollector {
+ public:
+#ifdef LVE_ENABLE_COMMAND_STATS
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  using ScopeStats = std::pair<const char *, LveCommandStats>;
+
+  // clears the counters and binds this collector to the calling thread
+  void beginFrame() {
+    if constexpr (enabled) {
+      reset();
+      threadCollector() = this;
+    }
+  }
+
+  void reset() {
+    frameStats = {};
+    scopeStats.clear();
+    activeScope = NO_SCOPE;
+  }
+
+  // room for scopeCount different scopes, a collector that stays within them never allocates
+  void reserveScopes(size_t scopeCount) {
+    if constexpr (enabled) {
+      scopeStats.reserve(scopeCount);
+    }
+  }
+
+  // adds the counts of a collector that recorded part of the frame on another thread
+  void merge(const LveCommandStatsCollector &other) {
+    if constexpr (enabled) {
+      frameStats += other.frameStats;
+      for (const auto &[name, stats] : other.scopeStats) {
+        const size_t previous = beginScope(name);
+        scopeStats[activeScope].second += stats;
+        endScope(previous);
+      }
+    }
+  }
+
+  // returns the previous scope, to be handed back to endScope
+  size_t beginScope(const char *name) {
+    if constexpr (enabled) {
+      const size_t previous = activeScope;
+      activeScope = scopeStats.size();
+      for (size_t i = 0; i < scopeStats.size(); i++) {
+        if (std::strcmp(scopeStats[i].first, name) == 0) {
+          activeScope = i;
+          break;
+        }
+      }
+      if (activeScope == scopeStats.size()) {
+        scopeStats.push_back({name, {}});
+      }
+      return previous;
+    }
+    return NO_SCOPE;
+  }
+  void endScope(size_t previousScope) { activeScope = previousScope; }
+
+  template <typename Counter>
+  void count(Counter &&counter) {
+    counter(frameStats);
+    if (activeScope != NO_SCOPE) {
+      counter(scopeStats[activeScope].second);
+    }
+  }
+
+  const LveCommandStats &getFrameStats() const { return frameStats; }
+  const std::vector<ScopeStats> &getScopeStats() const { return scopeStats; }
+
+  static LveCommandStatsCollector *&threadCollector() {
+    thread_local LveCommandStatsCollector *collector = nullptr;
+    return collector;
+  }
+
+ private:
+  static constexpr size_t NO_SCOPE = SIZE_MAX;
+
+  LveCommandStats frameStats{};
+  std::vector<ScopeStats> scopeStats;
+  size_t activeScope = NO_SCOPE;
+};
+
+class LveCommandStatsScope {
+ public:
+  LveCommandStatsScope(LveCommandStatsCollector &collector, const char *name)
+      : collector{collector}, previousScope{collector.beginScope(name)} {}
+  ~LveCommandStatsScope() { collector.endScope(previousScope); }
+
+  LveCommandStatsScope(const LveCommandStatsScope &) = delete;
+  LveCommandStatsScope &operator=(const LveCommandStatsScope &) = delete;
+
+ private:
+  LveCommandStatsCollector &collector;
+  size_t previousScope;
+};
+
+// Binds a collector to the calling thread for the lifetime of the object, for jobs recording
+// secondary command buffers. Restores the previous binding, the main thread runs jobs too.
+class LveCommandStatsBinding {
+ public:
+  explicit LveCommandStatsBinding(LveCommandStatsCollector &collector)
+      : previous{LveCommandStatsCollector::threadCollector()} {
+    LveCommandStatsCollector::threadCollector() = &collector;
+  }
+  ~LveCommandStatsBinding() { LveCommandStatsCollector::threadCollector() = previous; }
+
+  LveCommandStatsBinding(const LveCommandStatsBinding &) = delete;
+  LveCommandStatsBinding &operator=(const LveCommandStatsBinding &) = delete;
+
+ private:
+  LveCommandStatsCollector *previous;
+};
+
+// Counting wrappers for the per-frame vkCmd* calls.
+namespace cmd {
+
+template <typename Counter>
+inline void countCommand(Counter &&counter) {
+  if constexpr (LveCommandStatsCollector::enabled) {
+    if (auto *collector = LveCommandStatsCollector::threadCollector()) {
+      collector->count(counter);
+    }
+  }
+}
+
+inline void draw(
+    VkCommandBuffer commandBuffer,
+    uint32_t vertexCount,
+    uint32_t instanceCount,
+    uint32_t firstVertex,
+    uint32_t firstInstance) {
+  countCommand([](LveCommandStats &stats) { stats.draws++; });
+  vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+inline void drawIndexed(
+    VkCommandBuffer commandBuffer,
+    uint32_t indexCount,
+    uint32_t instanceCount,
+    uint32_t firstIndex,
+    int32_t vertexOffset,
+    uint32_t firstInstance) {
+  countCommand([&](LveCommandStats &stats) {
+    stats.draws++;
+    stats.indexedDraws++;
+    stats.indexedPrimitives += uint64_t{indexCount} / 3 * instanceCount;
+  });
+  vkCmdDrawIndexed(
+      commandBuffer,
+      indexCount,
+      instanceCount,
+      firstIndex,
+      vertexOffset,
+      firstInstance);
+}
+
+// the primitives are in the buffer, so they are not added to indexedPrimitives
+inline void drawIndexedIndirect(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    uint32_t drawCount,
+    uint32_t stride) {
+  countCommand([&](LveCommandStats &stats) {
+    stats.draws++;
+    stats.indirectDraws += drawCount;
+  });
+  vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+inline void bindPipeline(
+    VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+  countCommand([](LveCommandStats &stats) { stats.pipelineBinds++; });
+  vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+}
+
+inline void bindDescriptorSets(
+    VkCommandBuffer commandBuffer,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout layout,
+    uint32_t firstSet,
+    uint32_t setCount,
+    const VkDescriptorSet *descriptorSets,
+    uint32_t dynamicOffsetCount,
+    const uint32_t *dynamicOffsets) {
+  countCommand([&](LveCommandStats &stats) { stats.descriptorSetBinds += setCount; });
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      bindPoint,
+      layout,
+      firstSet,
+      setCount,
+      descriptorSets,
+      dynamicOffsetCount,
+      dynamicOffsets);
+}
+
+inline void pushConstants(
+    VkCommandBuffer commandBuffer,
+    VkPipelineLayout layout,
+    VkShaderStageFlags stageFlags,
+    uint32_t offset,
+    uint32_t size,
+    const void *values) {
+  countCommand([&](LveCommandStats &stats) { stats.pushConstantBytes += size; });
+  vkCmdPushConstants(commandBuffer, layout, stageFlags, offset, size, values);
+}
+
+inline void bindVertexBuffers(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstBinding,
+    uint32_t bindingCount,
+    const VkBuffer *buffers,
+    const VkDeviceSize *offsets) {
+  countCommand([&](LveCommandStats &stats) { stats.vertexBufferBinds += bindingCount; });
+  vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, buffers, offsets);
+}
+
+inline void bindIndexBuffer(
+    VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+  countCommand([](LveCommandStats &stats) { stats.indexBufferBinds++; });
+  vkCmdBindIndexBuffer(commandBuffer, buffer, offset, indexType);
+}
+
+inline void pipelineBarrier(
+    VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStageMask,
+    VkPipelineStageFlags dstStageMask,
+    VkDependencyFlags dependencyFlags,
+    uint32_t memoryBarrierCount,
+    const VkMemoryBarrier *memoryBarriers,
+    uint32_t bufferMemoryBarrierCount,
+    const VkBufferMemoryBarrier *bufferMemoryBarriers,
+    uint32_t imageMemoryBarrierCount,
+    const VkImageMemoryBarrier *imageMemoryBarriers) {
+  countCommand([&](LveCommandStats &stats) {
+    stats.barriers += memoryBarrierCount + bufferMemoryBarrierCount + imageMemoryBarrierCount;
+  });
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      srcStageMask,
+      dstStageMask,
+      dependencyFlags,
+      memoryBarrierCount,
+      memoryBarriers,
+      bufferMemoryBarrierCount,
+      bufferMemoryBarriers,
+      imageMemoryBarrierCount,
+      imageMemoryBarriers);
+}
+
+inline void beginRenderPass(
+    VkCommandBuffer commandBuffer,
+    const VkRenderPassBeginInfo *renderPassBegin,
+    VkSubpassContents contents) {
+  countCommand([](LveCommandStats &stats) { stats.renderPasses++; });
+  vkCmdBeginRenderPass(commandBuffer, renderPassBegin, contents);
+}
+
+}  // namespace cmd
+}  // namespace lve
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "lve_bvh.hpp"
+#include "lve_game_object.hpp"
+#include "lve_model.hpp"
+#include "lve_texture.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+namespace lve {
+
+// Scene components stored in LveEntityRegistry, each in its own packed array. TransformComponent
+// is shared with LveGameObject.
+
+// world matrices of the entity's TransformComponent combined with its ancestors' in the
+// LveSceneGraph, refreshed once per frame before culling
+struct WorldTransformComponent {
+  glm::mat4 modelMatrix{1.f};
+  glm::mat3 normalMatrix{1.f};
+};
+
+// object space bounds of the entity's model, and the proxy of its world bounds in the scene BVH
+struct BoundsComponent {
+  LveModel::BoundingBox local{};
+  uint32_t proxy = LveBvh::NULL_NODE;
+};
+
+// handles into the FirstApp resource pools, shared by every entity drawing the same model
+struct ModelComponent {
+  LveModelHandle model{};
+};
+
+struct TextureComponent {
+  LveTextureHandle texture{};
+};
+
+}  // namespace lve
@@ -0,0 +1,92 @@
+#include "lve_deletion_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+void LveDeletionQueue::setCurrentFrame(uint64_t frame) {
+  std::lock_guard<std::mutex> lock{mutex};
+  assert(frame >= currentFrame && "Frame numbers must be monotonically increasing");
+  currentFrame = frame;
+}
+
+void LveDeletionQueue::destroyBuffer(VkBuffer buffer) {
+  enqueue(VK_OBJECT_TYPE_BUFFER, (uint64_t)buffer);
+}
+
+void LveDeletionQueue::destroyImage(VkImage image) {
+  enqueue(VK_OBJECT_TYPE_IMAGE, (uint64_t)image);
+}
+
+void LveDeletionQueue::destroyImageView(VkImageView imageView) {
+  enqueue(VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t)imageView);
+}
+
+void LveDeletionQueue::destroySampler(VkSampler sampler) {
+  enqueue(VK_OBJECT_TYPE_SAMPLER, (uint64_t)sampler);
+}
+
+void LveDeletionQueue::freeMemory(VkDeviceMemory memory) {
+  enqueue(VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t)memory);
+}
+
+void LveDeletionQueue::enqueue(VkObjectType type, uint64_t handle) {
+  if (handle == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock{mutex};
+  pending.push_back({type, handle, currentFrame});
+}
+
+void LveDeletionQueue::flush(VkDevice device, uint64_t completedFrame) {
+  std::lock_guard<std::mutex> lock{mutex};
+  auto firstPending = std::stable_partition(
+      pending.begin(),
+      pending.end(),
+      [completedFrame](const PendingDeletion &deletion) { return deletion.frame <= completedFrame; });
+
+  for (auto it = pending.begin(); it != firstPending; ++it) {
+    destroy(device, *it);
+  }
+  pending.erase(pending.begin(), firstPending);
+}
+
+void LveDeletionQueue::flushAll(VkDevice device) {
+  std::lock_guard<std::mutex> lock{mutex};
+  for (const auto &deletion : pending) {
+    destroy(device, deletion);
+  }
+  pending.clear();
+}
+
+size_t LveDeletionQueue::pendingCount() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return pending.size();
+}
+
+void LveDeletionQueue::destroy(VkDevice device, const PendingDeletion &deletion) {
+  switch (deletion.type) {
+    case VK_OBJECT_TYPE_BUFFER:
+      vkDestroyBuffer(device, (VkBuffer)deletion.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_IMAGE:
+      vkDestroyImage(device, (VkImage)deletion.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+      vkDestroyImageView(device, (VkImageView)deletion.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_SAMPLER:
+      vkDestroySampler(device, (VkSampler)deletion.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+      vkFreeMemory(device, (VkDeviceMemory)deletion.handle, nullptr);
+      break;
+    default:
+      assert(false && "Unsupported object type in deletion queue");
+      break;
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,55 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+// Defers destruction of vulkan objects until the GPU can no longer reference them.
+// Handles are tagged with the frame that is currently being recorded and are only destroyed
+// once the renderer reports that frame as completed.
+class LveDeletionQueue {
+ public:
+  LveDeletionQueue() = default;
+  ~LveDeletionQueue() = default;
+
+  LveDeletionQueue(const LveDeletionQueue &) = delete;
+  LveDeletionQueue &operator=(const LveDeletionQueue &) = delete;
+
+  void setCurrentFrame(uint64_t frame);
+  uint64_t getCurrentFrame() const { return currentFrame; }
+
+  void destroyBuffer(VkBuffer buffer);
+  void destroyImage(VkImage image);
+  void destroyImageView(VkImageView imageView);
+  void destroySampler(VkSampler sampler);
+  void freeMemory(VkDeviceMemory memory);
+
+  // destroys every handle whose frame is less than or equal to completedFrame
+  void flush(VkDevice device, uint64_t completedFrame);
+  // destroys everything, the caller must make sure the device is idle
+  void flushAll(VkDevice device);
+
+  size_t pendingCount();
+
+ private:
+  struct PendingDeletion {
+    VkObjectType type;
+    uint64_t handle;
+    uint64_t frame;
+  };
+
+  void enqueue(VkObjectType type, uint64_t handle);
+  static void destroy(VkDevice device, const PendingDeletion &deletion);
+
+  std::mutex mutex;
+  std::vector<PendingDeletion> pending;
+  uint64_t currentFrame = 0;
+};
+
+}  // namespace lve
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_frame_arena.hpp"
 
 // std
 #include <memory>
@@ -97,7 +98,8 @@ class LveDescriptorWriter {
  private:
   LveDescriptorSetLayout& setLayout;
   LveDescriptorPool& pool;
-  std::vector<VkWriteDescriptorSet> writes;
+  // from the thread's frame arena, writers are built and used within a frame
+  LveFrameVector<VkWriteDescriptorSet> writes;
 };
 
 }  // namespace lve
@@ -1,6 +1,10 @@
 #include "lve_device.hpp"
+#include "lve_profiler.hpp"
+#include "lve_upload_queue.hpp"
 
 // std headers
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -48,23 +52,31 @@ void DestroyDebugUtilsMessengerEXT(
 
 // class member functions
 LveDevice::LveDevice(LveWindow &window) : window{window} {
+  LVE_PROFILE_SCOPE("LveDevice::LveDevice");
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
-  createCommandPool();
+  createSingleTimeCommandPool();
+  uploadQueue_ = std::make_unique<LveUploadQueue>(*this);
 }
 
 LveDevice::~LveDevice() {
-  vkDestroyCommandPool(device_, commandPool, nullptr);
+  vkDeviceWaitIdle(device_);
+  uploadQueue_ = nullptr;
+  deletionQueue_.flushAll(device_);
+
+  vkDestroyCommandPool(device_, singleTimeCommandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
   if (enableValidationLayers) {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -79,7 +91,8 @@ void LveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  instanceApiVersion = queryInstanceApiVersion();
+  appInfo.apiVersion = instanceApiVersion;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -108,6 +121,20 @@ void LveDevice::createInstance() {
   hasGflwRequiredInstanceExtensions();
 }
 
+// vulkan 1.0 loaders reject any apiVersion above 1.0, so only ask for 1.2 when it is available
+uint32_t LveDevice::queryInstanceApiVersion() {
+  auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+      nullptr,
+      "vkEnumerateInstanceVersion");
+  if (enumerateInstanceVersion == nullptr) {
+    return VK_API_VERSION_1_0;
+  }
+
+  uint32_t version = VK_API_VERSION_1_0;
+  enumerateInstanceVersion(&version);
+  return std::min(version, static_cast<uint32_t>(VK_API_VERSION_1_2));
+}
+
 void LveDevice::pickPhysicalDevice() {
   uint32_t deviceCount = 0;
   vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -131,13 +158,34 @@ void LveDevice::pickPhysicalDevice() {
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
   std::cout << "physical device: " << properties.deviceName << std::endl;
+
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  samplerAnisotropySupported = supportedFeatures.samplerAnisotropy == VK_TRUE;
+  pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+  inheritedQueriesSupported = supportedFeatures.inheritedQueries == VK_TRUE;
+  multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+#ifdef VK_EXT_MESH_SHADER_EXTENSION_NAME
+  meshShaderSupported =
+      isDeviceExtensionSupported(physicalDevice, VK_EXT_MESH_SHADER_EXTENSION_NAME);
+#endif
+
+  // timestamps are only meaningful on queues that report valid bits for them
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      physicalDevice, &queueFamilyCount, queueFamilies.data());
+  graphicsTimestampValidBits =
+      queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily].timestampValidBits;
 }
 
 void LveDevice::createLogicalDevice() {
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  std::set<uint32_t> uniqueQueueFamilies = {
+      indices.graphicsFamily, indices.presentFamily, indices.transferFamily};
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -150,17 +198,33 @@ void LveDevice::createLogicalDevice() {
   }
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.samplerAnisotropy = samplerAnisotropySupported ? VK_TRUE : VK_FALSE;
+  deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;
+  deviceFeatures.inheritedQueries = inheritedQueriesSupported ? VK_TRUE : VK_FALSE;
+  deviceFeatures.multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+
+  std::vector<const char *> enabledExtensions = getRequiredDeviceExtensions();
+
+  bool timelineNeedsExtension = false;
+  timelineSemaphoreSupported =
+      queryTimelineSemaphoreSupport(physicalDevice, timelineNeedsExtension);
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+  timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  timelineFeatures.timelineSemaphore = VK_TRUE;
+  if (timelineNeedsExtension) {
+    enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+  }
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext = timelineSemaphoreSupported ? &timelineFeatures : nullptr;
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -177,9 +241,82 @@ void LveDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+
+  if (timelineSemaphoreSupported) {
+    loadTimelineSemaphoreFunctions(timelineNeedsExtension);
+  }
+  std::cout << "timeline semaphores: " << (timelineSemaphoreSupported ? "yes" : "no (fences)")
+            << std::endl;
+  if (hasDedicatedTransferQueue()) {
+    std::cout << "transfer queue: dedicated, family " << indices.transferFamily << std::endl;
+  } else {
+    std::cout << "transfer queue: shared with graphics" << std::endl;
+  }
 }
 
-void LveDevice::createCommandPool() {
+bool LveDevice::queryTimelineSemaphoreSupport(VkPhysicalDevice device, bool &needsExtension) {
+  needsExtension = false;
+
+  // vkGetPhysicalDeviceFeatures2 is core since 1.1
+  if (instanceApiVersion < VK_API_VERSION_1_1) {
+    return false;
+  }
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_1) {
+    return false;
+  }
+
+  bool isCore =
+      instanceApiVersion >= VK_API_VERSION_1_2 && deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+  if (!isCore) {
+    if (!isDeviceExtensionSupported(device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+      return false;
+    }
+    needsExtension = true;
+  }
+
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+  timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &timelineFeatures;
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+
+  if (timelineFeatures.timelineSemaphore != VK_TRUE) {
+    needsExtension = false;
+    return false;
+  }
+  return true;
+}
+
+void LveDevice::loadTimelineSemaphoreFunctions(bool fromExtension) {
+  pfnWaitSemaphores = (PFN_vkWaitSemaphores)vkGetDeviceProcAddr(
+      device_,
+      fromExtension ? "vkWaitSemaphoresKHR" : "vkWaitSemaphores");
+  pfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValue)vkGetDeviceProcAddr(
+      device_,
+      fromExtension ? "vkGetSemaphoreCounterValueKHR" : "vkGetSemaphoreCounterValue");
+
+  if (pfnWaitSemaphores == nullptr || pfnGetSemaphoreCounterValue == nullptr) {
+    timelineSemaphoreSupported = false;
+  }
+}
+
+VkResult LveDevice::waitSemaphores(const VkSemaphoreWaitInfo &waitInfo, uint64_t timeout) {
+  assert(timelineSemaphoreSupported && "Timeline semaphores are not supported by this device");
+  return pfnWaitSemaphores(device_, &waitInfo, timeout);
+}
+
+VkResult LveDevice::getSemaphoreCounterValue(VkSemaphore semaphore, uint64_t *value) {
+  assert(timelineSemaphoreSupported && "Timeline semaphores are not supported by this device");
+  return pfnGetSemaphoreCounterValue(device_, semaphore, value);
+}
+
+void LveDevice::createSingleTimeCommandPool() {
+  // one-shot commands only, frames record from the renderer's per-frame pools
   QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
 
   VkCommandPoolCreateInfo poolInfo = {};
@@ -188,29 +325,32 @@ void LveDevice::createCommandPool() {
   poolInfo.flags =
       VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create command pool!");
+  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &singleTimeCommandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create single time command pool!");
   }
 }
 
-void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void LveDevice::createSurface() {
+  if (isHeadless()) {
+    return;
+  }
+  window.createWindowSurface(instance, &surface_);
+}
 
 bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
 
-  VkPhysicalDeviceFeatures supportedFeatures;
-  vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-
-  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+  // anisotropic filtering is optional: software rasterizers used for headless runs (lavapipe,
+  // SwiftShader) don't always expose it and textures fall back to linear filtering there
+  return indices.isComplete() && extensionsSupported && swapChainAdequate;
 }
 
 void LveDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -261,11 +401,13 @@ bool LveDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> LveDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -308,6 +450,7 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
       &extensionCount,
       availableExtensions.data());
 
+  auto deviceExtensions = getRequiredDeviceExtensions();
   std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
   for (const auto &extension : availableExtensions) {
@@ -317,6 +460,32 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+std::vector<const char *> LveDevice::getRequiredDeviceExtensions() {
+  if (isHeadless()) {
+    return {};
+  }
+  return deviceExtensions;
+}
+
+bool LveDevice::isDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      device,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -332,8 +501,13 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
+    // without a surface nothing is presented, the graphics queue stands in for the present queue
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) {
+      presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ? VK_TRUE : VK_FALSE;
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -345,6 +519,23 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  // prefer a transfer-only family (the copy engines of discrete GPUs), then any non-graphics
+  // family that can transfer, otherwise uploads share the graphics queue
+  indices.transferFamily = indices.graphicsFamily;
+  int transferScore = 0;
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    const VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) ||
+        (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    const int score = flags & VK_QUEUE_COMPUTE_BIT ? 1 : 2;
+    if (score > transferScore) {
+      indices.transferFamily = family;
+      transferScore = score;
+    }
+  }
+
   return indices;
 }
 
@@ -403,6 +594,18 @@ uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pr
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+bool LveDevice::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void LveDevice::createBuffer(
     VkDeviceSize size,
     VkBufferUsageFlags usage,
@@ -438,7 +641,7 @@ VkCommandBuffer LveDevice::beginSingleTimeCommands() {
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = commandPool;
+  allocInfo.commandPool = singleTimeCommandPool;
   allocInfo.commandBufferCount = 1;
 
   VkCommandBuffer commandBuffer;
@@ -463,7 +666,7 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
   vkQueueWaitIdle(graphicsQueue_);
 
-  vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+  vkFreeCommandBuffers(device_, singleTimeCommandPool, 1, &commandBuffer);
 }
 
 void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -509,7 +712,8 @@ void LveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    VkDeviceMemory &imageMemory,
+    VkMemoryPropertyFlags preferredProperties) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -517,6 +721,12 @@ void LveDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
+  // preferred properties (e.g. lazily allocated memory for transient attachments) are only a
+  // hint, fall back to the required properties when no compatible memory type exists
+  if (preferredProperties != 0 && hasMemoryType(memRequirements.memoryTypeBits, preferredProperties)) {
+    properties = preferredProperties;
+  }
+
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   allocInfo.allocationSize = memRequirements.size;
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "lve_deletion_queue.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace lve {
 
+class LveUploadQueue;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -17,6 +21,7 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily;  // a transfer-only family if there is one, else graphicsFamily
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
@@ -39,14 +44,38 @@ class LveDevice {
   LveDevice(LveDevice &&) = delete;
   LveDevice &operator=(LveDevice &&) = delete;
 
-  VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  // headless devices have no surface and no swap chain, frames go to offscreen images
+  bool isHeadless() const { return window.isHeadless(); }
+  bool supportsSamplerAnisotropy() const { return samplerAnisotropySupported; }
+  bool supportsPipelineStatistics() const { return pipelineStatisticsSupported; }
+  // secondary command buffers may only execute while a query is active with this feature
+  bool supportsInheritedQueries() const { return inheritedQueriesSupported; }
+  // without it vkCmdDrawIndexedIndirect only reads one command per call
+  bool supportsMultiDrawIndirect() const { return multiDrawIndirectSupported; }
+  // VK_EXT_mesh_shader is only detected, the renderer has no task or mesh shader pipelines
+  bool supportsMeshShaders() const { return meshShaderSupported; }
+  // 0 if the graphics queue can't write timestamps
+  uint32_t getGraphicsTimestampValidBits() const { return graphicsTimestampValidBits; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // the graphics queue when the device has no dedicated transfer family
+  VkQueue transferQueue() { return transferQueue_; }
+  bool hasDedicatedTransferQueue() const { return transferQueue_ != graphicsQueue_; }
+  // asynchronous staging uploads, see lve_upload_queue.hpp
+  LveUploadQueue &uploadQueue() { return *uploadQueue_; }
+  LveDeletionQueue &deletionQueue() { return deletionQueue_; }
+
+  // timeline semaphores are core in vulkan 1.2 and available through VK_KHR_timeline_semaphore
+  // before that, callers fall back to fences when this returns false
+  bool supportsTimelineSemaphores() const { return timelineSemaphoreSupported; }
+  VkResult waitSemaphores(const VkSemaphoreWaitInfo &waitInfo, uint64_t timeout);
+  VkResult getSemaphoreCounterValue(VkSemaphore semaphore, uint64_t *value);
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -58,6 +87,8 @@ class LveDevice {
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
       VkDeviceMemory &bufferMemory);
+  // Blocking one-shot commands on the graphics queue, call from the thread that owns the
+  // device. Uploads should go through uploadQueue() instead.
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,7 +99,8 @@ class LveDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      VkDeviceMemory &imageMemory,
+      VkMemoryPropertyFlags preferredProperties = 0);
 
   void createImageView(
 	  VkImage image,
@@ -90,7 +122,7 @@ class LveDevice {
   void createSurface();
   void pickPhysicalDevice();
   void createLogicalDevice();
-  void createCommandPool();
+  void createSingleTimeCommandPool();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -100,18 +132,38 @@ class LveDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  std::vector<const char *> getRequiredDeviceExtensions();
+  bool isDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName);
+  uint32_t queryInstanceApiVersion();
+  bool queryTimelineSemaphoreSupport(VkPhysicalDevice device, bool &needsExtension);
+  void loadTimelineSemaphoreFunctions(bool fromExtension);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
+  uint32_t instanceApiVersion = VK_API_VERSION_1_0;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   LveWindow &window;
-  VkCommandPool commandPool;
+  VkCommandPool singleTimeCommandPool;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+
+  LveDeletionQueue deletionQueue_;
+  std::unique_ptr<LveUploadQueue> uploadQueue_;
+
+  bool timelineSemaphoreSupported = false;
+  bool samplerAnisotropySupported = false;
+  bool pipelineStatisticsSupported = false;
+  bool inheritedQueriesSupported = false;
+  bool multiDrawIndirectSupported = false;
+  bool meshShaderSupported = false;
+  uint32_t graphicsTimestampValidBits = 0;
+  PFN_vkWaitSemaphores pfnWaitSemaphores = nullptr;
+  PFN_vkGetSemaphoreCounterValue pfnGetSemaphoreCounterValue = nullptr;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
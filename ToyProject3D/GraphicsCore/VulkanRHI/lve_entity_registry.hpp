@@ -0,0 +1,290 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+// Generational entity id: a slot index plus the slot's generation when the entity was created.
+// Destroying an entity bumps the generation, so stale ids never alias an entity reusing the slot.
+struct LveEntity {
+  static constexpr uint32_t INVALID_INDEX = ~0u;
+
+  uint32_t index = INVALID_INDEX;
+  uint32_t generation = 0;
+
+  bool operator==(const LveEntity &other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const LveEntity &other) const { return !(*this == other); }
+};
+
+class LveComponentPoolBase {
+ public:
+  virtual ~LveComponentPoolBase() = default;
+  virtual bool contains(uint32_t entityIndex) const = 0;
+  virtual void remove(uint32_t entityIndex) = 0;
+};
+
+// Sparse set of one component type. The components are packed in a dense array, sparse maps an
+// entity index to the component's position in it. Removal swaps the last component into the gap,
+// so iteration order is insertion order until something is removed.
+//
+// Each component also carries a changed flag, set when it is added or patched and cleared by
+// whichever system consumes the change, so per-frame work can skip components nobody touched.
+template <typename T>
+class LveComponentPool : public LveComponentPoolBase {
+ public:
+  static constexpr uint32_t ABSENT = ~0u;
+
+  T &add(LveEntity entity, T component) {
+    assert(!contains(entity.index) && "Entity already has this component");
+    if (entity.index >= sparse.size()) {
+      sparse.resize(entity.index + 1, ABSENT);
+    }
+    sparse[entity.index] = static_cast<uint32_t>(dense.size());
+    dense.push_back(entity);
+    components.push_back(std::move(component));
+    changed.push_back(1);
+    return components.back();
+  }
+
+  void remove(uint32_t entityIndex) override {
+    assert(contains(entityIndex) && "Entity does not have this component");
+    const uint32_t position = sparse[entityIndex];
+    const uint32_t last = static_cast<uint32_t>(dense.size()) - 1;
+    if (position != last) {
+      dense[position] = dense[last];
+      components[position] = std::move(components[last]);
+      changed[position] = changed[last];
+      sparse[dense[position].index] = position;
+    }
+    dense.pop_back();
+    components.pop_back();
+    changed.pop_back();
+    sparse[entityIndex] = ABSENT;
+  }
+
+  bool contains(uint32_t entityIndex) const override {
+    return entityIndex < sparse.size() && sparse[entityIndex] != ABSENT;
+  }
+
+  T &get(uint32_t entityIndex) {
+    assert(contains(entityIndex) && "Entity does not have this component");
+    return components[sparse[entityIndex]];
+  }
+
+  // get for writing, flags the component as changed
+  T &patch(uint32_t entityIndex) {
+    assert(contains(entityIndex) && "Entity does not have this component");
+    const uint32_t position = sparse[entityIndex];
+    changed[position] = 1;
+    return components[position];
+  }
+
+  // Position of the entity's component in the dense array. Pools filled in the same order keep
+  // the same positions, checking the hint first skips the sparse lookup for them.
+  uint32_t find(uint32_t entityIndex, size_t hint) const {
+    if (hint < dense.size() && dense[hint].index == entityIndex) {
+      return static_cast<uint32_t>(hint);
+    }
+    return entityIndex < sparse.size() ? sparse[entityIndex] : ABSENT;
+  }
+
+  size_t size() const { return dense.size(); }
+  // owners of the components, in the same order
+  const std::vector<LveEntity> &entities() const { return dense; }
+  T &at(size_t position) { return components[position]; }
+  T *data() { return components.data(); }
+
+  // one byte per position, so jobs clearing neighbouring flags never share a word
+  bool isChanged(size_t position) const { return changed[position] != 0; }
+  void markChanged(size_t position) { changed[position] = 1; }
+  void clearChanged(size_t position) { changed[position] = 0; }
+
+ private:
+  std::vector<uint32_t> sparse;
+  std::vector<LveEntity> dense;
+  std::vector<T> components;
+  std::vector<uint8_t> changed;  // by position, like components
+};
+
+// Entity/component store. Every component type lives in its own LveComponentPool, so a system
+// only touches the arrays of the components it asks for in a view.
+//
+// Creating and destroying entities and adding or removing components must not overlap with
+// anything else. Views may be iterated from several threads at once as long as every thread
+// writes components of different entities, e.g. disjoint ranges of View::each.
+class LveEntityRegistry {
+ public:
+  template <typename... Ts>
+  class View {
+   public:
+    // upper bound of matching entities, the size of the smallest pool
+    size_t size() const { return driver->size(); }
+
+    // calls function(entity, Ts &...) for every entity that has all the components
+    template <typename Function>
+    void each(Function &&function) {
+      each(0, size(), std::forward<Function>(function));
+    }
+
+    // Same for the entities at positions [first, last) of the smallest pool, for splitting the
+    // view across jobs.
+    template <typename Function>
+    void each(size_t first, size_t last, Function &&function) {
+      for (size_t position = first; position < last; position++) {
+        const LveEntity entity = (*driver)[position];
+        std::array<uint32_t, sizeof...(Ts)> found;
+        if (lookup(entity.index, position, found, std::index_sequence_for<Ts...>{})) {
+          invoke(function, entity, found, std::index_sequence_for<Ts...>{});
+        }
+      }
+    }
+
+   private:
+    friend class LveEntityRegistry;
+
+    explicit View(LveComponentPool<Ts> &...viewPools) : pools{&viewPools...} {
+      for (const std::vector<LveEntity> *entities : {&viewPools.entities()...}) {
+        if (driver == nullptr || entities->size() < driver->size()) {
+          driver = entities;
+        }
+      }
+    }
+
+    template <size_t... I>
+    bool lookup(
+        uint32_t entityIndex,
+        size_t hint,
+        std::array<uint32_t, sizeof...(Ts)> &found,
+        std::index_sequence<I...>) const {
+      constexpr uint32_t ABSENT = ~0u;
+      return (((found[I] = std::get<I>(pools)->find(entityIndex, hint)) != ABSENT) && ...);
+    }
+
+    template <typename Function, size_t... I>
+    void invoke(
+        Function &function,
+        LveEntity entity,
+        const std::array<uint32_t, sizeof...(Ts)> &found,
+        std::index_sequence<I...>) {
+      function(entity, std::get<I>(pools)->at(found[I])...);
+    }
+
+    std::tuple<LveComponentPool<Ts> *...> pools;
+    const std::vector<LveEntity> *driver = nullptr;  // entities of the smallest pool
+  };
+
+  LveEntityRegistry() = default;
+
+  LveEntityRegistry(const LveEntityRegistry &) = delete;
+  LveEntityRegistry &operator=(const LveEntityRegistry &) = delete;
+
+  LveEntity create() {
+    uint32_t index;
+    if (!freeSlots.empty()) {
+      index = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      index = static_cast<uint32_t>(generations.size());
+      generations.push_back(0);
+    }
+    aliveCount++;
+    return {index, generations[index]};
+  }
+
+  void destroy(LveEntity entity) {
+    assert(isAlive(entity) && "Cannot destroy an entity that is not alive");
+    for (auto &pool : pools) {
+      if (pool != nullptr && pool->contains(entity.index)) {
+        pool->remove(entity.index);
+      }
+    }
+    generations[entity.index]++;
+    freeSlots.push_back(entity.index);
+    aliveCount--;
+  }
+
+  bool isAlive(LveEntity entity) const {
+    return entity.index < generations.size() && generations[entity.index] == entity.generation;
+  }
+
+  size_t getEntityCount() const { return aliveCount; }
+  // every entity index is below this, for arrays indexed by entity
+  uint32_t getSlotCount() const { return static_cast<uint32_t>(generations.size()); }
+
+  template <typename T>
+  T &add(LveEntity entity, T component = {}) {
+    assert(isAlive(entity) && "Cannot add a component to an entity that is not alive");
+    return pool<T>().add(entity, std::move(component));
+  }
+
+  template <typename T>
+  void remove(LveEntity entity) {
+    assert(isAlive(entity) && "Cannot remove a component from an entity that is not alive");
+    pool<T>().remove(entity.index);
+  }
+
+  template <typename T>
+  bool has(LveEntity entity) {
+    return isAlive(entity) && pool<T>().contains(entity.index);
+  }
+
+  template <typename T>
+  T &get(LveEntity entity) {
+    assert(isAlive(entity) && "Cannot get a component of an entity that is not alive");
+    return pool<T>().get(entity.index);
+  }
+
+  // get for writing, marks the component changed for the systems that skip unchanged ones
+  template <typename T>
+  T &patch(LveEntity entity) {
+    assert(isAlive(entity) && "Cannot patch a component of an entity that is not alive");
+    return pool<T>().patch(entity.index);
+  }
+
+  template <typename T>
+  LveComponentPool<T> &pool() {
+    const uint32_t type = componentType<T>();
+    if (type >= pools.size()) {
+      pools.resize(type + 1);
+    }
+    if (pools[type] == nullptr) {
+      pools[type] = std::make_unique<LveComponentPool<T>>();
+    }
+    return static_cast<LveComponentPool<T> &>(*pools[type]);
+  }
+
+  template <typename... Ts>
+  View<Ts...> view() {
+    return View<Ts...>{pool<Ts>()...};
+  }
+
+ private:
+  // dense ids for component types, shared by every registry
+  static uint32_t nextComponentType() {
+    static std::atomic<uint32_t> next{0};
+    return next.fetch_add(1, std::memory_order_relaxed);
+  }
+  template <typename T>
+  static uint32_t componentType() {
+    static const uint32_t type = nextComponentType();
+    return type;
+  }
+
+  std::vector<uint32_t> generations;
+  std::vector<uint32_t> freeSlots;
+  size_t aliveCount = 0;
+  std::vector<std::unique_ptr<LveComponentPoolBase>> pools;  // indexed by componentType
+};
+
+}  // namespace lve
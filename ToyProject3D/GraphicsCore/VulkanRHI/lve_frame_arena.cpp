@@ -0,0 +1,49 @@
+#include "lve_frame_arena.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+namespace {
+
+size_t alignUp(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+LveFrameArena::LveFrameArena(size_t capacity)
+    : block{std::make_unique<std::byte[]>(capacity)}, capacity{capacity} {}
+
+void *LveFrameArena::allocate(size_t size, size_t alignment) {
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of 2");
+  assert(alignment <= alignof(std::max_align_t) && "Over-aligned types are not supported");
+  size = std::max<size_t>(size, 1);
+  const size_t offset = alignUp(used, alignment);
+  if (offset + size <= capacity) {
+    used = offset + size;
+    return block.get() + offset;
+  }
+
+  // one heap block per overflowing allocation, reset() sizes the main block to avoid them
+  overflowBlocks.push_back(std::make_unique<std::byte[]>(size));
+  overflowUsed += size;
+  return overflowBlocks.back().get();
+}
+
+void LveFrameArena::reset() {
+  peak = std::max(peak, used + overflowUsed);
+  if (!overflowBlocks.empty()) {
+    overflowBlocks.clear();
+    overflowCount++;
+    // headroom for the next frame being a little larger than this one
+    capacity = std::max(2 * capacity, peak + peak / 2);
+    block = std::make_unique<std::byte[]>(capacity);
+  }
+  used = 0;
+  overflowUsed = 0;
+}
+
+}  // namespace lve
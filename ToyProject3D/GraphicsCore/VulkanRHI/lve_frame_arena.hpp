@@ -0,0 +1,115 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace lve {
+
+// Linear allocator for CPU temporaries that live at most one frame, used from one thread.
+//
+// Allocations bump an offset into a single block and are never freed one by one, reset() drops
+// all of them at once at the frame boundary. A frame that needs more than the block gets extra
+// blocks from the heap instead of failing; the next reset() frees those and grows the main block
+// to the frame's peak, so a steady frame loop stops touching the heap after its first frames.
+//
+// Each thread binds its own arena with LveFrameArenaBinding, like LveCommandStatsBinding, and
+// LveFrameAllocator takes the bound one. Without a binding allocators fall back to the heap, so
+// code using them also works outside the frame loop, e.g. during setup.
+class LveFrameArena {
+ public:
+  explicit LveFrameArena(size_t capacity = 64 * 1024);
+
+  LveFrameArena(const LveFrameArena &) = delete;
+  LveFrameArena &operator=(const LveFrameArena &) = delete;
+
+  void *allocate(size_t size, size_t alignment);
+  // invalidates every allocation made since the last reset
+  void reset();
+
+  size_t getCapacity() const { return capacity; }
+  size_t getUsed() const { return used + overflowUsed; }
+  // bytes of the largest frame so far, overflow included
+  size_t getPeak() const { return peak; }
+  // frames that did not fit the main block, each one grew it
+  uint32_t getOverflowCount() const { return overflowCount; }
+
+  // arena bound to the calling thread, null outside of an LveFrameArenaBinding
+  static LveFrameArena *&threadArena() {
+    thread_local LveFrameArena *arena = nullptr;
+    return arena;
+  }
+
+ private:
+  std::unique_ptr<std::byte[]> block;
+  size_t capacity;
+  size_t used = 0;
+  // heap blocks of the current frame once the main block is full, freed by reset()
+  std::vector<std::unique_ptr<std::byte[]>> overflowBlocks;
+  size_t overflowUsed = 0;
+  size_t peak = 0;
+  uint32_t overflowCount = 0;
+};
+
+// Binds an arena to the calling thread for the lifetime of the object and restores the previous
+// binding, jobs running on the main thread nest inside its own binding.
+class LveFrameArenaBinding {
+ public:
+  explicit LveFrameArenaBinding(LveFrameArena &arena) : previous{LveFrameArena::threadArena()} {
+    LveFrameArena::threadArena() = &arena;
+  }
+  ~LveFrameArenaBinding() { LveFrameArena::threadArena() = previous; }
+
+  LveFrameArenaBinding(const LveFrameArenaBinding &) = delete;
+  LveFrameArenaBinding &operator=(const LveFrameArenaBinding &) = delete;
+
+ private:
+  LveFrameArena *previous;
+};
+
+// STL allocator over the arena bound when it was created, or the heap if there was none.
+// deallocate() is a no-op for arena memory, containers must not outlive the arena's frame.
+template <typename T>
+class LveFrameAllocator {
+ public:
+  using value_type = T;
+
+  LveFrameAllocator() noexcept : arena{LveFrameArena::threadArena()} {}
+  explicit LveFrameAllocator(LveFrameArena *arena) noexcept : arena{arena} {}
+  template <typename U>
+  LveFrameAllocator(const LveFrameAllocator<U> &other) noexcept : arena{other.getArena()} {}
+
+  T *allocate(size_t count) {
+    if (arena == nullptr) {
+      return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+    return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *pointer, size_t) noexcept {
+    if (arena == nullptr) {
+      ::operator delete(pointer);
+    }
+  }
+
+  LveFrameArena *getArena() const noexcept { return arena; }
+
+  template <typename U>
+  bool operator==(const LveFrameAllocator<U> &other) const noexcept {
+    return arena == other.getArena();
+  }
+  template <typename U>
+  bool operator!=(const LveFrameAllocator<U> &other) const noexcept {
+    return arena != other.getArena();
+  }
+
+ private:
+  LveFrameArena *arena;
+};
+
+template <typename T>
+using LveFrameVector = std::vector<T, LveFrameAllocator<T>>;
+
+}  // namespace lve
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "lve_camera.hpp"
+#include "lve_meshlets.hpp"
+#include "lve_model.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// one visible object as the simulation saw it, enough to record its draw without the scene
+struct DrawPacket {
+  glm::mat4 modelMatrix{1.f};
+  glm::mat3 normalMatrix{1.f};
+  LveModel *model = nullptr;
+  uint32_t objectIndex = 0;  // entity index, selects the object's descriptor sets
+  uint32_t lod = 0;          // level of detail of the model, see LveMeshLods
+  // range of FramePacket::meshletCommands with the visible meshlets, no commands draws the whole
+  // model
+  uint32_t firstCommand = 0;
+  uint32_t commandCount = 0;
+};
+
+// Everything the renderer needs for one frame. Written by the simulation, immutable once it has
+// been handed to the renderer, so recording never reads state the simulation is changing.
+struct FramePacket {
+  uint64_t frameNumber = 0;
+  float frameTime = 0.f;  // simulation step the packet was produced with
+  LveCamera camera{};
+  std::vector<DrawPacket> draws;
+  // indirect draws of the meshlets that survived cluster culling, see LveMeshlets::cull
+  std::vector<VkDrawIndexedIndirectCommand> meshletCommands;
+  LveMeshlets::CullStats meshletStats{};
+  // draws at every level of detail
+  std::array<uint32_t, LveMeshLods::MAX_LODS> lodDraws{};
+
+  // CPU time the simulation spent on this packet
+  double updateMs = 0.0;
+  double cullingMs = 0.0;
+};
+
+}  // namespace lve
@@ -7,7 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
-#include <memory>
+#include <atomic>
 
 namespace lve {
 
@@ -29,7 +29,7 @@ class LveGameObject {
   using id_t = unsigned int;
 
   static LveGameObject createGameObject() {
-    static id_t currentId = 0;
+    static std::atomic<id_t> currentId{0};
     return LveGameObject{currentId++};
   }
 
@@ -40,8 +40,8 @@ class LveGameObject {
 
   id_t getId() { return id; }
 
-  std::shared_ptr<LveModel> model{};
-  std::shared_ptr<LveTexture> texture{};
+  LveModelHandle model{};
+  LveTextureHandle texture{};
   TransformComponent transform{};
 
  private:
@@ -0,0 +1,161 @@
+#include "lve_gpu_profiler.hpp"
+#include "lve_frame_arena.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveGpuProfiler::LveGpuProfiler(LveDevice &device, int framesInFlight, uint32_t maxZones)
+    : lveDevice{device},
+      maxZones{maxZones},
+      timestampPeriodNs{device.properties.limits.timestampPeriod},
+      frames(framesInFlight) {
+  const uint32_t validBits = lveDevice.getGraphicsTimestampValidBits();
+  if (validBits == 0) {
+    return;  // profiler stays disabled, every call becomes a no-op
+  }
+  timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+
+  // two timestamps per zone, one block of zones per frame in flight
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = 2 * maxZones * static_cast<uint32_t>(framesInFlight);
+  if (vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool!");
+  }
+
+  if (lveDevice.supportsPipelineStatistics()) {
+    VkQueryPoolCreateInfo statisticsInfo{};
+    statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    statisticsInfo.queryCount = static_cast<uint32_t>(framesInFlight);
+    statisticsInfo.pipelineStatistics = STATISTICS_FLAGS;
+    if (vkCreateQueryPool(lveDevice.device(), &statisticsInfo, nullptr, &statisticsPool) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline statistics query pool!");
+    }
+  }
+}
+
+LveGpuProfiler::~LveGpuProfiler() {
+  if (timestampPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(lveDevice.device(), timestampPool, nullptr);
+  }
+  if (statisticsPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(lveDevice.device(), statisticsPool, nullptr);
+  }
+}
+
+void LveGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, int frameIndex) {
+  if (!isEnabled()) {
+    return;
+  }
+  currentFrameIndex = frameIndex;
+  resolve(frameIndex);
+
+  FrameQueries &frame = frames[frameIndex];
+  frame.zoneNames.clear();
+  frame.statisticsRecorded = false;
+  vkCmdResetQueryPool(commandBuffer, timestampPool, 2 * maxZones * frameIndex, 2 * maxZones);
+  if (hasPipelineStatistics()) {
+    vkCmdResetQueryPool(commandBuffer, statisticsPool, frameIndex, 1);
+  }
+}
+
+uint32_t LveGpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char *name) {
+  if (!isEnabled()) {
+    return INVALID_ZONE;
+  }
+  FrameQueries &frame = frames[currentFrameIndex];
+  if (frame.zoneNames.size() >= maxZones) {
+    return INVALID_ZONE;
+  }
+  const uint32_t zone = static_cast<uint32_t>(frame.zoneNames.size());
+  frame.zoneNames.push_back(name);
+  vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      timestampPool,
+      2 * maxZones * currentFrameIndex + 2 * zone);
+  return zone;
+}
+
+void LveGpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone) {
+  if (zone == INVALID_ZONE) {
+    return;
+  }
+  vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      timestampPool,
+      2 * maxZones * currentFrameIndex + 2 * zone + 1);
+}
+
+void LveGpuProfiler::beginStatistics(VkCommandBuffer commandBuffer) {
+  if (!hasPipelineStatistics()) {
+    return;
+  }
+  assert(!frames[currentFrameIndex].statisticsRecorded && "Statistics already recorded this frame");
+  vkCmdBeginQuery(commandBuffer, statisticsPool, currentFrameIndex, 0);
+}
+
+void LveGpuProfiler::endStatistics(VkCommandBuffer commandBuffer) {
+  if (!hasPipelineStatistics()) {
+    return;
+  }
+  vkCmdEndQuery(commandBuffer, statisticsPool, currentFrameIndex);
+  frames[currentFrameIndex].statisticsRecorded = true;
+}
+
+void LveGpuProfiler::resolve(int frameIndex) {
+  const FrameQueries &frame = frames[frameIndex];
+  if (frame.zoneNames.empty()) {
+    return;
+  }
+
+  // no WAIT flag: the frame has finished on the GPU, if it somehow hasn't the old results stay
+  const uint32_t queryCount = 2 * static_cast<uint32_t>(frame.zoneNames.size());
+  LveFrameVector<uint64_t> timestamps(queryCount);
+  if (vkGetQueryPoolResults(
+          lveDevice.device(),
+          timestampPool,
+          2 * maxZones * frameIndex,
+          queryCount,
+          timestamps.size() * sizeof(uint64_t),
+          timestamps.data(),
+          sizeof(uint64_t),
+          VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+
+  zoneResults.clear();
+  for (size_t zone = 0; zone < frame.zoneNames.size(); zone++) {
+    const uint64_t begin = timestamps[2 * zone] & timestampMask;
+    const uint64_t end = timestamps[2 * zone + 1] & timestampMask;
+    const uint64_t ticks = (end - begin) & timestampMask;  // handles counter wrap
+    zoneResults.push_back({frame.zoneNames[zone], ticks * timestampPeriodNs * 1e-6});
+  }
+
+  if (frame.statisticsRecorded) {
+    uint64_t statistics[2] = {};
+    if (vkGetQueryPoolResults(
+            lveDevice.device(),
+            statisticsPool,
+            frameIndex,
+            1,
+            sizeof(statistics),
+            statistics,
+            sizeof(statistics),
+            VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+      // results are ordered by statistic bit: vertex shader before fragment shader invocations
+      pipelineStatistics.vertexInvocations = statistics[0];
+      pipelineStatistics.fragmentInvocations = statistics[1];
+    }
+  }
+  resolvedFrames++;
+}
+
+}  // namespace lve
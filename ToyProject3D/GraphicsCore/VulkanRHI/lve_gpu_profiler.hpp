@@ -0,0 +1,103 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// GPU timings from timestamp queries. Every frame in flight owns a range of the query pool;
+// the range is read back when its slot comes around again, i.e. the results always describe
+// frame N - framesInFlight, which the swap chain has already waited for, so nothing stalls.
+class LveGpuProfiler {
+ public:
+  struct ZoneResult {
+    const char *name;
+    double ms;
+  };
+
+  struct PipelineStatistics {
+    uint64_t vertexInvocations = 0;
+    uint64_t fragmentInvocations = 0;
+  };
+
+  static constexpr uint32_t INVALID_ZONE = UINT32_MAX;
+  // counters of the statistics query, also the mask secondary command buffers have to inherit
+  static constexpr VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+  LveGpuProfiler(LveDevice &device, int framesInFlight, uint32_t maxZones = 16);
+  ~LveGpuProfiler();
+
+  LveGpuProfiler(const LveGpuProfiler &) = delete;
+  LveGpuProfiler &operator=(const LveGpuProfiler &) = delete;
+
+  bool isEnabled() const { return timestampPool != VK_NULL_HANDLE; }
+  bool hasPipelineStatistics() const { return statisticsPool != VK_NULL_HANDLE; }
+
+  // Must be recorded outside of a render pass: reads back the slot's previous frame and resets
+  // its queries.
+  void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+
+  // Zones may nest and may be recorded inside a render pass. Zones past maxZones are dropped.
+  uint32_t beginZone(VkCommandBuffer commandBuffer, const char *name);
+  void endZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+  // vertex/fragment shader invocations, begin and end in the same render pass or both outside
+  void beginStatistics(VkCommandBuffer commandBuffer);
+  void endStatistics(VkCommandBuffer commandBuffer);
+
+  // number of frames read back so far, results are empty until the first slot comes around
+  uint64_t getResolvedFrameCount() const { return resolvedFrames; }
+  const std::vector<ZoneResult> &getZoneResults() const { return zoneResults; }
+  const PipelineStatistics &getPipelineStatistics() const { return pipelineStatistics; }
+
+ private:
+  struct FrameQueries {
+    std::vector<const char *> zoneNames;
+    bool statisticsRecorded = false;
+  };
+
+  void resolve(int frameIndex);
+
+  LveDevice &lveDevice;
+  uint32_t maxZones;
+  double timestampPeriodNs;
+  uint64_t timestampMask = 0;
+
+  VkQueryPool timestampPool = VK_NULL_HANDLE;
+  VkQueryPool statisticsPool = VK_NULL_HANDLE;
+  std::vector<FrameQueries> frames;
+  int currentFrameIndex = 0;
+
+  uint64_t resolvedFrames = 0;
+  std::vector<ZoneResult> zoneResults;
+  PipelineStatistics pipelineStatistics{};
+};
+
+// Records a GPU zone for the lifetime of the object.
+class LveGpuZone {
+ public:
+  LveGpuZone(LveGpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name)
+      : profiler{profiler}, commandBuffer{commandBuffer} {
+    zone = profiler.beginZone(commandBuffer, name);
+  }
+  ~LveGpuZone() { profiler.endZone(commandBuffer, zone); }
+
+  LveGpuZone(const LveGpuZone &) = delete;
+  LveGpuZone &operator=(const LveGpuZone &) = delete;
+
+ private:
+  LveGpuProfiler &profiler;
+  VkCommandBuffer commandBuffer;
+  uint32_t zone;
+};
+
+}  // namespace lve
@@ -0,0 +1,256 @@
+#include "lve_job_system.hpp"
+#include "lve_profiler.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace lve {
+
+namespace {
+
+// which job system thread the calling thread is, set for the owner and every worker
+struct ThreadBinding {
+  const LveJobSystem *system = nullptr;
+  uint32_t index = 0;
+};
+thread_local ThreadBinding threadBinding{};
+
+}  // namespace
+
+LveJobSystem::WorkStealingQueue::WorkStealingQueue(uint32_t capacity)
+    : buffer{new std::atomic<Job *>[capacity]}, mask{static_cast<int64_t>(capacity) - 1} {
+  assert((capacity & (capacity - 1)) == 0 && "Queue capacity must be a power of two");
+}
+
+bool LveJobSystem::WorkStealingQueue::push(Job *job) {
+  const int64_t b = bottom.load(std::memory_order_relaxed);
+  // thieves only ever move top up, a stale value can only make the queue look fuller
+  const int64_t t = top.load(std::memory_order_acquire);
+  if (b - t > mask) {
+    return false;
+  }
+  buffer[b & mask].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+LveJobSystem::Job *LveJobSystem::WorkStealingQueue::pop() {
+  const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // empty
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  Job *job = buffer[b & mask].load(std::memory_order_relaxed);
+  if (t == b) {
+    // last job, race against thieves for it
+    if (!top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+LveJobSystem::Job *LveJobSystem::WorkStealingQueue::steal() {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) {
+    return nullptr;
+  }
+
+  Job *job = buffer[t & mask].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return nullptr;  // lost against the owner or another thief
+  }
+  return job;
+}
+
+LveJobSystem::LveJobSystem(int workerCount, int externalThreadCount) {
+  if (workerCount < 0) {
+    workerCount = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  }
+
+  for (int i = 0; i <= workerCount + std::max(0, externalThreadCount); i++) {
+    threads.push_back(std::make_unique<ThreadState>());
+  }
+  threadBinding = {this, 0};
+
+  for (int i = 1; i <= workerCount; i++) {
+    workers.emplace_back(&LveJobSystem::workerMain, this, static_cast<uint32_t>(i));
+  }
+}
+
+LveJobSystem::~LveJobSystem() {
+  {
+    std::lock_guard<std::mutex> lock{wakeMutex};
+    stopping = true;
+  }
+  wakeCondition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (threadBinding.system == this) {
+    threadBinding = {};
+  }
+}
+
+void LveJobSystem::workerMain(uint32_t threadIndex) {
+  threadBinding = {this, threadIndex};
+  const std::string threadName = "job worker " + std::to_string(threadIndex);
+  LVE_PROFILE_THREAD(threadName.c_str());
+
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (Job *job = findJob(threadIndex)) {
+      execute(job);
+      continue;
+    }
+    // nothing to steal: sleep until a job is queued, the timeout covers missed notifications
+    std::unique_lock<std::mutex> lock{wakeMutex};
+    wakeCondition.wait_for(lock, std::chrono::milliseconds(1), [this] {
+      return stopping.load(std::memory_order_relaxed) ||
+             queuedJobs.load(std::memory_order_relaxed) > 0;
+    });
+  }
+}
+
+void LveJobSystem::attachThread() {
+  assert(threadBinding.system == nullptr && "Thread is already bound to a job system");
+  const uint32_t index = 1 + getWorkerCount() + attachedThreads.fetch_add(1);
+  if (index >= threads.size()) {
+    throw std::runtime_error("no external job system thread slot left!");
+  }
+  threadBinding = {this, index};
+}
+
+void LveJobSystem::detachThread() {
+  assert(threadBinding.system == this && "Thread is not bound to this job system");
+  threadBinding = {};
+}
+
+uint32_t LveJobSystem::currentThreadIndex() const {
+  assert(
+      threadBinding.system == this &&
+      "Jobs can only be created, run and waited for on job system threads");
+  return threadBinding.index;
+}
+
+LveJobSystem::Job *LveJobSystem::createJob(std::function<void()> function, Job *parent) {
+  Job *job = allocateJob(parent);
+  job->function = std::move(function);
+  job->rangeFunction = nullptr;
+  return job;
+}
+
+LveJobSystem::Job *LveJobSystem::createRangeJob(
+    void (*function)(const void *range, size_t first),
+    const void *range,
+    size_t first,
+    Job *parent) {
+  Job *job = allocateJob(parent);
+  job->function = nullptr;
+  job->rangeFunction = function;
+  job->range = range;
+  job->first = first;
+  return job;
+}
+
+LveJobSystem::Job *LveJobSystem::allocateJob(Job *parent) {
+  ThreadState &thread = *threads[currentThreadIndex()];
+  if (!isFinished(&thread.job(thread.nextJob))) {
+    // the unfinished jobs may be parents of the one being created, waiting for the slot could
+    // never return: grow the ring and continue in the new block, it stays for later frames
+    thread.nextJob = thread.jobCount();
+    thread.jobBlocks.push_back(std::make_unique<Job[]>(JOB_CAPACITY));
+  }
+  Job &job = thread.job(thread.nextJob);
+  thread.nextJob = (thread.nextJob + 1) % thread.jobCount();
+
+  job.parent = parent;
+  job.unfinished.store(1, std::memory_order_relaxed);
+  if (parent != nullptr) {
+    assert(!isFinished(parent) && "Cannot add a child to a finished job");
+    parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+  }
+  return &job;
+}
+
+void LveJobSystem::run(Job *job) {
+  if (!threads[currentThreadIndex()]->queue.push(job)) {
+    // a full queue has plenty of work for the other threads already
+    execute(job);
+    return;
+  }
+  queuedJobs.fetch_add(1, std::memory_order_relaxed);
+  wakeCondition.notify_one();
+}
+
+void LveJobSystem::wait(const Job *job) {
+  const uint32_t threadIndex = currentThreadIndex();
+  while (!isFinished(job)) {
+    if (Job *next = findJob(threadIndex)) {
+      execute(next);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{errorMutex};
+  if (firstError) {
+    std::exception_ptr error = firstError;
+    firstError = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+LveJobSystem::Job *LveJobSystem::findJob(uint32_t threadIndex) {
+  Job *job = threads[threadIndex]->queue.pop();
+  if (job == nullptr) {
+    // steal round robin, starting after ourselves so thieves spread over the victims
+    for (size_t i = 1; i < threads.size() && job == nullptr; i++) {
+      job = threads[(threadIndex + i) % threads.size()]->queue.steal();
+    }
+  }
+  if (job != nullptr) {
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+void LveJobSystem::execute(Job *job) {
+  try {
+    if (job->rangeFunction != nullptr) {
+      job->rangeFunction(job->range, job->first);
+    } else {
+      job->function();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock{errorMutex};
+    if (!firstError) {
+      firstError = std::current_exception();
+    }
+  }
+  finish(job);
+}
+
+void LveJobSystem::finish(Job *job) {
+  // read before the decrement, a finished job's slot can be reused by its owner right away
+  Job *parent = job->parent;
+  if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent != nullptr) {
+    finish(parent);
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,162 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+// Work-stealing job scheduler.
+//
+// Every worker thread, and the thread that created the job system (the owner), has a Chase-Lev
+// deque: its own thread pushes and pops jobs at the bottom, idle threads steal from the top.
+// Jobs form a tree, a job is finished once its function and those of all its children have run.
+// wait() never blocks while there is work, the waiting thread executes queued jobs instead.
+//
+// Jobs are allocated from a ring per thread and must be created and run from the owner, a
+// worker or an attached external thread. The ring starts with JOB_CAPACITY jobs and grows by as
+// many whenever the next one is still unfinished, and a job run on a thread whose queue is full
+// is executed right away instead. The first exception thrown by a job is rethrown by the next
+// wait() that returns.
+class LveJobSystem {
+ public:
+  static constexpr uint32_t JOB_CAPACITY = 4096;
+
+  struct Job {
+    std::function<void()> function;
+    // parallelFor chunks call this with their first index instead, so they never allocate
+    void (*rangeFunction)(const void *range, size_t first) = nullptr;
+    const void *range = nullptr;
+    size_t first = 0;
+    Job *parent = nullptr;
+    std::atomic<int32_t> unfinished{0};  // this job plus its unfinished children
+  };
+
+  // workerCount < 0 starts one worker per hardware thread besides the owner. externalThreadCount
+  // reserves queues for threads the caller starts itself, see attachThread().
+  explicit LveJobSystem(int workerCount = -1, int externalThreadCount = 0);
+  ~LveJobSystem();
+
+  LveJobSystem(const LveJobSystem &) = delete;
+  LveJobSystem &operator=(const LveJobSystem &) = delete;
+
+  // Children have to be created before their parent has finished, i.e. before the parent is
+  // run or from inside the parent's function.
+  Job *createJob(std::function<void()> function, Job *parent = nullptr);
+  void run(Job *job);
+  void wait(const Job *job);
+  bool isFinished(const Job *job) const {
+    return job->unfinished.load(std::memory_order_acquire) == 0;
+  }
+
+  // Runs function(first, last) over [begin, end) split into chunks of about grainSize indices
+  // and returns once every chunk is done. The calling thread works on chunks as well.
+  template <typename Function>
+  void parallelFor(size_t begin, size_t end, size_t grainSize, Function &&function) {
+    if (begin >= end) {
+      return;
+    }
+    // keep the number of chunks well inside the job ring
+    const size_t maxChunks = JOB_CAPACITY / 4;
+    grainSize = std::max<size_t>({grainSize, 1, (end - begin + maxChunks - 1) / maxChunks});
+
+    // chunks point at the range on this stack frame through a plain function pointer, nothing
+    // is captured into a std::function and no chunk allocates
+    struct Range {
+      Function &function;
+      size_t end;
+      size_t grainSize;
+    };
+    const Range range{function, end, grainSize};
+    Job *root = createJob([] {});
+    for (size_t first = begin; first < end; first += grainSize) {
+      run(createRangeJob(
+          [](const void *context, size_t start) {
+            const Range &range = *static_cast<const Range *>(context);
+            range.function(start, std::min(range.end, start + range.grainSize));
+          },
+          &range,
+          first,
+          root));
+    }
+    run(root);
+    wait(root);
+  }
+
+  // Binds the calling thread to the next reserved external slot, after which it creates, runs
+  // and waits for jobs like the owner. Detach before the thread exits, slots are not reused.
+  void attachThread();
+  void detachThread();
+
+  int getWorkerCount() const { return static_cast<int>(workers.size()); }
+  // owner, workers and reserved external threads
+  int getThreadCount() const { return static_cast<int>(threads.size()); }
+  // index in [0, getThreadCount()) of the calling thread, 0 for the owner, stable for its lifetime
+  uint32_t currentThreadIndex() const;
+
+ private:
+  // Chase-Lev deque with a fixed capacity, see "Correct and Efficient Work-Stealing for Weak
+  // Memory Models" (Le et al. 2013).
+  class WorkStealingQueue {
+   public:
+    explicit WorkStealingQueue(uint32_t capacity);
+
+    bool push(Job *job);  // owning thread only, false if full
+    Job *pop();           // owning thread only
+    Job *steal();         // any thread
+
+   private:
+    std::unique_ptr<std::atomic<Job *>[]> buffer;
+    int64_t mask;
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+  };
+
+  struct ThreadState {
+    ThreadState() : queue{JOB_CAPACITY} {
+      jobBlocks.push_back(std::make_unique<Job[]>(JOB_CAPACITY));
+    }
+
+    Job &job(uint32_t slot) { return jobBlocks[slot / JOB_CAPACITY][slot % JOB_CAPACITY]; }
+    uint32_t jobCount() const { return static_cast<uint32_t>(jobBlocks.size()) * JOB_CAPACITY; }
+
+    WorkStealingQueue queue;
+    // allocation ring of JOB_CAPACITY jobs per block, blocks never move so jobs stay in place
+    std::vector<std::unique_ptr<Job[]>> jobBlocks;
+    uint32_t nextJob = 0;
+  };
+
+  Job *allocateJob(Job *parent);
+  Job *createRangeJob(
+      void (*function)(const void *range, size_t first),
+      const void *range,
+      size_t first,
+      Job *parent);
+  void workerMain(uint32_t threadIndex);
+  Job *findJob(uint32_t threadIndex);
+  void execute(Job *job);
+  void finish(Job *job);
+
+  std::vector<std::unique_ptr<ThreadState>> threads;  // owner, workers, external threads
+  std::vector<std::thread> workers;
+
+  std::atomic<uint32_t> attachedThreads{0};
+
+  std::atomic<bool> stopping{false};
+  std::atomic<int32_t> queuedJobs{0};
+  std::mutex wakeMutex;
+  std::condition_variable wakeCondition;
+
+  std::mutex errorMutex;
+  std::exception_ptr firstError;
+};
+
+}  // namespace lve
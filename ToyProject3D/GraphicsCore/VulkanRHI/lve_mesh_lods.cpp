@@ -0,0 +1,408 @@
+#include "lve_mesh_lods.hpp"
+
+#include "lve_meshlets.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <numeric>
+#include <ostream>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t FILE_MAGIC = 0x444c564cu;  // "LVLD"
+constexpr uint32_t FILE_VERSION = 1;
+
+// triangles of the simplified levels relative to the full mesh
+constexpr float LOD_RATIOS[LveMeshLods::MAX_LODS - 1] = {0.5f, 0.25f, 0.125f};
+// a level keeping more than this share of the previous level's triangles isn't worth its indices
+constexpr float MIN_REDUCTION = 0.9f;
+// collapses may turn a remaining triangle by up to about 75 degrees, more would fold the surface
+constexpr float MIN_NORMAL_COSINE = 0.25f;
+
+// Symmetric 4x4 matrix summing weighted squared distances to planes, evaluate(p) is the sum of
+// the squared distances of p to all of them times their weights.
+struct Quadric {
+  double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+  double yy = 0.0, yz = 0.0, yw = 0.0;
+  double zz = 0.0, zw = 0.0;
+  double ww = 0.0;
+  double weight = 0.0;
+
+  // the plane dot(normal, p) + distance = 0, normal of unit length
+  static Quadric fromPlane(const glm::dvec3 &normal, double distance, double weight) {
+    Quadric q;
+    q.xx = weight * normal.x * normal.x;
+    q.xy = weight * normal.x * normal.y;
+    q.xz = weight * normal.x * normal.z;
+    q.xw = weight * normal.x * distance;
+    q.yy = weight * normal.y * normal.y;
+    q.yz = weight * normal.y * normal.z;
+    q.yw = weight * normal.y * distance;
+    q.zz = weight * normal.z * normal.z;
+    q.zw = weight * normal.z * distance;
+    q.ww = weight * distance * distance;
+    q.weight = weight;
+    return q;
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    xx += other.xx;
+    xy += other.xy;
+    xz += other.xz;
+    xw += other.xw;
+    yy += other.yy;
+    yz += other.yz;
+    yw += other.yw;
+    zz += other.zz;
+    zw += other.zw;
+    ww += other.ww;
+    weight += other.weight;
+    return *this;
+  }
+
+  double evaluate(const glm::vec3 &p) const {
+    const double x = p.x;
+    const double y = p.y;
+    const double z = p.z;
+    const double error = xx * x * x + yy * y * y + zz * z * z + ww +
+                         2.0 * (xy * x * y + xz * x * z + yz * y * z + xw * x + yw * y + zw * z);
+    // rounding can take a sum of squares slightly below zero
+    return std::max(error, 0.0);
+  }
+};
+
+// moves every corner at vertex from to vertex to
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;  // area weighted squared distance, small triangles go first
+};
+
+// Vertices that may not be collapsed: ones sharing their position with another vertex, which
+// sit on a uv or normal seam, and ones on an edge not shared by exactly two triangles.
+std::vector<uint8_t> findLockedVertices(
+    const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices) {
+  uint32_t weldedCount = 0;
+  const std::vector<uint32_t> welded = LveMeshlets::weldPositions(positions, weldedCount);
+
+  std::vector<uint8_t> used(positions.size());
+  std::vector<uint32_t> copies(weldedCount);
+  for (uint32_t index : indices) {
+    if (!used[index]) {
+      used[index] = 1;
+      copies[welded[index]]++;
+    }
+  }
+
+  std::vector<uint64_t> edges;
+  edges.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t corner = 0; corner < 3; corner++) {
+      const uint32_t a = welded[indices[i + corner]];
+      const uint32_t b = welded[indices[i + (corner + 1) % 3]];
+      if (a != b) {
+        edges.push_back(uint64_t{std::min(a, b)} << 32 | std::max(a, b));
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<uint8_t> lockedPositions(weldedCount);
+  for (size_t first = 0; first < edges.size();) {
+    size_t last = first + 1;
+    while (last < edges.size() && edges[last] == edges[first]) {
+      last++;
+    }
+    if (last - first != 2) {
+      lockedPositions[edges[first] >> 32] = 1;
+      lockedPositions[edges[first] & 0xffffffffu] = 1;
+    }
+    first = last;
+  }
+
+  std::vector<uint8_t> locked(positions.size());
+  for (size_t vertex = 0; vertex < positions.size(); vertex++) {
+    locked[vertex] = copies[welded[vertex]] > 1 || lockedPositions[welded[vertex]];
+  }
+  return locked;
+}
+
+// false if moving from onto to would turn one of the triangles around from that survives the
+// collapse too far
+bool keepsOrientation(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &indices,
+    const uint32_t *triangles,
+    uint32_t triangleCount,
+    const Collapse &collapse) {
+  for (uint32_t i = 0; i < triangleCount; i++) {
+    const uint32_t *corners = &indices[3 * triangles[i]];
+    if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+      continue;
+    }
+    glm::vec3 before[3];
+    glm::vec3 after[3];
+    for (int corner = 0; corner < 3; corner++) {
+      before[corner] = positions[corners[corner]];
+      after[corner] = positions[corners[corner] == collapse.from ? collapse.to : corners[corner]];
+    }
+    const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+    const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::dot(normalBefore, normalAfter) <=
+        MIN_NORMAL_COSINE * glm::length(normalBefore) * glm::length(normalAfter)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Collapses edges of indices, cheapest first, until at most targetCount indices are left or no
+// collapse is possible, and returns the largest mean squared distance of a vertex that was
+// collapsed into to the planes it has merged. Every pass collapses edges
+// whose neighbourhoods don't overlap, so each collapse is checked against the triangles it
+// actually changes.
+double simplify(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint8_t> &locked,
+    std::vector<Quadric> &quadrics,
+    std::vector<uint32_t> &indices,
+    size_t targetCount) {
+  const size_t vertexCount = positions.size();
+  std::vector<uint32_t> offsets(vertexCount + 1);
+  std::vector<uint32_t> cursors(vertexCount);
+  std::vector<uint32_t> vertexTriangles;
+  std::vector<Collapse> collapses;
+  std::vector<uint8_t> touched(vertexCount);
+  std::vector<uint32_t> remap(vertexCount);
+  double maxError = 0.0;
+
+  while (indices.size() > targetCount) {
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // triangles around every vertex
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (uint32_t index : indices) {
+      offsets[index + 1]++;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::copy(offsets.begin(), offsets.end() - 1, cursors.begin());
+    vertexTriangles.resize(indices.size());
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+      for (int corner = 0; corner < 3; corner++) {
+        vertexTriangles[cursors[indices[3 * triangle + corner]]++] = triangle;
+      }
+    }
+
+    // both directions of every edge whose first vertex may move, edges inside the mesh twice
+    collapses.clear();
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+      for (int corner = 0; corner < 3; corner++) {
+        const uint32_t a = indices[3 * triangle + corner];
+        const uint32_t b = indices[3 * triangle + (corner + 1) % 3];
+        // the merged quadric at the vertex that stays
+        if (!locked[a]) {
+          const glm::vec3 &target = positions[b];
+          collapses.push_back({a, b, quadrics[a].evaluate(target) + quadrics[b].evaluate(target)});
+        }
+        if (!locked[b]) {
+          const glm::vec3 &target = positions[a];
+          collapses.push_back({b, a, quadrics[a].evaluate(target) + quadrics[b].evaluate(target)});
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+      return a.cost < b.cost;
+    });
+
+    std::fill(touched.begin(), touched.end(), 0);
+    std::iota(remap.begin(), remap.end(), 0);
+    const size_t trianglesToRemove = (indices.size() - targetCount + 2) / 3;
+    size_t removed = 0;
+    bool collapsed = false;
+    for (const Collapse &collapse : collapses) {
+      if (removed >= trianglesToRemove) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      }
+      const uint32_t *triangles = &vertexTriangles[offsets[collapse.from]];
+      const uint32_t count = offsets[collapse.from + 1] - offsets[collapse.from];
+      if (!keepsOrientation(positions, indices, triangles, count, collapse)) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      // the mean squared distance to the planes merged into the vertex
+      const Quadric &merged = quadrics[collapse.to];
+      maxError = std::max(maxError, merged.evaluate(positions[collapse.to]) / merged.weight);
+      collapsed = true;
+      for (uint32_t i = 0; i < count; i++) {
+        const uint32_t *corners = &indices[3 * triangles[i]];
+        bool degenerates = false;
+        for (int corner = 0; corner < 3; corner++) {
+          touched[corners[corner]] = 1;
+          degenerates |= corners[corner] == collapse.to;
+        }
+        removed += degenerates;
+      }
+    }
+    if (!collapsed) {
+      break;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      const uint32_t a = remap[indices[i]];
+      const uint32_t b = remap[indices[i + 1]];
+      const uint32_t c = remap[indices[i + 2]];
+      if (a != b && b != c && a != c) {
+        indices[written++] = a;
+        indices[written++] = b;
+        indices[written++] = c;
+      }
+    }
+    indices.resize(written);
+  }
+  return maxError;
+}
+
+template <typename T>
+void writeValue(std::ostream &stream, const T &value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream &stream, T &value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+}  // namespace
+
+void LveMeshLods::build(
+    const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &meshIndices) {
+  lods.clear();
+  indices.clear();
+  if (meshIndices.empty()) {
+    return;
+  }
+  const uint32_t meshIndexCount = static_cast<uint32_t>(meshIndices.size());
+  lods.push_back({0, meshIndexCount, 0.f});
+
+  const std::vector<uint8_t> locked = findLockedVertices(positions, meshIndices);
+  std::vector<Quadric> quadrics(positions.size());
+  for (size_t i = 0; i < meshIndices.size(); i += 3) {
+    const glm::dvec3 p0 = positions[meshIndices[i]];
+    const glm::dvec3 p1 = positions[meshIndices[i + 1]];
+    const glm::dvec3 p2 = positions[meshIndices[i + 2]];
+    const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const double length = glm::length(normal);
+    if (length == 0.0) {
+      continue;
+    }
+    const Quadric plane =
+        Quadric::fromPlane(normal / length, -glm::dot(normal / length, p0), 0.5 * length);
+    quadrics[meshIndices[i]] += plane;
+    quadrics[meshIndices[i + 1]] += plane;
+    quadrics[meshIndices[i + 2]] += plane;
+  }
+
+  // every level continues from the one before, the quadrics keep the full mesh's planes
+  std::vector<uint32_t> level = meshIndices;
+  double maxError = 0.0;
+  for (float ratio : LOD_RATIOS) {
+    const size_t previousCount = level.size();
+    const size_t targetCount = static_cast<size_t>(meshIndices.size() / 3 * ratio) * 3;
+    maxError = std::max(maxError, simplify(positions, locked, quadrics, level, targetCount));
+    if (level.empty() || level.size() > previousCount * MIN_REDUCTION) {
+      break;
+    }
+    lods.push_back(
+        {meshIndexCount + static_cast<uint32_t>(indices.size()),
+         static_cast<uint32_t>(level.size()),
+         static_cast<float>(std::sqrt(maxError))});
+    indices.insert(indices.end(), level.begin(), level.end());
+  }
+}
+
+void LveMeshLods::save(std::ostream &stream, uint64_t meshHash) const {
+  writeValue(stream, FILE_MAGIC);
+  writeValue(stream, FILE_VERSION);
+  writeValue(stream, meshHash);
+  writeValue(stream, static_cast<uint32_t>(lods.size()));
+  writeValue(stream, static_cast<uint32_t>(indices.size()));
+  stream.write(reinterpret_cast<const char *>(lods.data()), lods.size() * sizeof(Lod));
+  stream.write(
+      reinterpret_cast<const char *>(indices.data()), indices.size() * sizeof(uint32_t));
+}
+
+bool LveMeshLods::load(
+    std::istream &stream, uint64_t meshHash, uint32_t vertexCount, uint32_t meshIndexCount) {
+  lods.clear();
+  indices.clear();
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t hash = 0;
+  uint32_t lodCount = 0;
+  uint32_t indexCount = 0;
+  if (!readValue(stream, magic) || !readValue(stream, version) || !readValue(stream, hash) ||
+      !readValue(stream, lodCount) || !readValue(stream, indexCount)) {
+    return false;
+  }
+  if (magic != FILE_MAGIC || version != FILE_VERSION || hash != meshHash || lodCount > MAX_LODS) {
+    return false;
+  }
+
+  std::vector<Lod> fileLods(lodCount);
+  std::vector<uint32_t> fileIndices(indexCount);
+  if (!stream.read(reinterpret_cast<char *>(fileLods.data()), lodCount * sizeof(Lod)) ||
+      !stream.read(
+          reinterpret_cast<char *>(fileIndices.data()), indexCount * sizeof(uint32_t))) {
+    return false;
+  }
+  // the hash only covers the mesh, a damaged file must not make draws read past the indices;
+  // build() leaves an empty mesh without levels and gives any other one a level 0 of its own
+  if (lodCount == 0) {
+    if (meshIndexCount != 0) {
+      return false;
+    }
+  } else if (fileLods[0].firstIndex != 0 || fileLods[0].indexCount != meshIndexCount) {
+    return false;
+  }
+  for (uint32_t lod = 1; lod < lodCount; lod++) {
+    const Lod &level = fileLods[lod];
+    if (level.firstIndex < meshIndexCount || level.indexCount > indexCount ||
+        level.firstIndex - meshIndexCount > indexCount - level.indexCount) {
+      return false;
+    }
+  }
+  for (uint32_t index : fileIndices) {
+    if (index >= vertexCount) {
+      return false;
+    }
+  }
+
+  lods = std::move(fileLods);
+  indices = std::move(fileIndices);
+  return true;
+}
+
+uint32_t LveMeshLods::selectLod(float errorScale, float maxError) const {
+  // errors only grow from one level to the next
+  uint32_t selected = 0;
+  for (uint32_t lod = 1; lod < lods.size(); lod++) {
+    if (lods[lod].error * errorScale > maxError) {
+      break;
+    }
+    selected = lod;
+  }
+  return selected;
+}
+
+}  // namespace lve
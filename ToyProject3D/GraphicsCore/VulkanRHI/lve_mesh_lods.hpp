@@ -0,0 +1,65 @@
+#pragma once
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace lve {
+
+// Levels of detail of one mesh: the full mesh and simplified versions with roughly half, a
+// quarter and an eighth of its triangles, to draw instead when the difference is too small to see.
+//
+// build() simplifies with quadric error metrics: every vertex sums the planes of its triangles,
+// and edges are collapsed into one of their vertices in order of how far that moves the surface
+// from those planes. Levels only add indices, they reuse the mesh's vertices, so all levels share
+// one vertex buffer and the simplified indices follow the mesh's own in its index buffer.
+// Vertices on uv or normal seams and on open borders are never collapsed, so seams stay closed
+// and attributes are never interpolated across them.
+//
+// Like LveTriangleBvh, built levels can be written to and read back from a stream that carries
+// the hash of the mesh they were built from.
+class LveMeshLods {
+ public:
+  static constexpr uint32_t MAX_LODS = 4;
+
+  struct Lod {
+    // range of the mesh's index buffer, level 0 is the mesh itself
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    // estimated distance between this level's surface and the full mesh's, in object space
+    float error = 0.f;
+  };
+
+  LveMeshLods() = default;
+
+  // Replaces the levels with ones simplified from meshIndices, three per triangle, into
+  // positions. A level is only kept if it removes a tenth of the triangles of the one before it.
+  void build(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &meshIndices);
+
+  // meshHash as from LveTriangleBvh::hashMesh
+  void save(std::ostream &stream, uint64_t meshHash) const;
+  // false, leaving no levels, if the stream is damaged, of another version or another mesh.
+  // meshIndexCount is the size of the mesh's own indices, which level 0 has to cover exactly.
+  bool load(
+      std::istream &stream, uint64_t meshHash, uint32_t vertexCount, uint32_t meshIndexCount);
+
+  // Coarsest level whose error times errorScale is at most maxError. With errorScale the pixels
+  // an object space unit covers at the mesh's distance, maxError is in pixels.
+  uint32_t selectLod(float errorScale, float maxError) const;
+
+  bool empty() const { return lods.empty(); }
+  uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+  const Lod &getLod(uint32_t lod) const { return lods[lod]; }
+  // indices of the levels after the first, to append to the mesh's own
+  const std::vector<uint32_t> &getIndices() const { return indices; }
+
+ private:
+  std::vector<Lod> lods;
+  std::vector<uint32_t> indices;
+};
+
+}  // namespace lve
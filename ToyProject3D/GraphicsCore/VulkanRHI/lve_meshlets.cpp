@@ -0,0 +1,360 @@
+#include "lve_meshlets.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t NONE = ~0u;
+// cones whose widest triangle is less than this cosine off the axis cull too rarely to test
+constexpr float MIN_CONE_COSINE = 0.1f;
+
+// true if every edge is shared by exactly two triangles, degenerate edges aside
+bool isClosed(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &welded) {
+  std::vector<uint64_t> edges;
+  edges.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t corner = 0; corner < 3; corner++) {
+      const uint32_t a = welded[indices[i + corner]];
+      const uint32_t b = welded[indices[i + (corner + 1) % 3]];
+      if (a != b) {
+        edges.push_back(uint64_t{std::min(a, b)} << 32 | std::max(a, b));
+      }
+    }
+  }
+  if (edges.empty()) {
+    return false;
+  }
+  std::sort(edges.begin(), edges.end());
+  for (size_t first = 0; first < edges.size();) {
+    size_t last = first;
+    while (last < edges.size() && edges[last] == edges[first]) {
+      last++;
+    }
+    if (last - first != 2) {
+      return false;
+    }
+    first = last;
+  }
+  return true;
+}
+
+// Bounding sphere around the meshlet's vertices and, with coneCulling, its normal cone as in
+// meshoptimizer's meshopt_computeClusterBounds: the axis averages the triangle normals and the
+// apex sits far enough back along it that it is behind every triangle's plane.
+void computeBounds(
+    LveMeshlets::Meshlet &meshlet,
+    const uint32_t *meshletVertices,
+    const std::vector<uint32_t> &meshletTriangles,
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &indices,
+    const std::vector<glm::vec3> &triangleNormals,
+    bool coneCulling) {
+  LveAabb box{
+      glm::vec3{std::numeric_limits<float>::max()},
+      glm::vec3{std::numeric_limits<float>::lowest()}};
+  for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+    box.min = glm::min(box.min, positions[meshletVertices[i]]);
+    box.max = glm::max(box.max, positions[meshletVertices[i]]);
+  }
+  meshlet.center = box.center();
+  float radiusSquared = 0.f;
+  for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+    const glm::vec3 offset = positions[meshletVertices[i]] - meshlet.center;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+  }
+  meshlet.radius = std::sqrt(radiusSquared);
+
+  meshlet.coneCutoff = 1.f;
+  if (!coneCulling) {
+    return;
+  }
+  // degenerate triangles have no normal and can't be seen, they don't widen the cone
+  glm::vec3 normalSum{0.f};
+  for (uint32_t triangle : meshletTriangles) {
+    normalSum += triangleNormals[triangle];
+  }
+  const float sumLength = glm::length(normalSum);
+  if (sumLength == 0.f) {
+    return;
+  }
+  const glm::vec3 axis = normalSum / sumLength;
+  float minCosine = 1.f;
+  for (uint32_t triangle : meshletTriangles) {
+    if (triangleNormals[triangle] != glm::vec3{0.f}) {
+      minCosine = std::min(minCosine, glm::dot(axis, triangleNormals[triangle]));
+    }
+  }
+  if (minCosine <= MIN_CONE_COSINE) {
+    return;
+  }
+
+  float apexDistance = std::numeric_limits<float>::lowest();
+  for (uint32_t triangle : meshletTriangles) {
+    const glm::vec3 &normal = triangleNormals[triangle];
+    if (normal != glm::vec3{0.f}) {
+      const glm::vec3 &corner = positions[indices[3 * triangle]];
+      apexDistance = std::max(
+          apexDistance, glm::dot(meshlet.center - corner, normal) / glm::dot(axis, normal));
+    }
+  }
+  meshlet.coneApex = meshlet.center - axis * apexDistance;
+  meshlet.coneAxis = axis;
+  meshlet.coneCutoff = std::sqrt(1.f - minCosine * minCosine);
+}
+
+}  // namespace
+
+std::vector<uint32_t> LveMeshlets::weldPositions(
+    const std::vector<glm::vec3> &positions, uint32_t &weldedCount) {
+  std::vector<uint32_t> order(positions.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  auto less = [&](uint32_t a, uint32_t b) {
+    const glm::vec3 &p = positions[a];
+    const glm::vec3 &q = positions[b];
+    return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+  };
+  std::sort(order.begin(), order.end(), less);
+
+  std::vector<uint32_t> welded(positions.size());
+  weldedCount = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    if (i == 0 || positions[order[i]] != positions[order[i - 1]]) {
+      weldedCount++;
+    }
+    welded[order[i]] = weldedCount - 1;
+  }
+  return welded;
+}
+
+void LveMeshlets::build(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<glm::vec3> &normals,
+    std::vector<uint32_t> &indices) {
+  assert(indices.size() % 3 == 0 && "Meshlets need a triangle list");
+  assert((normals.empty() || normals.size() == positions.size()) && "One normal per vertex");
+  meshlets.clear();
+  vertices.clear();
+  triangles.clear();
+  const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount == 0) {
+    return;
+  }
+
+  uint32_t weldedCount = 0;
+  const std::vector<uint32_t> welded = weldPositions(positions, weldedCount);
+
+  // geometric normals, flipped to the side the vertex normals point to
+  bool hasNormals = false;
+  std::vector<glm::vec3> triangleNormals(triangleCount);
+  std::vector<glm::vec3> centroids(triangleCount);
+  for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+    const uint32_t *corners = &indices[3 * triangle];
+    const glm::vec3 &p0 = positions[corners[0]];
+    const glm::vec3 &p1 = positions[corners[1]];
+    const glm::vec3 &p2 = positions[corners[2]];
+    centroids[triangle] = (p0 + p1 + p2) / 3.f;
+
+    const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const float length = glm::length(normal);
+    if (normals.empty() || length == 0.f) {
+      continue;
+    }
+    const glm::vec3 shading = normals[corners[0]] + normals[corners[1]] + normals[corners[2]];
+    hasNormals = hasNormals || shading != glm::vec3{0.f};
+    triangleNormals[triangle] = (glm::dot(normal, shading) < 0.f ? -normal : normal) / length;
+  }
+  const bool coneCulling = hasNormals && isClosed(indices, welded);
+
+  // triangles around every welded vertex
+  std::vector<uint32_t> adjacencyOffsets(weldedCount + 1, 0);
+  for (uint32_t index : indices) {
+    adjacencyOffsets[welded[index] + 1]++;
+  }
+  for (uint32_t vertex = 0; vertex < weldedCount; vertex++) {
+    adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+  }
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t i = 0; i < indices.size(); i++) {
+      adjacency[fill[welded[indices[i]]]++] = i / 3;
+    }
+  }
+
+  std::vector<uint32_t> reordered;
+  reordered.reserve(indices.size());
+  std::vector<uint8_t> used(triangleCount, 0);
+  // meshlet that last put the triangle on its candidate list, so it's listed once per meshlet
+  std::vector<uint32_t> listedBy(triangleCount, NONE);
+  // local index of every mesh vertex in the meshlet being grown
+  std::vector<uint32_t> localIndex(positions.size(), NONE);
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> leftovers;  // candidates of the previous meshlet, seeds the next one
+  std::vector<uint32_t> meshletTriangles;  // the meshlet's triangles in the original order
+  uint32_t seedCursor = 0;
+
+  while (true) {
+    uint32_t seed = NONE;
+    for (uint32_t triangle : leftovers) {
+      if (!used[triangle]) {
+        seed = triangle;
+        break;
+      }
+    }
+    while (seed == NONE && seedCursor < triangleCount) {
+      if (!used[seedCursor]) {
+        seed = seedCursor;
+      }
+      seedCursor++;
+    }
+    if (seed == NONE) {
+      break;
+    }
+
+    const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+    Meshlet meshlet{};
+    meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+    meshlet.vertexOffset = static_cast<uint32_t>(vertices.size());
+    meshlet.triangleOffset = static_cast<uint32_t>(triangles.size() / 3);
+    glm::vec3 centroidSum{0.f};
+    candidates.clear();
+    meshletTriangles.clear();
+
+    uint32_t next = seed;
+    while (next != NONE) {
+      used[next] = 1;
+      meshletTriangles.push_back(next);
+      centroidSum += centroids[next];
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        const uint32_t vertex = indices[3 * next + corner];
+        if (localIndex[vertex] == NONE) {
+          localIndex[vertex] = meshlet.vertexCount++;
+          vertices.push_back(vertex);
+        }
+        reordered.push_back(vertex);
+        triangles.push_back(static_cast<uint8_t>(localIndex[vertex]));
+
+        const uint32_t weldedVertex = welded[vertex];
+        for (uint32_t a = adjacencyOffsets[weldedVertex]; a < adjacencyOffsets[weldedVertex + 1];
+             a++) {
+          const uint32_t neighbour = adjacency[a];
+          if (!used[neighbour] && listedBy[neighbour] != meshletIndex) {
+            listedBy[neighbour] = meshletIndex;
+            candidates.push_back(neighbour);
+          }
+        }
+      }
+      meshlet.triangleCount++;
+      if (meshlet.triangleCount == MAX_TRIANGLES) {
+        break;
+      }
+
+      // fewest new vertices first, then closest to the meshlet, keeping it round for culling
+      const glm::vec3 meshletCentroid = centroidSum / static_cast<float>(meshlet.triangleCount);
+      next = NONE;
+      uint32_t bestNewVertices = 4;
+      float bestDistance = std::numeric_limits<float>::max();
+      size_t kept = 0;
+      for (uint32_t candidate : candidates) {
+        if (used[candidate]) {
+          continue;
+        }
+        candidates[kept++] = candidate;
+        uint32_t newVertices = 0;
+        for (uint32_t corner = 0; corner < 3; corner++) {
+          newVertices += localIndex[indices[3 * candidate + corner]] == NONE ? 1 : 0;
+        }
+        if (meshlet.vertexCount + newVertices > MAX_VERTICES || newVertices > bestNewVertices) {
+          continue;
+        }
+        const glm::vec3 offset = centroids[candidate] - meshletCentroid;
+        const float distance = glm::dot(offset, offset);
+        if (newVertices < bestNewVertices || distance < bestDistance) {
+          next = candidate;
+          bestNewVertices = newVertices;
+          bestDistance = distance;
+        }
+      }
+      candidates.resize(kept);
+    }
+
+    for (uint32_t i = meshlet.vertexOffset; i < vertices.size(); i++) {
+      localIndex[vertices[i]] = NONE;
+    }
+    computeBounds(
+        meshlet,
+        &vertices[meshlet.vertexOffset],
+        meshletTriangles,
+        positions,
+        indices,
+        triangleNormals,
+        coneCulling);
+    meshlets.push_back(meshlet);
+    leftovers.swap(candidates);
+  }
+
+  indices.swap(reordered);
+}
+
+uint32_t LveMeshlets::cull(
+    const LveFrustum &frustum,
+    const glm::mat4 &modelMatrix,
+    const glm::vec3 &cameraPosition,
+    VkDrawIndexedIndirectCommand *commands,
+    CullStats &stats) const {
+  // both tests run in object space: planes move with the transpose of the model matrix and a
+  // sphere's support along a plane grows with the length of the transformed normal, which is
+  // exact for non-uniform scale too; which side of a triangle the camera is on survives any
+  // affine transform
+  std::array<glm::vec4, 6> planes;
+  std::array<float, 6> radiusScales;
+  const glm::mat4 toWorld = glm::transpose(modelMatrix);
+  for (size_t i = 0; i < planes.size(); i++) {
+    planes[i] = toWorld * frustum.planes[i];
+    radiusScales[i] = glm::length(glm::vec3{planes[i]});
+  }
+  const glm::vec3 camera{glm::inverse(modelMatrix) * glm::vec4{cameraPosition, 1.f}};
+
+  uint32_t commandCount = 0;
+  bool previousVisible = false;
+  for (const Meshlet &meshlet : meshlets) {
+    bool visible = true;
+    for (size_t i = 0; i < planes.size() && visible; i++) {
+      visible = glm::dot(glm::vec3{planes[i]}, meshlet.center) + planes[i].w >=
+                -meshlet.radius * radiusScales[i];
+    }
+    if (visible && meshlet.coneCutoff < 1.f) {
+      const glm::vec3 toApex = meshlet.coneApex - camera;
+      const float distance = glm::length(toApex);
+      visible = glm::dot(toApex, meshlet.coneAxis) <= meshlet.coneCutoff * distance;
+    }
+
+    stats.meshlets++;
+    stats.triangles += meshlet.triangleCount;
+    if (!visible) {
+      stats.culledMeshlets++;
+      stats.culledTriangles += meshlet.triangleCount;
+      previousVisible = false;
+      continue;
+    }
+    // meshlets are consecutive in the index buffer, neighbours merge into one command
+    if (previousVisible) {
+      commands[commandCount - 1].indexCount += 3 * meshlet.triangleCount;
+    } else {
+      commands[commandCount++] = {3 * meshlet.triangleCount, 1, meshlet.firstIndex, 0, 0};
+    }
+    previousVisible = true;
+  }
+  return commandCount;
+}
+
+}  // namespace lve
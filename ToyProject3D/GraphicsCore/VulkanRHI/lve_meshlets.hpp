@@ -0,0 +1,107 @@
+#pragma once
+
+#include "lve_bounds.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Clusters of neighbouring triangles of one mesh with the bounds to cull them one by one, so a
+// mesh that is mostly off screen or facing away only draws the clusters that can be seen.
+//
+// build() grows each meshlet from a seed triangle over shared vertices, preferring triangles that
+// add the fewest vertices, until MAX_VERTICES or MAX_TRIANGLES is reached. It reorders the mesh's
+// indices so every meshlet is one consecutive range, which is what cull() emits as indexed
+// indirect draws. Each meshlet also lists its vertices and its triangles as local 8-bit indices
+// into them, the layout a VK_EXT_mesh_shader pipeline would read.
+//
+// Culling tests a meshlet's bounding sphere against the frustum and its normal cone against the
+// camera. Pipelines draw both faces, so the cone test is only enabled for closed meshes, where
+// triangles facing away are hidden behind the ones facing the camera anyway.
+class LveMeshlets {
+ public:
+  static constexpr uint32_t MAX_VERTICES = 64;
+  static constexpr uint32_t MAX_TRIANGLES = 124;
+
+  struct Meshlet {
+    // bounding sphere in object space
+    glm::vec3 center{0.f};
+    float radius = 0.f;
+    // Every triangle faces away from a camera at p if dot(normalize(coneApex - p), coneAxis) >
+    // coneCutoff. A cutoff of 1 is never exceeded, for meshlets whose triangles face too many
+    // ways and for open meshes.
+    glm::vec3 coneApex{0.f};
+    glm::vec3 coneAxis{0.f};
+    float coneCutoff = 1.f;
+
+    // the meshlet's triangles are indices [firstIndex, firstIndex + 3 * triangleCount)
+    uint32_t firstIndex = 0;
+    uint32_t triangleCount = 0;
+    // offsets into getVertices() and getTriangles(), the latter in triangles
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleOffset = 0;
+  };
+
+  struct CullStats {
+    uint32_t meshlets = 0;
+    uint32_t culledMeshlets = 0;
+    uint64_t triangles = 0;
+    uint64_t culledTriangles = 0;
+
+    CullStats &operator+=(const CullStats &other) {
+      meshlets += other.meshlets;
+      culledMeshlets += other.culledMeshlets;
+      triangles += other.triangles;
+      culledTriangles += other.culledTriangles;
+      return *this;
+    }
+  };
+
+  LveMeshlets() = default;
+
+  // Replaces the meshlets with ones over indices, three per triangle, and reorders indices.
+  // normals orient the cone test, without them, or for open meshes, cones are left disabled.
+  void build(
+      const std::vector<glm::vec3> &positions,
+      const std::vector<glm::vec3> &normals,
+      std::vector<uint32_t> &indices);
+
+  // Writes one command per run of consecutive visible meshlets to commands, which must have room
+  // for getMeshletCount() of them, and returns how many it wrote. The frustum is in world space,
+  // modelMatrix places the mesh in it and cameraPosition is in world space as well.
+  uint32_t cull(
+      const LveFrustum &frustum,
+      const glm::mat4 &modelMatrix,
+      const glm::vec3 &cameraPosition,
+      VkDrawIndexedIndirectCommand *commands,
+      CullStats &stats) const;
+
+  // Ids shared by every vertex at the same position, weldedCount of them, so uv and normal seams
+  // don't split meshlets or make a closed mesh look open.
+  static std::vector<uint32_t> weldPositions(
+      const std::vector<glm::vec3> &positions, uint32_t &weldedCount);
+
+  bool empty() const { return meshlets.empty(); }
+  uint32_t getMeshletCount() const { return static_cast<uint32_t>(meshlets.size()); }
+  const std::vector<Meshlet> &getMeshlets() const { return meshlets; }
+  // mesh vertex index of every meshlet vertex
+  const std::vector<uint32_t> &getVertices() const { return vertices; }
+  // three meshlet vertex indices per triangle
+  const std::vector<uint8_t> &getTriangles() const { return triangles; }
+
+ private:
+  std::vector<Meshlet> meshlets;
+  std::vector<uint32_t> vertices;
+  std::vector<uint8_t> triangles;
+};
+
+}  // namespace lve
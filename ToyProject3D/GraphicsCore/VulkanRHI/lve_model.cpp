@@ -1,4 +1,7 @@
 #include "lve_model.hpp"
+#include "lve_command_stats.hpp"
+#include "lve_profiler.hpp"
+#include "lve_upload_queue.hpp"
 #include "lve_utils.hpp"
 
 // libs
@@ -8,8 +11,14 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
 #include <unordered_map>
 
 namespace std{
@@ -25,9 +34,39 @@ namespace std{
 
 namespace lve {
 
-LveModel::LveModel(LveDevice &device, const LveModel::Part &partInfo) : lveDevice{device} {
+namespace {
+
+// object space positions of a part's vertices, what meshlets, trees and levels are built from
+std::vector<glm::vec3> extractPositions(const LveModel::Part &part) {
+	std::vector<glm::vec3> positions;
+	positions.reserve(part.vertices.size());
+	for (const auto &vertex : part.vertices) {
+		positions.push_back(vertex.position);
+	}
+	return positions;
+}
+
+// key of a part's triangles in the triangle BVH and level of detail caches
+uint64_t hashGeometry(const std::vector<glm::vec3> &positions, const LveModel::Part &part) {
+	return LveTriangleBvh::hashMesh(positions, part.indices);
+}
+
+}  // namespace
+
+LveModel::LveModel(LveDevice &device, const LveModel::Part &partInfo)
+	: lveDevice{device},
+	  triangleBvh{partInfo.triangleBvh},
+	  meshlets{partInfo.meshlets},
+	  lods{partInfo.lods} {
 	createVertexBuffers(partInfo.vertices);
 	createIndexBuffers(partInfo.indices);
+
+	boundingBox.min = glm::vec3{std::numeric_limits<float>::max()};
+	boundingBox.max = glm::vec3{std::numeric_limits<float>::lowest()};
+	for (const auto &vertex : partInfo.vertices) {
+		boundingBox.min = glm::min(boundingBox.min, vertex.position);
+		boundingBox.max = glm::max(boundingBox.max, vertex.position);
+	}
 }
 
 LveModel::~LveModel() {}
@@ -38,17 +77,6 @@ void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
   uint32_t vertexSize = sizeof(vertices[0]);
 
-  LveBuffer stagingBuffer{
-	  lveDevice,
-	  vertexSize,
-	  vertexCount,
-	  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
-
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void*)vertices.data());
-
   vertexBuffer = std::make_unique<LveBuffer>(
 	  lveDevice,
 	  vertexSize,
@@ -56,7 +84,12 @@ void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
 	  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 	  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+  lveDevice.uploadQueue().uploadBuffer(
+	  vertices.data(),
+	  bufferSize,
+	  vertexBuffer->getBuffer(),
+	  VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+	  VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 }
 
 void LveModel::createIndexBuffers(const std::vector<uint32_t>& indices) {
@@ -65,56 +98,83 @@ void LveModel::createIndexBuffers(const std::vector<uint32_t>& indices) {
 	if (!hasIndexBuffer) {
 		return;
 	}
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+	// the levels of detail follow the full mesh, the upload copies them right away
+	std::vector<uint32_t> allIndices;
+	if (lods && !lods->getIndices().empty()) {
+		const std::vector<uint32_t>& lodIndices = lods->getIndices();
+		allIndices.reserve(indices.size() + lodIndices.size());
+		allIndices.insert(allIndices.end(), indices.begin(), indices.end());
+		allIndices.insert(allIndices.end(), lodIndices.begin(), lodIndices.end());
+	}
+	const std::vector<uint32_t>& bufferIndices = allIndices.empty() ? indices : allIndices;
+	const uint32_t bufferIndexCount = static_cast<uint32_t>(bufferIndices.size());
+	VkDeviceSize bufferSize = sizeof(indices[0]) * bufferIndexCount;
 	uint32_t indexSize = sizeof(indices[0]);
 
-	LveBuffer stagingBuffer{
-		lveDevice,
-		indexSize,
-		indexCount,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-	};
-
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)indices.data());
-
 	indexBuffer = std::make_unique<LveBuffer>(
 		lveDevice,
 		indexSize,
-		indexCount,
+		bufferIndexCount,
 		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+	lveDevice.uploadQueue().uploadBuffer(
+		bufferIndices.data(),
+		bufferSize,
+		indexBuffer->getBuffer(),
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_ACCESS_INDEX_READ_BIT);
 }
 
-void LveModel::draw(VkCommandBuffer commandBuffer) {
-	if (hasIndexBuffer) {
-		vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t lod) {
+	if (hasIndexBuffer && lods && lod > 0) {
+		const LveMeshLods::Lod& level = lods->getLod(lod);
+		cmd::drawIndexed(commandBuffer, level.indexCount, 1, level.firstIndex, 0, 0);
+	}
+	else if (hasIndexBuffer) {
+		cmd::drawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
 	}
 	else {
-		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+		cmd::draw(commandBuffer, vertexCount, 1, 0, 0);
+	}
+}
+
+void LveModel::drawIndirect(
+	VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount) {
+	assert(hasIndexBuffer && "Indirect draws need an index buffer");
+	constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (lveDevice.supportsMultiDrawIndirect()) {
+		cmd::drawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+		return;
+	}
+	// without multiDrawIndirect every command needs a call of its own
+	for (uint32_t i = 0; i < drawCount; i++) {
+		cmd::drawIndexedIndirect(commandBuffer, buffer, offset + i * stride, 1, stride);
 	}
 }
 
-void LveModel::createModelFromFile(std::vector<std::shared_ptr<LveModel>>& models, LveDevice &device, const std::string &filepath)
+void LveModel::createModelFromFile(std::vector<LveModelHandle>& models, LveResourcePool<LveModel> &pool, LveDevice &device, const std::string &filepath)
 {
 	Builder builder{};
 	builder.loadModel(filepath);
-	for (auto partInfo : builder.parts)
+	createModelFromBuilder(models, pool, device, builder);
+}
+
+void LveModel::createModelFromBuilder(std::vector<LveModelHandle>& models, LveResourcePool<LveModel> &pool, LveDevice &device, const Builder &builder)
+{
+	for (const auto &partInfo : builder.parts)
 	{
-		models.push_back(std::make_unique<LveModel>(device, partInfo));
+		models.push_back(pool.create(device, partInfo));
 	}
 }
 
 void LveModel::bind(VkCommandBuffer commandBuffer) {
   VkBuffer buffers[] = {vertexBuffer->getBuffer() };
   VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+  cmd::bindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
   if (hasIndexBuffer) {
-	  vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	  cmd::bindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
   }
 }
 
@@ -139,6 +199,7 @@ std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDes
 
 void LveModel::Builder::loadModel(const std::string & filepath)
 {
+	LVE_PROFILE_FUNCTION();
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -193,4 +254,163 @@ void LveModel::Builder::loadModel(const std::string & filepath)
 	}
 }
 
+std::vector<uint32_t> LveModel::Builder::batchParts(const std::vector<uint32_t> &partMaterials)
+{
+	LVE_PROFILE_FUNCTION();
+	assert(partMaterials.size() == parts.size() && "Every part needs a material");
+	std::vector<Part> batches;
+	std::vector<uint32_t> batchMaterials;
+	for (size_t i = 0; i < parts.size(); i++) {
+		const auto material =
+			std::find(batchMaterials.begin(), batchMaterials.end(), partMaterials[i]);
+		if (material == batchMaterials.end()) {
+			batchMaterials.push_back(partMaterials[i]);
+			batches.push_back(std::move(parts[i]));
+			continue;
+		}
+		// the part's vertices follow the batch's, its indices move along with them; a non-indexed
+		// part draws its vertices in order, which sequential indices keep once merged
+		Part &batch = batches[material - batchMaterials.begin()];
+		for (Part *merged : {&batch, &parts[i]}) {
+			if (merged->indices.empty()) {
+				merged->indices.resize(merged->vertices.size());
+				std::iota(merged->indices.begin(), merged->indices.end(), 0u);
+			}
+		}
+		const uint32_t vertexOffset = static_cast<uint32_t>(batch.vertices.size());
+		const std::vector<Vertex> &vertices = parts[i].vertices;
+		batch.vertices.insert(batch.vertices.end(), vertices.begin(), vertices.end());
+		batch.indices.reserve(batch.indices.size() + parts[i].indices.size());
+		for (uint32_t index : parts[i].indices) {
+			batch.indices.push_back(vertexOffset + index);
+		}
+	}
+	parts = std::move(batches);
+	return batchMaterials;
+}
+
+void LveModel::Builder::buildMeshlets()
+{
+	LVE_PROFILE_FUNCTION();
+	for (auto &part : parts) {
+		if (part.indices.empty()) {
+			continue;
+		}
+		std::vector<glm::vec3> normals;
+		normals.reserve(part.vertices.size());
+		for (const auto &vertex : part.vertices) {
+			normals.push_back(vertex.normal);
+		}
+		part.meshlets.build(extractPositions(part), normals, part.indices);
+	}
+}
+
+void LveModel::Builder::loadTriangleBvhs(const std::string &cachePath, LveJobSystem &jobSystem)
+{
+	LVE_PROFILE_FUNCTION();
+	std::vector<std::vector<glm::vec3>> positions(parts.size());
+	std::vector<uint64_t> hashes(parts.size());
+	for (size_t i = 0; i < parts.size(); i++) {
+		positions[i] = extractPositions(parts[i]);
+		hashes[i] = hashGeometry(positions[i], parts[i]);
+	}
+
+	// the cache holds every part's tree in order, one stale tree rebuilds them all
+	std::vector<std::shared_ptr<LveTriangleBvh>> bvhs(parts.size());
+	for (auto &bvh : bvhs) {
+		bvh = std::make_shared<LveTriangleBvh>();
+	}
+	bool cached = true;
+	{
+		std::ifstream input{cachePath, std::ios::binary};
+		for (size_t i = 0; i < parts.size() && cached; i++) {
+			cached = input && bvhs[i]->load(input, hashes[i]);
+		}
+	}
+
+	if (!cached) {
+		LVE_PROFILE_SCOPE("BuildTriangleBvhs");
+		auto* building = jobSystem.createJob([] {});
+		for (size_t i = 0; i < parts.size(); i++) {
+			jobSystem.run(jobSystem.createJob([&, i] {
+				bvhs[i]->build(positions[i], parts[i].indices, jobSystem);
+			}, building));
+		}
+		jobSystem.run(building);
+		jobSystem.wait(building);
+
+		// a cache that can't be written only costs the next launch another build
+		std::ofstream output{cachePath, std::ios::binary | std::ios::trunc};
+		for (size_t i = 0; i < parts.size() && output; i++) {
+			bvhs[i]->save(output, hashes[i]);
+		}
+	}
+
+	for (size_t i = 0; i < parts.size(); i++) {
+		parts[i].triangleBvh = bvhs[i]->empty() ? nullptr : bvhs[i];
+	}
+}
+
+void LveModel::Builder::loadLods(const std::string &cachePath, LveJobSystem &jobSystem)
+{
+	LVE_PROFILE_FUNCTION();
+	std::vector<std::vector<glm::vec3>> positions(parts.size());
+	std::vector<uint64_t> hashes(parts.size());
+	for (size_t i = 0; i < parts.size(); i++) {
+		positions[i] = extractPositions(parts[i]);
+		hashes[i] = hashGeometry(positions[i], parts[i]);
+	}
+
+	// one file for all parts, as with the triangle BVHs
+	std::vector<std::shared_ptr<LveMeshLods>> lods(parts.size());
+	for (auto &partLods : lods) {
+		partLods = std::make_shared<LveMeshLods>();
+	}
+	bool cached = true;
+	{
+		std::ifstream input{cachePath, std::ios::binary};
+		for (size_t i = 0; i < parts.size() && cached; i++) {
+			const uint32_t vertexCount = static_cast<uint32_t>(positions[i].size());
+			const uint32_t indexCount = static_cast<uint32_t>(parts[i].indices.size());
+			cached = input && lods[i]->load(input, hashes[i], vertexCount, indexCount);
+		}
+	}
+
+	if (!cached) {
+		LVE_PROFILE_SCOPE("SimplifyParts");
+		auto* simplifying = jobSystem.createJob([] {});
+		for (size_t i = 0; i < parts.size(); i++) {
+			jobSystem.run(jobSystem.createJob([&, i] {
+				lods[i]->build(positions[i], parts[i].indices);
+			}, simplifying));
+		}
+		jobSystem.run(simplifying);
+		jobSystem.wait(simplifying);
+
+		std::ofstream output{cachePath, std::ios::binary | std::ios::trunc};
+		for (size_t i = 0; i < parts.size() && output; i++) {
+			lods[i]->save(output, hashes[i]);
+		}
+	}
+
+	// one write, parts of other models may be loading on other threads
+	std::ostringstream report;
+	for (size_t i = 0; i < parts.size(); i++) {
+		if (lods[i]->getLodCount() < 2) {
+			parts[i].lods = nullptr;
+			continue;
+		}
+		const LveMeshLods::Lod &full = lods[i]->getLod(0);
+		report << cachePath << " part " << i << ": " << full.indexCount / 3 << " triangles";
+		for (uint32_t lod = 1; lod < lods[i]->getLodCount(); lod++) {
+			const LveMeshLods::Lod &level = lods[i]->getLod(lod);
+			report << " | lod " << lod << ": " << level.indexCount / 3 << " ("
+				<< 100.f * level.indexCount / full.indexCount << "%), error " << level.error;
+		}
+		report << "\n";
+		parts[i].lods = lods[i];
+	}
+	std::cout << report.str() << std::flush;
+}
+
 }  // namespace lve
\ No newline at end of file
@@ -1,7 +1,13 @@
 #pragma once
 
+#include "lve_bounds.hpp"
 #include "lve_buffer.hpp"
 #include "lve_device.hpp"
+#include "lve_job_system.hpp"
+#include "lve_mesh_lods.hpp"
+#include "lve_meshlets.hpp"
+#include "lve_resource_pool.hpp"
+#include "lve_triangle_bvh.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -10,6 +16,7 @@
 
 // std
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace lve {
@@ -32,27 +39,67 @@ class LveModel {
   struct Part {
 	  std::vector<Vertex> vertices{};
 	  std::vector<uint32_t> indices{};
+	  // object space triangles for ray queries, set by Builder::loadTriangleBvhs
+	  std::shared_ptr<const LveTriangleBvh> triangleBvh{};
+	  // clusters of the indexed triangles for culling, built by Builder::buildMeshlets
+	  LveMeshlets meshlets{};
+	  // simplified versions of the indexed triangles, set by Builder::loadLods
+	  std::shared_ptr<const LveMeshLods> lods{};
   };
 
   struct Builder {
 	  std::vector<Part> parts{};
 
 	  void loadModel(const std::string &filepath);
+	  // Static batching: merges parts drawn with one transform and the same material into one
+	  // part, so a model built from many shapes takes a draw per material instead of one per
+	  // shape. partMaterials has an id per part, e.g. of the texture it is drawn with. The merged
+	  // parts follow the order their materials are first used in, the returned ids say which
+	  // material each is drawn with. Call it before buildMeshlets, loadTriangleBvhs and loadLods.
+	  std::vector<uint32_t> batchParts(const std::vector<uint32_t> &partMaterials);
+	  // Splits every indexed part into meshlets and reorders its indices to match. Call it before
+	  // loadTriangleBvhs, the trees refer to triangles by their position in the indices.
+	  void buildMeshlets();
+	  // Reads a triangle BVH per indexed part from cachePath, or builds them and writes the file
+	  // if it is missing or was made from other meshes. Can run in a job of jobSystem.
+	  void loadTriangleBvhs(const std::string &cachePath, LveJobSystem &jobSystem);
+	  // Reads the levels of detail of every indexed part from cachePath, or simplifies the parts
+	  // in parallel and writes the file, and prints their triangle counts and errors. Can run in a
+	  // job of jobSystem.
+	  void loadLods(const std::string &cachePath, LveJobSystem &jobSystem);
   };
 
+  // object space axis aligned bounds of the vertices
+  using BoundingBox = LveAabb;
+
   LveModel(LveDevice &device, const LveModel::Part &partInfo);
   ~LveModel();
 
   LveModel(const LveModel &) = delete;
   LveModel &operator=(const LveModel &) = delete;
 
-  static void createModelFromFile(std::vector<std::shared_ptr<LveModel>>& models, LveDevice &device, const std::string &filepath);
+  static void createModelFromFile(std::vector<LveHandle<LveModel>>& models, LveResourcePool<LveModel> &pool, LveDevice &device, const std::string &filepath);
+  // uploads one model per part into pool, Builder::loadModel can run on any thread beforehand
+  static void createModelFromBuilder(std::vector<LveHandle<LveModel>>& models, LveResourcePool<LveModel> &pool, LveDevice &device, const Builder &builder);
 
   void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  // lod selects one of getLods(), models without them always draw in full
+  void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+  // draws drawCount VkDrawIndexedIndirectCommands at offset in buffer, e.g. from LveMeshlets::cull
+  void drawIndirect(
+      VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount);
+
+  const BoundingBox &getBoundingBox() const { return boundingBox; }
+  // null unless the part it was created from had one
+  const LveTriangleBvh *getTriangleBvh() const { return triangleBvh.get(); }
+  // null unless the part it was created from had them
+  const LveMeshlets *getMeshlets() const { return meshlets.empty() ? nullptr : &meshlets; }
+  // null unless the part it was created from had them
+  const LveMeshLods *getLods() const { return lods.get(); }
 
  private:
 	 void createVertexBuffers(const std::vector<Vertex> &vertices);
+	 // followed by the indices of the levels of detail, if the model has them
 	 void createIndexBuffers(const std::vector<uint32_t> &indices);
 
   LveDevice &lveDevice;
@@ -63,6 +110,13 @@ class LveModel {
   bool hasIndexBuffer = false;
   std::unique_ptr<LveBuffer> indexBuffer;
   uint32_t indexCount;
+
+  BoundingBox boundingBox{};
+  std::shared_ptr<const LveTriangleBvh> triangleBvh;
+  LveMeshlets meshlets;
+  std::shared_ptr<const LveMeshLods> lods;
 };
+
+using LveModelHandle = LveHandle<LveModel>;
 }  // namespace lve
 
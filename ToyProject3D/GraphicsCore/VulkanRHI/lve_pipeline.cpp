@@ -1,5 +1,6 @@
 #include "lve_pipeline.hpp"
 
+#include "lve_command_stats.hpp"
 #include "lve_model.hpp"
 
 // std
@@ -128,7 +129,7 @@ void LvePipeline::createShaderModule(const std::vector<char>& code, VkShaderModu
 }
 
 void LvePipeline::bind(VkCommandBuffer commandBuffer) {
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+  cmd::bindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 }
 
 void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
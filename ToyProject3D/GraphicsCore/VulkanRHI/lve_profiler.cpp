@@ -0,0 +1,177 @@
+#include "lve_profiler.hpp"
+
+#ifdef LVE_ENABLE_PROFILER
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef LVE_PROFILER_USE_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace lve {
+
+namespace {
+
+struct ClockSample {
+  uint64_t ticks;
+  std::chrono::steady_clock::time_point time;
+};
+
+ClockSample sampleClocks() { return {LveProfiler::now(), std::chrono::steady_clock::now()}; }
+
+// rdtsc ticks are converted to microseconds with the rate observed between startup and export
+const ClockSample calibrationStart = sampleClocks();
+
+void writeJsonString(std::ostream &out, const std::string &value) {
+  out << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+}  // namespace
+
+std::mutex LveProfiler::registryMutex;
+std::vector<std::shared_ptr<LveProfiler::ThreadBuffer>> LveProfiler::registry;
+uint32_t LveProfiler::nextThreadId = 0;
+
+uint64_t LveProfiler::now() {
+#ifdef LVE_PROFILER_USE_RDTSC
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+#endif
+}
+
+LveProfiler::ThreadBuffer &LveProfiler::threadBuffer() {
+  // the registry keeps the buffer alive after its thread exits so late exports still see it
+  thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+    auto newBuffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock{registryMutex};
+    newBuffer->threadId = nextThreadId++;
+    newBuffer->threadName = "thread " + std::to_string(newBuffer->threadId);
+    registry.push_back(newBuffer);
+    return newBuffer;
+  }();
+  return *buffer;
+}
+
+void LveProfiler::record(const char *name, uint64_t start, uint64_t end) {
+  ThreadBuffer &buffer = threadBuffer();
+  const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  buffer.events[head % RING_CAPACITY] = {name, start, end};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void LveProfiler::setThreadName(const char *name) {
+  ThreadBuffer &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock{registryMutex};
+  buffer.threadName = name;
+}
+
+double LveProfiler::ticksPerMicrosecond() {
+#ifdef LVE_PROFILER_USE_RDTSC
+  ClockSample end = sampleClocks();
+  while (end.time - calibrationStart.time < std::chrono::milliseconds(10)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    end = sampleClocks();
+  }
+  const double elapsedUs =
+      std::chrono::duration<double, std::micro>(end.time - calibrationStart.time).count();
+  return static_cast<double>(end.ticks - calibrationStart.ticks) / elapsedUs;
+#else
+  return 1000.0;
+#endif
+}
+
+void LveProfiler::writeChromeTrace(const std::string &filepath) {
+  std::ofstream out{filepath};
+  if (!out.is_open()) {
+    throw std::runtime_error("failed to open trace file: " + filepath);
+  }
+
+  std::lock_guard<std::mutex> lock{registryMutex};
+  const double ticksPerUs = ticksPerMicrosecond();
+
+  // timestamps start at the oldest retained event to keep them short
+  uint64_t origin = UINT64_MAX;
+  for (const auto &buffer : registry) {
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t first = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+    for (uint64_t i = first; i < head; i++) {
+      origin = std::min(origin, buffer->events[i % RING_CAPACITY].start);
+    }
+  }
+
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  bool firstEvent = true;
+  auto separator = [&]() -> std::ostream & {
+    out << (firstEvent ? "  " : ",\n  ");
+    firstEvent = false;
+    return out;
+  };
+
+  for (const auto &buffer : registry) {
+    separator() << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": "
+                << buffer->threadId << ", \"args\": {\"name\": ";
+    writeJsonString(out, buffer->threadName);
+    out << "}}";
+
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t first = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+    for (uint64_t i = first; i < head; i++) {
+      const Event &event = buffer->events[i % RING_CAPACITY];
+      separator() << "{\"ph\": \"X\", \"name\": ";
+      writeJsonString(out, event.name);
+      out << ", \"pid\": 1, \"tid\": " << buffer->threadId
+          << ", \"ts\": " << (event.start - origin) / ticksPerUs
+          << ", \"dur\": " << (event.end - event.start) / ticksPerUs << "}";
+    }
+  }
+  out << "\n]}\n";
+}
+
+double LveProfiler::measureScopeOverheadNs(int iterations) {
+  // measured on a scratch thread whose buffer is dropped afterwards, so the zones don't end up
+  // in the trace
+  double elapsedNs = 0.0;
+  const ThreadBuffer *scratchBuffer = nullptr;
+  std::thread worker{[&] {
+    scratchBuffer = &threadBuffer();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      LveProfileScope scope{"overhead"};
+    }
+    elapsedNs =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  }};
+  worker.join();
+
+  std::lock_guard<std::mutex> lock{registryMutex};
+  registry.erase(
+      std::remove_if(
+          registry.begin(),
+          registry.end(),
+          [&](const auto &buffer) { return buffer.get() == scratchBuffer; }),
+      registry.end());
+  return elapsedNs / iterations;
+}
+
+}  // namespace lve
+
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+
+// Scoped CPU profiler. Zones are recorded into a fixed size ring buffer owned by each thread and
+// exported in the Chrome trace_event format (chrome://tracing, https://ui.perfetto.dev).
+//
+// Everything compiles out unless LVE_ENABLE_PROFILER is defined: the macros below expand to
+// nothing and lve_profiler.cpp is empty. Define LVE_PROFILER_USE_RDTSC as well to timestamp with
+// the CPU time stamp counter instead of std::chrono::steady_clock on x86.
+//
+// Overhead of one enabled zone, two timestamps plus the ring buffer write, as reported by
+// LveProfiler::measureScopeOverheadNs (main --profiler-overhead) with g++ -O2 on an x86-64 VM:
+//   steady_clock timestamps  ~85 ns
+//   rdtsc timestamps         ~40 ns
+// A frame records a few dozen zones, well below 0.01 ms. Per object work such as recording a
+// draw is profiled as one zone around the loop (or one per recording chunk), so the count doesn't
+// grow with the scene and the ring keeps over a thousand frames per thread.
+
+#ifdef LVE_ENABLE_PROFILER
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+class LveProfiler {
+ public:
+  // events kept per thread, older events are overwritten once a thread records more
+  static constexpr size_t RING_CAPACITY = 1 << 16;
+
+  struct Event {
+    const char *name;  // must outlive the profiler, zones use string literals
+    uint64_t start;
+    uint64_t end;
+  };
+
+  static uint64_t now();
+
+  static void record(const char *name, uint64_t start, uint64_t end);
+  static void setThreadName(const char *name);
+
+  // Not synchronized with recording threads: call when the instrumented threads are idle, e.g.
+  // after the frame loop, otherwise events being overwritten at that moment may be torn.
+  static void writeChromeTrace(const std::string &filepath);
+
+  // Average cost of one zone on the calling thread, recorded into a private buffer.
+  static double measureScopeOverheadNs(int iterations = 1000000);
+
+ private:
+  struct ThreadBuffer {
+    uint32_t threadId;
+    std::string threadName;
+    std::vector<Event> events = std::vector<Event>(RING_CAPACITY);
+    std::atomic<uint64_t> head{0};  // total events written, only the owning thread stores
+  };
+
+  static ThreadBuffer &threadBuffer();
+  static double ticksPerMicrosecond();
+
+  static std::mutex registryMutex;
+  static std::vector<std::shared_ptr<ThreadBuffer>> registry;
+  static uint32_t nextThreadId;  // guarded by registryMutex
+};
+
+class LveProfileScope {
+ public:
+  explicit LveProfileScope(const char *zoneName) : name{zoneName}, start{LveProfiler::now()} {}
+  ~LveProfileScope() { LveProfiler::record(name, start, LveProfiler::now()); }
+
+  LveProfileScope(const LveProfileScope &) = delete;
+  LveProfileScope &operator=(const LveProfileScope &) = delete;
+
+ private:
+  const char *name;
+  uint64_t start;
+};
+
+}  // namespace lve
+
+#define LVE_PROFILE_CONCAT_INNER(a, b) a##b
+#define LVE_PROFILE_CONCAT(a, b) LVE_PROFILE_CONCAT_INNER(a, b)
+#define LVE_PROFILE_SCOPE(name) \
+  ::lve::LveProfileScope LVE_PROFILE_CONCAT(lveProfileScope, __LINE__) { name }
+#define LVE_PROFILE_FUNCTION() LVE_PROFILE_SCOPE(__func__)
+#define LVE_PROFILE_THREAD(name) ::lve::LveProfiler::setThreadName(name)
+#define LVE_PROFILE_WRITE_TRACE(filepath) ::lve::LveProfiler::writeChromeTrace(filepath)
+
+#else
+
+#define LVE_PROFILE_SCOPE(name)
+#define LVE_PROFILE_FUNCTION()
+#define LVE_PROFILE_THREAD(name)
+#define LVE_PROFILE_WRITE_TRACE(filepath)
+
+#endif
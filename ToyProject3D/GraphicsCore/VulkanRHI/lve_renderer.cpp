@@ -1,20 +1,32 @@
 #include "lve_renderer.hpp"
+#include "lve_profiler.hpp"
+#include "lve_upload_queue.hpp"
+
+// libs
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 
 // std
 #include <array>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
 namespace lve {
 
-LveRenderer::LveRenderer(LveWindow& window, LveDevice& device)
-    : lveWindow{window}, lveDevice{device} {
+LveRenderer::LveRenderer(
+    LveWindow& window,
+    LveDevice& device,
+    const SwapChainConfigInfo& swapChainConfig,
+    int recordingThreads)
+    : lveWindow{window}, lveDevice{device}, swapChainConfig{swapChainConfig} {
   recreateSwapChain();
-  createCommandBuffers();
-  
+  commandPools = std::make_unique<LveCommandPools>(
+      lveDevice, swapChainConfig.framesInFlight, recordingThreads);
+  gpuProfiler = std::make_unique<LveGpuProfiler>(lveDevice, swapChainConfig.framesInFlight);
 }
 
-LveRenderer::~LveRenderer() { freeCommandBuffers(); }
+LveRenderer::~LveRenderer() {}
 
 void LveRenderer::recreateSwapChain() {
   auto extent = lveWindow.getExtent();
@@ -22,48 +34,46 @@ void LveRenderer::recreateSwapChain() {
     extent = lveWindow.getExtent();
     glfwWaitEvents();
   }
-  vkDeviceWaitIdle(lveDevice.device());
 
   if (lveSwapChain == nullptr) {
-    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
+    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, swapChainConfig);
   } else {
+    // no device wait: the old swap chain hands its frame fences to the new one and is only
+    // destroyed once the new one's first presented frame has finished, see RetiredSwapChain
     std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
-    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain);
+    lveSwapChain =
+        std::make_unique<LveSwapChain>(lveDevice, extent, swapChainConfig, oldSwapChain);
 
     if (!oldSwapChain->compareSwapFormats(*lveSwapChain.get())) {
       throw std::runtime_error("Swap chain image(or depth) format has changed!");
     }
+    retiredSwapChains.push_back({std::move(oldSwapChain)});
   }
 }
 
-void LveRenderer::createCommandBuffers() {
-  commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-
-  VkCommandBufferAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = lveDevice.getCommandPool();
-  allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-  if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, commandBuffers.data()) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate command buffers!");
+void LveRenderer::releaseRetiredSwapChains(uint64_t completedFrame) {
+  auto it = retiredSwapChains.begin();
+  while (it != retiredSwapChains.end()) {
+    if (it->replacementPresentFrame != 0 && it->replacementPresentFrame <= completedFrame) {
+      it = retiredSwapChains.erase(it);
+    } else {
+      ++it;
+    }
   }
 }
 
-void LveRenderer::freeCommandBuffers() {
-  vkFreeCommandBuffers(
-      lveDevice.device(),
-      lveDevice.getCommandPool(),
-      static_cast<uint32_t>(commandBuffers.size()),
-      commandBuffers.data());
-  commandBuffers.clear();
-}
-
 VkCommandBuffer LveRenderer::beginFrame() {
+  LVE_PROFILE_FUNCTION();
   assert(!isFrameStarted && "Can't call beginFrame while already in progress");
 
   auto result = lveSwapChain->acquireNextImage(&currentImageIndex);
+
+  const uint64_t completedFrame = lveSwapChain->getCompletedFrame();
+  releaseRetiredSwapChains(completedFrame);
+  lveDevice.deletionQueue().flush(lveDevice.device(), completedFrame);
+  lveDevice.uploadQueue().collect();
+  lveDevice.deletionQueue().setCurrentFrame(lveSwapChain->getCurrentFrameNumber());
+
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     recreateSwapChain();
     return nullptr;
@@ -74,25 +84,46 @@ VkCommandBuffer LveRenderer::beginFrame() {
   }
 
   isFrameStarted = true;
+  // acquire waited for the slot's previous frame, none of its command buffers are in use
+  commandPools->beginFrame(currentFrameIndex);
+  currentCommandBuffer = commandPools->allocatePrimary(0);
 
   auto commandBuffer = getCurrentCommandBuffer();
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
   if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
     throw std::runtime_error("failed to begin recording command buffer!");
   }
+  commandStats.beginFrame();
+  gpuProfiler->beginFrame(commandBuffer, currentFrameIndex);
   return commandBuffer;
 }
 
 void LveRenderer::endFrame() {
+  LVE_PROFILE_FUNCTION();
   assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
   auto commandBuffer = getCurrentCommandBuffer();
+  if (!capturePath.empty()) {
+    recordCapture(commandBuffer);
+  }
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to record command buffer!");
   }
+  // uploads recorded so far reach the graphics queue ahead of the frame that may use them
+  lveDevice.uploadQueue().flush();
 
   auto result = lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+  if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+    // this frame is the first present after any swap chain retired so far, not after the
+    // current one, which a recreate below may still retire
+    for (RetiredSwapChain& retired : retiredSwapChains) {
+      if (retired.replacementPresentFrame == 0) {
+        retired.replacementPresentFrame = lveSwapChain->getSubmittedFrame();
+      }
+    }
+  }
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
       lveWindow.wasWindowResized()) {
     lveWindow.resetWindowResizedFlag();
@@ -100,12 +131,16 @@ void LveRenderer::endFrame() {
   } else if (result != VK_SUCCESS) {
     throw std::runtime_error("failed to present swap chain image!");
   }
+  if (captureBuffer != nullptr) {
+    writeCapture();
+  }
 
   isFrameStarted = false;
-  currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+  currentFrameIndex = (currentFrameIndex + 1) % swapChainConfig.framesInFlight;
 }
 
-void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void LveRenderer::beginSwapChainRenderPass(
+    VkCommandBuffer commandBuffer, VkSubpassContents contents) {
   assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
   assert(
       commandBuffer == getCurrentCommandBuffer() &&
@@ -125,8 +160,82 @@ void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  secondaryRenderPass = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+  // executing secondaries while a query is active needs the inheritedQueries feature
+  statisticsActive = gpuProfiler->hasPipelineStatistics() &&
+                     (!secondaryRenderPass || lveDevice.supportsInheritedQueries());
+
+  renderPassZone = gpuProfiler->beginZone(commandBuffer, "RenderPass");
+  if (statisticsActive) {
+    gpuProfiler->beginStatistics(commandBuffer);
+  }
+  cmd::beginRenderPass(commandBuffer, &renderPassInfo, contents);
+  if (!secondaryRenderPass) {
+    setViewportAndScissor(commandBuffer);
+  }
+}
+
+void LveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+  assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
+  assert(
+      commandBuffer == getCurrentCommandBuffer() &&
+      "Can't end render pass on command buffer from a different frame");
+  vkCmdEndRenderPass(commandBuffer);
+  if (statisticsActive) {
+    gpuProfiler->endStatistics(commandBuffer);
+  }
+  gpuProfiler->endZone(commandBuffer, renderPassZone);
+  secondaryRenderPass = false;
+}
+
+VkCommandBuffer LveRenderer::beginSecondaryCommandBuffer(uint32_t threadIndex) {
+  assert(
+      secondaryRenderPass &&
+      "Can't begin a secondary command buffer outside of a render pass with secondary contents");
+  VkCommandBuffer commandBuffer = commandPools->allocateSecondary(threadIndex);
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = lveSwapChain->getRenderPass();
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
+  inheritanceInfo.pipelineStatistics = statisticsActive ? LveGpuProfiler::STATISTICS_FLAGS : 0;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording secondary command buffer!");
+  }
+
+  // dynamic state is not inherited from the primary
+  setViewportAndScissor(commandBuffer);
+  return commandBuffer;
+}
 
+void LveRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer) {
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
+}
+
+void LveRenderer::executeSecondaryCommandBuffers(
+    VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer> &secondaryCommandBuffers) {
+  assert(
+      secondaryRenderPass &&
+      "Can't execute secondary command buffers outside of a render pass with secondary contents");
+  if (secondaryCommandBuffers.empty()) {
+    return;
+  }
+  vkCmdExecuteCommands(
+      commandBuffer,
+      static_cast<uint32_t>(secondaryCommandBuffers.size()),
+      secondaryCommandBuffers.data());
+}
+
+void LveRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer) {
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
@@ -139,12 +248,75 @@ void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
-void LveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
-  assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-  assert(
-      commandBuffer == getCurrentCommandBuffer() &&
-      "Can't end render pass on command buffer from a different frame");
-  vkCmdEndRenderPass(commandBuffer);
+void LveRenderer::requestCapture(const std::string &path) {
+  if (!lveSwapChain->isHeadless()) {
+    throw std::runtime_error("frame capture is only supported in headless mode!");
+  }
+  capturePath = path;
+}
+
+void LveRenderer::recordCapture(VkCommandBuffer commandBuffer) {
+  // the render pass leaves headless images in TRANSFER_SRC_OPTIMAL, and its external dependency
+  // makes the color writes visible to this copy
+  const VkExtent2D extent = lveSwapChain->getSwapChainExtent();
+  captureBuffer = std::make_unique<LveBuffer>(
+      lveDevice,
+      4,
+      extent.width * extent.height,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(
+      commandBuffer,
+      lveSwapChain->getImage(currentImageIndex),
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      captureBuffer->getBuffer(),
+      1,
+      &region);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = captureBuffer->getBuffer();
+  barrier.size = VK_WHOLE_SIZE;
+  cmd::pipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      0,
+      nullptr,
+      1,
+      &barrier,
+      0,
+      nullptr);
+}
+
+void LveRenderer::writeCapture() {
+  lveSwapChain->waitForFrame(lveSwapChain->getSubmittedFrame());
+
+  const VkExtent2D extent = lveSwapChain->getSwapChainExtent();
+  captureBuffer->map();
+  if (!stbi_write_png(
+          capturePath.c_str(),
+          static_cast<int>(extent.width),
+          static_cast<int>(extent.height),
+          4,
+          captureBuffer->getMappedMemory(),
+          static_cast<int>(extent.width * 4))) {
+    throw std::runtime_error("failed to write capture " + capturePath + " !");
+  }
+  std::cout << "captured frame to " << capturePath << '\n';
+
+  captureBuffer = nullptr;
+  capturePath.clear();
 }
 
 }  // namespace lve
@@ -1,18 +1,28 @@
 #pragma once
 
+#include "lve_buffer.hpp"
+#include "lve_command_pools.hpp"
+#include "lve_command_stats.hpp"
 #include "lve_device.hpp"
+#include "lve_gpu_profiler.hpp"
 #include "lve_swap_chain.hpp"
 #include "lve_window.hpp"
 
 // std
 #include <cassert>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace lve {
 class LveRenderer {
  public:
-  LveRenderer(LveWindow &window, LveDevice &device);
+  // recordingThreads is the number of threads that may record secondary command buffers
+  LveRenderer(
+      LveWindow &window,
+      LveDevice &device,
+      const SwapChainConfigInfo &swapChainConfig = {},
+      int recordingThreads = 1);
   ~LveRenderer();
 
   LveRenderer(const LveRenderer &) = delete;
@@ -20,11 +30,20 @@ class LveRenderer {
 
   VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass(); }
   float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+  VkExtent2D getExtent() const { return lveSwapChain->getSwapChainExtent(); }
   bool isFrameInProgress() const { return isFrameStarted; }
+  uint64_t getCompletedFrame() const { return lveSwapChain->getCompletedFrame(); }
+  int getFramesInFlight() const { return swapChainConfig.framesInFlight; }
+  VkPresentModeKHR getPresentMode() const { return lveSwapChain->getPresentMode(); }
+  const SwapChainWaitStats &getWaitStats() const { return lveSwapChain->getWaitStats(); }
+  // the swap chain render pass is timed as "RenderPass", callers add zones for their own work
+  LveGpuProfiler &getGpuProfiler() { return *gpuProfiler; }
+  // counts of the frame being recorded, complete once endFrame returns
+  LveCommandStatsCollector &getCommandStats() { return commandStats; }
 
   VkCommandBuffer getCurrentCommandBuffer() const {
     assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
-    return commandBuffers[currentFrameIndex];
+    return currentCommandBuffer;
   }
 
   int getFrameIndex() const {
@@ -34,18 +53,57 @@ class LveRenderer {
 
   VkCommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the primary may only execute secondaries
+  // until endSwapChainRenderPass, so GPU zones can't be recorded inside such a pass.
+  void beginSwapChainRenderPass(
+      VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+  // Secondary command buffers continuing a render pass begun with secondary contents. Begin and
+  // end them on the thread that owns threadIndex, then execute them from the recording thread.
+  VkCommandBuffer beginSecondaryCommandBuffer(uint32_t threadIndex);
+  // room for count secondaries per thread and frame, recording up to that many never allocates
+  void reserveSecondaryCommandBuffers(size_t count) { commandPools->reserveSecondaries(count); }
+  void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+  // executes in the given order, independent of which thread finished recording first
+  void executeSecondaryCommandBuffers(
+      VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer> &secondaryCommandBuffers);
+
+  // Headless only: copies the image of the next frame to end into a PNG file. endFrame blocks
+  // until that frame has finished on the GPU.
+  void requestCapture(const std::string &path);
+
  private:
-  void createCommandBuffers();
-  void freeCommandBuffers();
   void recreateSwapChain();
+  void releaseRetiredSwapChains(uint64_t completedFrame);
+  void setViewportAndScissor(VkCommandBuffer commandBuffer);
+  void recordCapture(VkCommandBuffer commandBuffer);
+  void writeCapture();
+
+  // A replaced swap chain stays alive until a newer one has presented an image and the frame
+  // of that present has completed. Presents are processed in queue order, so by then the
+  // presentation engine is done with the replaced swap chain's images and semaphores, which
+  // its own frame fences don't tell.
+  struct RetiredSwapChain {
+    std::shared_ptr<LveSwapChain> swapChain;
+    uint64_t replacementPresentFrame = 0;  // 0 until a newer swap chain has presented
+  };
 
   LveWindow &lveWindow;
   LveDevice &lveDevice;
+  SwapChainConfigInfo swapChainConfig;
   std::unique_ptr<LveSwapChain> lveSwapChain;
-  std::vector<VkCommandBuffer> commandBuffers;
+  std::vector<RetiredSwapChain> retiredSwapChains;
+  std::unique_ptr<LveCommandPools> commandPools;
+  VkCommandBuffer currentCommandBuffer = VK_NULL_HANDLE;
+  std::unique_ptr<LveGpuProfiler> gpuProfiler;
+  LveCommandStatsCollector commandStats;
+  uint32_t renderPassZone = LveGpuProfiler::INVALID_ZONE;
+  bool statisticsActive = false;
+  bool secondaryRenderPass = false;
+
+  std::string capturePath;
+  std::unique_ptr<LveBuffer> captureBuffer;
 
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
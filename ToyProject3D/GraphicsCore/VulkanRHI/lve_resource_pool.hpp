@@ -0,0 +1,180 @@
+#pragma once
+
+#include "lve_deletion_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+// Typed 32-bit reference to an object in an LveResourcePool: the slot index in the low bits and
+// the slot's generation when the object was created in the high bits. Releasing an object bumps
+// its slot's generation, so stale handles never resolve to an object reusing the slot. A plain
+// uint32_t, so scene components copy it without refcounting and instance data can store value.
+template <typename T>
+struct LveHandle {
+  static constexpr uint32_t INDEX_BITS = 20;
+  static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  static constexpr uint32_t GENERATION_MASK = ~0u >> INDEX_BITS;
+
+  // generations start at 1, so the zero value never resolves
+  uint32_t value = 0;
+
+  static LveHandle make(uint32_t index, uint32_t generation) {
+    return LveHandle{(generation << INDEX_BITS) | index};
+  }
+
+  uint32_t getIndex() const { return value & INDEX_MASK; }
+  uint32_t getGeneration() const { return value >> INDEX_BITS; }
+  bool isNull() const { return value == 0; }
+
+  bool operator==(const LveHandle &other) const { return value == other.value; }
+  bool operator!=(const LveHandle &other) const { return value != other.value; }
+};
+
+// Owns objects of one resource type in fixed-size chunks, so they sit next to each other and
+// never move, and hands out LveHandles to them. Looking up a handle is an index into a chunk plus
+// a generation compare; get() only checks the generation in debug builds, find() always does.
+//
+// destroy() does not free the object right away: handles keep resolving until the frame being
+// recorded when it was called has completed on the GPU, like the vulkan handles in
+// LveDeletionQueue, so draws that already picked up the handle stay valid. The owner calls
+// collect() with the completed frame once per frame to release those objects.
+//
+// Creating may grow the tables and must not overlap with anything else. Destroying and collecting
+// must not overlap with each other or with lookups of the objects being released, lookups of
+// other objects may run on any thread meanwhile.
+template <typename T>
+class LveResourcePool {
+ public:
+  using Handle = LveHandle<T>;
+
+  explicit LveResourcePool(LveDeletionQueue &deletionQueue) : deletionQueue{deletionQueue} {}
+
+  // destroys every remaining object at once, their vulkan handles still go through the
+  // deletion queue
+  ~LveResourcePool() {
+    for (uint32_t index = 0; index < static_cast<uint32_t>(states.size()); index++) {
+      if (states[index] != FREE) {
+        slot(index)->~T();
+      }
+    }
+  }
+
+  LveResourcePool(const LveResourcePool &) = delete;
+  LveResourcePool &operator=(const LveResourcePool &) = delete;
+
+  template <typename... Args>
+  Handle create(Args &&...args) {
+    uint32_t index;
+    if (!freeSlots.empty()) {
+      index = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      index = static_cast<uint32_t>(states.size());
+      if (index > Handle::INDEX_MASK) {
+        throw std::runtime_error("resource pool is out of handles");
+      }
+      if (index % CHUNK_SIZE == 0) {
+        chunks.push_back(std::make_unique<Chunk>());
+      }
+      generations.push_back(1);
+      states.push_back(FREE);
+    }
+
+    try {
+      new (slot(index)) T(std::forward<Args>(args)...);
+    } catch (...) {
+      freeSlots.push_back(index);
+      throw;
+    }
+    states[index] = ALIVE;
+    aliveCount++;
+    return Handle::make(index, generations[index]);
+  }
+
+  // the object stays reachable until collect() is called with the current frame completed
+  void destroy(Handle handle) {
+    assert(isValid(handle) && "Cannot destroy a resource through a stale handle");
+    const uint32_t index = handle.getIndex();
+    assert(states[index] == ALIVE && "Resource is already being destroyed");
+    states[index] = RETIRED;
+    retired.push_back({index, deletionQueue.getCurrentFrame()});
+  }
+
+  // releases the objects destroyed in frames less than or equal to completedFrame
+  void collect(uint64_t completedFrame) {
+    auto firstPending = std::stable_partition(
+        retired.begin(),
+        retired.end(),
+        [completedFrame](const RetiredSlot &entry) { return entry.frame <= completedFrame; });
+
+    for (auto it = retired.begin(); it != firstPending; ++it) {
+      release(it->index);
+    }
+    retired.erase(retired.begin(), firstPending);
+  }
+
+  bool isValid(Handle handle) const {
+    const uint32_t index = handle.getIndex();
+    return index < generations.size() && generations[index] == handle.getGeneration();
+  }
+
+  T &get(Handle handle) {
+    assert(isValid(handle) && "Stale or null resource handle");
+    return *slot(handle.getIndex());
+  }
+
+  // null for stale and null handles
+  T *find(Handle handle) { return isValid(handle) ? slot(handle.getIndex()) : nullptr; }
+
+  // objects created and not yet released, retired ones included
+  size_t size() const { return aliveCount; }
+
+ private:
+  static constexpr uint32_t CHUNK_SIZE = 64;
+
+  enum State : uint8_t { FREE, ALIVE, RETIRED };
+
+  struct Chunk {
+    alignas(T) std::byte storage[CHUNK_SIZE][sizeof(T)];
+  };
+
+  struct RetiredSlot {
+    uint32_t index;
+    uint64_t frame;
+  };
+
+  T *slot(uint32_t index) {
+    return std::launder(
+        reinterpret_cast<T *>(chunks[index / CHUNK_SIZE]->storage[index % CHUNK_SIZE]));
+  }
+
+  void release(uint32_t index) {
+    slot(index)->~T();
+    // skips 0 on wrap around, the null handle must stay unresolvable
+    const uint32_t generation = (generations[index] + 1) & Handle::GENERATION_MASK;
+    generations[index] = generation == 0 ? 1 : generation;
+    states[index] = FREE;
+    freeSlots.push_back(index);
+    aliveCount--;
+  }
+
+  LveDeletionQueue &deletionQueue;
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  std::vector<uint32_t> generations;  // by slot index, the generation of its current object
+  std::vector<State> states;          // by slot index
+  std::vector<uint32_t> freeSlots;
+  std::vector<RetiredSlot> retired;
+  size_t aliveCount = 0;
+};
+
+}  // namespace lve
@@ -0,0 +1,213 @@
+#include "lve_scene_graph.hpp"
+
+#include "lve_transform_batch.hpp"
+
+// std
+#include <cassert>
+
+namespace lve {
+
+// levels up to this size are updated on the calling thread, a deep chain in a single pass
+constexpr size_t PARALLEL_LEVEL_GRAIN = 256;
+
+void LveSceneGraph::insert(LveEntity entity, LveEntity parent) {
+  assert(!contains(entity) && "Entity is already in the scene graph");
+  assert(
+      (parent.index == LveEntity::INVALID_INDEX || contains(parent)) &&
+      "Parent is not in the scene graph");
+  if (entity.index >= links.size()) {
+    links.resize(entity.index + 1);
+  }
+  links[entity.index] = Link{};
+  links[entity.index].generation = entity.generation;
+  links[entity.index].linked = true;
+  link(entity.index, parent.index);
+  nodeCount++;
+  orderChanged = true;
+}
+
+void LveSceneGraph::erase(LveEntity entity) {
+  assert(contains(entity) && "Entity is not in the scene graph");
+  Link &node = links[entity.index];
+  for (uint32_t child = node.firstChild; child != NONE;) {
+    const uint32_t next = links[child].nextSibling;
+    link(child, NONE);
+    child = next;
+  }
+  unlink(entity.index);
+  node.linked = false;
+  nodeCount--;
+  orderChanged = true;
+}
+
+void LveSceneGraph::setParent(LveEntity entity, LveEntity parent) {
+  assert(contains(entity) && "Entity is not in the scene graph");
+  assert(
+      (parent.index == LveEntity::INVALID_INDEX || contains(parent)) &&
+      "Parent is not in the scene graph");
+  for (uint32_t ancestor = parent.index; ancestor != NONE; ancestor = links[ancestor].parent) {
+    assert(ancestor != entity.index && "Cannot parent an entity to its own subtree");
+  }
+  unlink(entity.index);
+  link(entity.index, parent.index);
+  orderChanged = true;
+}
+
+bool LveSceneGraph::contains(LveEntity entity) const {
+  return entity.index < links.size() && links[entity.index].linked &&
+         links[entity.index].generation == entity.generation;
+}
+
+LveEntity LveSceneGraph::getParent(LveEntity entity) const {
+  assert(contains(entity) && "Entity is not in the scene graph");
+  const uint32_t parent = links[entity.index].parent;
+  return parent == NONE ? LveEntity{} : LveEntity{parent, links[parent].generation};
+}
+
+void LveSceneGraph::link(uint32_t index, uint32_t parent) {
+  Link &node = links[index];
+  node.parent = parent;
+  node.nextSibling = NONE;
+  uint32_t &first = parent == NONE ? firstRoot : links[parent].firstChild;
+  uint32_t &last = parent == NONE ? lastRoot : links[parent].lastChild;
+  node.previousSibling = last;
+  if (last != NONE) {
+    links[last].nextSibling = index;
+  } else {
+    first = index;
+  }
+  last = index;
+}
+
+void LveSceneGraph::unlink(uint32_t index) {
+  Link &node = links[index];
+  uint32_t &first = node.parent == NONE ? firstRoot : links[node.parent].firstChild;
+  uint32_t &last = node.parent == NONE ? lastRoot : links[node.parent].lastChild;
+  if (node.previousSibling != NONE) {
+    links[node.previousSibling].nextSibling = node.nextSibling;
+  } else {
+    first = node.nextSibling;
+  }
+  if (node.nextSibling != NONE) {
+    links[node.nextSibling].previousSibling = node.previousSibling;
+  } else {
+    last = node.previousSibling;
+  }
+  node.parent = node.previousSibling = node.nextSibling = NONE;
+}
+
+void LveSceneGraph::rebuildOrder() {
+  order.clear();
+  parents.clear();
+  levelStarts.clear();
+  order.reserve(nodeCount);
+  parents.reserve(nodeCount);
+
+  // the arrays double as the queue, a level ends where the first child of the next one starts
+  for (uint32_t root = firstRoot; root != NONE; root = links[root].nextSibling) {
+    order.push_back({root, links[root].generation});
+    parents.push_back(NONE);
+  }
+  size_t levelEnd = 0;
+  for (size_t position = 0; position < order.size(); position++) {
+    if (position == levelEnd) {
+      levelStarts.push_back(static_cast<uint32_t>(position));
+      levelEnd = order.size();
+    }
+    for (uint32_t child = links[order[position].index].firstChild; child != NONE;
+         child = links[child].nextSibling) {
+      order.push_back({child, links[child].generation});
+      parents.push_back(static_cast<uint32_t>(position));
+    }
+  }
+  levelStarts.push_back(static_cast<uint32_t>(order.size()));
+  assert(order.size() == nodeCount && "Scene graph links are inconsistent");
+
+  transformPositions.assign(nodeCount, 0);
+  worldPositions.assign(nodeCount, 0);
+  localMatrices.resize(nodeCount);
+  localNormalMatrices.resize(nodeCount);
+  worldMatrices.resize(nodeCount);
+  worldNormalMatrices.resize(nodeCount);
+  dirty.resize(nodeCount);
+  orderChanged = false;
+  recomputeAll = true;
+}
+
+void LveSceneGraph::update(LveEntityRegistry &registry, LveJobSystem &jobSystem) {
+  if (orderChanged) {
+    rebuildOrder();
+  }
+  // created here, the pools must not be added to while jobs look into them
+  LveComponentPool<TransformComponent> &transforms = registry.pool<TransformComponent>();
+  LveComponentPool<WorldTransformComponent> &worlds = registry.pool<WorldTransformComponent>();
+
+  // Each level only reads the ones above, so the jobs of a level finish before the next starts.
+  // Runs of small levels go through one updateRange, it visits parents before their children.
+  size_t serialFirst = 0;
+  for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+    const size_t first = levelStarts[level];
+    const size_t last = levelStarts[level + 1];
+    if (last - first <= PARALLEL_LEVEL_GRAIN) {
+      continue;
+    }
+    updateRange(transforms, worlds, serialFirst, first);
+    jobSystem.parallelFor(first, last, PARALLEL_LEVEL_GRAIN, [&](size_t begin, size_t end) {
+      updateRange(transforms, worlds, begin, end);
+    });
+    serialFirst = last;
+  }
+  updateRange(transforms, worlds, serialFirst, order.size());
+  recomputeAll = false;
+}
+
+void LveSceneGraph::updateRange(
+    LveComponentPool<TransformComponent> &transforms,
+    LveComponentPool<WorldTransformComponent> &worlds,
+    size_t first,
+    size_t last) {
+  // local matrices of patched transforms, batched
+  LveTransformBatch batch;
+  for (size_t position = first; position < last; position++) {
+    const uint32_t transform = transforms.find(order[position].index, transformPositions[position]);
+    assert(
+        transform != LveComponentPool<TransformComponent>::ABSENT &&
+        "Scene graph node has no TransformComponent");
+    transformPositions[position] = transform;
+
+    const bool changed = recomputeAll || transforms.isChanged(transform);
+    if (changed) {
+      batch.add(
+          transforms.at(transform), &localMatrices[position], &localNormalMatrices[position]);
+      transforms.clearChanged(transform);
+    }
+    const uint32_t parent = parents[position];
+    dirty[position] = changed || (parent != NONE && dirty[parent]);
+  }
+  batch.flush();
+
+  // world matrices of everything patched or below something patched; the inverse transpose of
+  // a product is the product of the inverse transposes, so normal matrices compose the same way
+  for (size_t position = first; position < last; position++) {
+    if (!dirty[position]) {
+      continue;
+    }
+    const uint32_t parent = parents[position];
+    if (parent == NONE) {
+      worldMatrices[position] = localMatrices[position];
+      worldNormalMatrices[position] = localNormalMatrices[position];
+    } else {
+      worldMatrices[position] = worldMatrices[parent] * localMatrices[position];
+      worldNormalMatrices[position] = worldNormalMatrices[parent] * localNormalMatrices[position];
+    }
+
+    const uint32_t world = worlds.find(order[position].index, worldPositions[position]);
+    if (world != LveComponentPool<WorldTransformComponent>::ABSENT) {
+      worldPositions[position] = world;
+      worlds.at(world) = {worldMatrices[position], worldNormalMatrices[position]};
+      worlds.markChanged(world);
+    }
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "lve_components.hpp"
+#include "lve_entity_registry.hpp"
+#include "lve_job_system.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Parent links between scene entities and the pass that turns their local TransformComponents
+// into WorldTransformComponents.
+//
+// Nodes are kept breadth-first in contiguous arrays, every parent before its children and each
+// depth level in one range, so the update is a linear pass per level. Only nodes whose
+// TransformComponent was patched, and everything below them, are recomputed; levels with enough
+// nodes are split across the job system, since nodes of one level never depend on each other.
+//
+// Every node needs a TransformComponent. WorldTransformComponent is optional, nodes without one
+// only carry their world matrix to their children, e.g. a group without a model. Rewritten
+// WorldTransformComponents are flagged changed for whoever consumes them next. Destroying an
+// entity in the registry does not remove it from the graph, erase it first.
+class LveSceneGraph {
+ public:
+  LveSceneGraph() = default;
+
+  LveSceneGraph(const LveSceneGraph &) = delete;
+  LveSceneGraph &operator=(const LveSceneGraph &) = delete;
+
+  // adds entity as the last child of parent, or as a root if parent is the default LveEntity
+  void insert(LveEntity entity, LveEntity parent = {});
+  // removes entity, its children become roots
+  void erase(LveEntity entity);
+  // moves entity with its subtree, the local transform is kept and the world one changes
+  void setParent(LveEntity entity, LveEntity parent);
+
+  bool contains(LveEntity entity) const;
+  LveEntity getParent(LveEntity entity) const;
+  size_t size() const { return nodeCount; }
+  // depth of the deepest node plus one, as of the last update
+  size_t getLevelCount() const { return levelStarts.empty() ? 0 : levelStarts.size() - 1; }
+
+  // Recomputes the world matrices of changed subtrees. Must not overlap with anything else
+  // touching the registry's TransformComponents or WorldTransformComponents.
+  void update(LveEntityRegistry &registry, LveJobSystem &jobSystem);
+
+ private:
+  static constexpr uint32_t NONE = ~0u;
+
+  // tree links by entity index, siblings in insertion order
+  struct Link {
+    uint32_t generation = 0;
+    bool linked = false;
+    uint32_t parent = NONE;
+    uint32_t firstChild = NONE;
+    uint32_t lastChild = NONE;
+    uint32_t previousSibling = NONE;
+    uint32_t nextSibling = NONE;
+  };
+
+  void link(uint32_t index, uint32_t parent);
+  void unlink(uint32_t index);
+  void rebuildOrder();
+  void updateRange(
+      LveComponentPool<TransformComponent> &transforms,
+      LveComponentPool<WorldTransformComponent> &worlds,
+      size_t first,
+      size_t last);
+
+  std::vector<Link> links;
+  uint32_t firstRoot = NONE;
+  uint32_t lastRoot = NONE;
+  size_t nodeCount = 0;
+  bool orderChanged = false;
+  // after a rebuild the cached local matrices no longer match their positions
+  bool recomputeAll = false;
+
+  // breadth-first, by position
+  std::vector<LveEntity> order;
+  std::vector<uint32_t> parents;  // position of the parent, NONE for roots
+  std::vector<uint32_t> levelStarts;
+  std::vector<uint32_t> transformPositions;  // last seen pool positions, tried before lookups
+  std::vector<uint32_t> worldPositions;
+  std::vector<glm::mat4> localMatrices;
+  std::vector<glm::mat3> localNormalMatrices;
+  std::vector<glm::mat4> worldMatrices;
+  std::vector<glm::mat3> worldNormalMatrices;
+  std::vector<uint8_t> dirty;  // recomputed this update, read by the children
+};
+
+}  // namespace lve
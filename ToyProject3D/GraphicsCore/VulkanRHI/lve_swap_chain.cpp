@@ -1,29 +1,51 @@
 #include "lve_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
-#include <iostream>
 #include <limits>
 #include <set>
 #include <stdexcept>
 
 namespace lve {
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+LveSwapChain::LveSwapChain(
+    LveDevice &deviceRef, VkExtent2D extent, const SwapChainConfigInfo &configInfo)
+    : device{deviceRef}, windowExtent{extent}, config{configInfo} {
   init();
 }
 
 LveSwapChain::LveSwapChain(
-    LveDevice &deviceRef, VkExtent2D extent, std::shared_ptr<LveSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+    LveDevice &deviceRef,
+    VkExtent2D extent,
+    const SwapChainConfigInfo &configInfo,
+    std::shared_ptr<LveSwapChain> previous)
+    : device{deviceRef}, windowExtent{extent}, config{configInfo}, oldSwapChain{previous} {
+  assert(
+      previous->config.framesInFlight == config.framesInFlight &&
+      "Frames in flight can't change when recreating the swap chain");
+  adoptSyncObjects(*previous);
   init();
   oldSwapChain = nullptr;
 }
 
 void LveSwapChain::init() {
+  if (config.framesInFlight < MIN_FRAMES_IN_FLIGHT || config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+    throw std::invalid_argument("frames in flight must be between 1 and 4!");
+  }
   createSwapChain();
   createImageViews();
   createRenderPass();
@@ -43,34 +65,50 @@ LveSwapChain::~LveSwapChain() {
     swapChain = nullptr;
   }
 
-  for (int i = 0; i < depthImages.size(); i++) {
-    vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+  // offscreen images of the headless path, swap chain images are owned by the swap chain
+  for (size_t i = 0; i < offscreenImageMemory.size(); i++) {
+    vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+    vkFreeMemory(device.device(), offscreenImageMemory[i], nullptr);
   }
 
+  vkDestroyImageView(device.device(), depthImageView, nullptr);
+  vkDestroyImage(device.device(), depthImage, nullptr);
+  vkFreeMemory(device.device(), depthImageMemory, nullptr);
+
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
   }
 
   vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  // cleanup synchronization objects (empty if they were handed over to a newer swap chain)
+  for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+  }
+  for (auto fence : inFlightFences) {
+    vkDestroyFence(device.device(), fence, nullptr);
+  }
+  if (frameTimeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(device.device(), frameTimeline, nullptr);
   }
 }
 
 VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      device.device(),
-      1,
-      &inFlightFences[currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
+  waitStats = {};
+
+  // the frame that last used this slot has to finish before its resources are reused
+  auto waitStart = std::chrono::steady_clock::now();
+  waitForFrame(frameSlotValues[currentFrame]);
+  waitStats.frameWaitMs = elapsedMs(waitStart);
 
+  if (isHeadless()) {
+    // offscreen images are used round robin, one per frame in flight
+    *imageIndex = static_cast<uint32_t>(currentFrame);
+    return VK_SUCCESS;
+  }
+
+  auto acquireStart = std::chrono::steady_clock::now();
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
@@ -78,37 +116,64 @@ VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
       imageAvailableSemaphores[currentFrame],  // must be a not signaled semaphore
       VK_NULL_HANDLE,
       imageIndex);
+  waitStats.acquireWaitMs = elapsedMs(acquireStart);
 
   return result;
 }
 
 VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-  if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-  }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+  // the image may still be in use by an older frame if images are acquired out of order
+  auto waitStart = std::chrono::steady_clock::now();
+  waitForFrame(imageFrameValues[*imageIndex]);
+  waitStats.imageWaitMs = elapsedMs(waitStart);
+
+  const uint64_t frameValue = submittedFrame + 1;
+  imageFrameValues[*imageIndex] = frameValue;
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+  // headless frames have no acquire to wait for
   VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
   VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.waitSemaphoreCount = isHeadless() ? 0 : 1;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = buffers;
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+  // the binary semaphore is waited on by present, the timeline value marks the frame as done.
+  // Headless frames are never presented and only signal the timeline.
+  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame], frameTimeline};
+  uint64_t signalValues[] = {0, frameValue};
+  const uint32_t firstSignal = isHeadless() ? 1 : 0;
+  submitInfo.pSignalSemaphores = signalSemaphores + firstSignal;
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  VkFence submitFence = VK_NULL_HANDLE;
+  if (frameTimeline != VK_NULL_HANDLE) {
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 2 - firstSignal;
+    timelineInfo.pSignalSemaphoreValues = signalValues + firstSignal;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = 2 - firstSignal;
+  } else {
+    submitInfo.signalSemaphoreCount = 1 - firstSignal;
+    submitFence = inFlightFences[currentFrame];
+    vkResetFences(device.device(), 1, &submitFence);
+  }
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-      VK_SUCCESS) {
+  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, submitFence) != VK_SUCCESS) {
     throw std::runtime_error("failed to submit draw command buffer!");
   }
+  frameSlotValues[currentFrame] = frameValue;
+  submittedFrame = frameValue;
+
+  if (isHeadless()) {
+    currentFrame = (currentFrame + 1) % config.framesInFlight;
+    return VK_SUCCESS;
+  }
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -124,19 +189,94 @@ VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint
 
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % config.framesInFlight;
 
   return result;
 }
 
+uint64_t LveSwapChain::getCompletedFrame() {
+  if (frameTimeline != VK_NULL_HANDLE) {
+    uint64_t value = 0;
+    if (device.getSemaphoreCounterValue(frameTimeline, &value) == VK_SUCCESS) {
+      completedFrame = std::max(completedFrame, value);
+    }
+    return completedFrame;
+  }
+
+  // fence fallback: frames complete in submission order, so advance through the slots from the
+  // oldest pending frame and stop at the first one that is still running
+  while (completedFrame < submittedFrame) {
+    const size_t slot = findFrameSlot(completedFrame + 1);
+    if (slot == frameSlotValues.size()) {
+      // slot was already reused, which means the frame has been waited for
+      completedFrame++;
+      continue;
+    }
+    if (vkGetFenceStatus(device.device(), inFlightFences[slot]) != VK_SUCCESS) {
+      break;
+    }
+    completedFrame = frameSlotValues[slot];
+  }
+  return completedFrame;
+}
+
+void LveSwapChain::waitForFrame(uint64_t frame) {
+  if (frame == 0 || frame <= completedFrame) {
+    return;
+  }
+  assert(frame <= submittedFrame && "Cannot wait for a frame that has not been submitted");
+
+  if (frameTimeline != VK_NULL_HANDLE) {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &frameTimeline;
+    waitInfo.pValues = &frame;
+    device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+    completedFrame = std::max(completedFrame, frame);
+    return;
+  }
+
+  // wait for every slot holding a frame up to the requested one, older frames in reused slots
+  // have already been waited for
+  for (size_t slot = 0; slot < frameSlotValues.size(); slot++) {
+    if (frameSlotValues[slot] > completedFrame && frameSlotValues[slot] <= frame) {
+      vkWaitForFences(
+          device.device(),
+          1,
+          &inFlightFences[slot],
+          VK_TRUE,
+          std::numeric_limits<uint64_t>::max());
+    }
+  }
+  completedFrame = frame;
+}
+
+size_t LveSwapChain::findFrameSlot(uint64_t frame) const {
+  for (size_t i = 0; i < frameSlotValues.size(); i++) {
+    if (frameSlotValues[i] == frame) {
+      return i;
+    }
+  }
+  return frameSlotValues.size();
+}
+
 void LveSwapChain::createSwapChain() {
+  if (isHeadless()) {
+    createOffscreenImages();
+    return;
+  }
+
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  // one image more than the minimum, and enough for every frame in flight to own one
+  uint32_t imageCount = std::max(
+      swapChainSupport.capabilities.minImageCount + 1,
+      static_cast<uint32_t>(config.framesInFlight));
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -190,6 +330,40 @@ void LveSwapChain::createSwapChain() {
   swapChainExtent = extent;
 }
 
+void LveSwapChain::createOffscreenImages() {
+  // stands in for the swap chain without a surface: one color image per frame in flight that
+  // the renderer can copy out of after the render pass
+  swapChain = VK_NULL_HANDLE;
+  presentMode = VK_PRESENT_MODE_FIFO_KHR;
+  swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+  swapChainExtent = windowExtent;
+
+  swapChainImages.resize(config.framesInFlight);
+  offscreenImageMemory.resize(config.framesInFlight);
+  for (size_t i = 0; i < swapChainImages.size(); i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = swapChainExtent.width;
+    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    device.createImageWithInfo(
+        imageInfo,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        swapChainImages[i],
+        offscreenImageMemory[i]);
+  }
+}
+
 void LveSwapChain::createImageViews() {
   swapChainImageViews.resize(swapChainImages.size());
 
@@ -221,7 +395,8 @@ void LveSwapChain::createRenderPass() {
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAttachment.finalLayout =
+      isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference colorAttachmentRef = {};
   colorAttachmentRef.attachment = 0;
@@ -233,6 +408,8 @@ void LveSwapChain::createRenderPass() {
   subpass.pColorAttachments = &colorAttachmentRef;
   subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+  // the depth image is shared between frames in flight, so the clear of this frame has to wait
+  // for the depth writes (late fragment tests) of the previous frame
   VkSubpassDependency dependency = {};
   dependency.dstSubpass = 0;
   dependency.dstAccessMask =
@@ -240,10 +417,21 @@ void LveSwapChain::createRenderPass() {
   dependency.dstStageMask =
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.srcAccessMask = 0;
-  dependency.srcStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-
+  dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+  // headless: color writes have to land before the image is copied out
+  VkSubpassDependency captureDependency = {};
+  captureDependency.srcSubpass = 0;
+  captureDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  captureDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  captureDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  captureDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  captureDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::array<VkSubpassDependency, 2> dependencies = {dependency, captureDependency};
   std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
   VkRenderPassCreateInfo renderPassInfo = {};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -251,8 +439,8 @@ void LveSwapChain::createRenderPass() {
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.dependencyCount = isHeadless() ? 2 : 1;
+  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
@@ -262,7 +450,7 @@ void LveSwapChain::createRenderPass() {
 void LveSwapChain::createFramebuffers() {
   swapChainFramebuffers.resize(imageCount());
   for (size_t i = 0; i < imageCount(); i++) {
-    std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
+    std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageView};
 
     VkExtent2D swapChainExtent = getSwapChainExtent();
     VkFramebufferCreateInfo framebufferInfo = {};
@@ -289,61 +477,109 @@ void LveSwapChain::createDepthResources() {
   swapChainDepthFormat = depthFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
-
-  for (int i = 0; i < depthImages.size(); i++) {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = swapChainExtent.width;
-    imageInfo.extent.height = swapChainExtent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = depthFormat;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.flags = 0;
-
-    device.createImageWithInfo(
-        imageInfo,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        depthImages[i],
-        depthImageMemorys[i]);
-
-	device.createImageView(depthImages[i], depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, depthImageViews[i]);
-  }
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = swapChainExtent.width;
+  imageInfo.extent.height = swapChainExtent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = depthFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  // depth is cleared on load and never stored, so tile based GPUs never need to back it
+  imageInfo.usage =
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+
+  device.createImageWithInfo(
+      imageInfo,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      depthImage,
+      depthImageMemory,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+  device.createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, depthImageView);
 }
 
 void LveSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  imageFrameValues.assign(imageCount(), 0);
+  if (!imageAvailableSemaphores.empty()) {
+    // adopted from the previous swap chain
+    return;
+  }
+
+  const size_t framesInFlight = static_cast<size_t>(config.framesInFlight);
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  frameSlotValues.assign(framesInFlight, 0);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+  for (size_t i = 0; i < framesInFlight; i++) {
+    if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
+            VK_SUCCESS ||
+        vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
+            VK_SUCCESS) {
+      throw std::runtime_error("failed to create synchronization objects for a frame!");
+    }
+  }
+
+  if (device.supportsTimelineSemaphores()) {
+    // a single timeline tracks every frame, signaled with the frame number on submit
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo timelineSemaphoreInfo = {};
+    timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineSemaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(device.device(), &timelineSemaphoreInfo, nullptr, &frameTimeline) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create frame timeline semaphore!");
+    }
+    return;
+  }
+
   VkFenceCreateInfo fenceInfo = {};
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+  inFlightFences.resize(framesInFlight);
+  for (size_t i = 0; i < framesInFlight; i++) {
+    if (vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create synchronization objects for a frame!");
     }
   }
 }
 
+// Frames submitted on the previous swap chain may still be executing. Taking over its frame
+// timeline (or fences) and semaphores means the next frame that reuses a slot waits for exactly
+// that frame, instead of draining the whole device before the swap chain can be rebuilt.
+void LveSwapChain::adoptSyncObjects(LveSwapChain &previous) {
+  imageAvailableSemaphores = std::move(previous.imageAvailableSemaphores);
+  renderFinishedSemaphores = std::move(previous.renderFinishedSemaphores);
+  inFlightFences = std::move(previous.inFlightFences);
+  frameSlotValues = std::move(previous.frameSlotValues);
+  frameTimeline = previous.frameTimeline;
+  submittedFrame = previous.submittedFrame;
+  completedFrame = previous.completedFrame;
+  currentFrame = previous.currentFrame;
+
+  previous.imageAvailableSemaphores.clear();
+  previous.renderFinishedSemaphores.clear();
+  previous.inFlightFences.clear();
+  previous.frameSlotValues.clear();
+  previous.imageFrameValues.clear();
+  previous.frameTimeline = VK_NULL_HANDLE;
+}
+
 VkSurfaceFormatKHR LveSwapChain::chooseSwapSurfaceFormat(
     const std::vector<VkSurfaceFormatKHR> &availableFormats) {
   for (const auto &availableFormat : availableFormats) {
@@ -358,24 +594,48 @@ VkSurfaceFormatKHR LveSwapChain::chooseSwapSurfaceFormat(
 
 VkPresentModeKHR LveSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
-  for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      std::cout << "Present mode: Mailbox" << std::endl;
-      return availablePresentMode;
-    }
+  std::vector<VkPresentModeKHR> preferredModes;
+  switch (config.presentModePolicy) {
+    case PresentModePolicy::LowLatency:
+      preferredModes = {VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
+    case PresentModePolicy::Throughput:
+      preferredModes = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+      break;
+    case PresentModePolicy::VSync:
+      break;
+    case PresentModePolicy::Immediate:
+      preferredModes = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
   }
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  // }
+  for (auto preferredMode : preferredModes) {
+    for (const auto &availablePresentMode : availablePresentModes) {
+      if (availablePresentMode == preferredMode) {
+        return availablePresentMode;
+      }
+    }
+  }
 
-  std::cout << "Present mode: V-Sync" << std::endl;
+  // FIFO is the only mode that is required to be supported
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char *LveSwapChain::presentModeName(VkPresentModeKHR presentMode) {
+  switch (presentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+      return "V-Sync";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      return "Relaxed V-Sync";
+    default:
+      return "Unknown";
+  }
+}
+
 VkExtent2D LveSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
     return capabilities.currentExtent;
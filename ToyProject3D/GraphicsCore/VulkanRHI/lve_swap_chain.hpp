@@ -12,13 +12,36 @@
 
 namespace lve {
 
+// How the present mode is picked from what the surface supports, in order of preference:
+//  LowLatency: MAILBOX -> FIFO          (newest frame wins, no tearing)
+//  Throughput: FIFO_RELAXED -> FIFO     (keeps the queue full, tears only when late)
+//  VSync:      FIFO                     (always available)
+//  Immediate:  IMMEDIATE -> MAILBOX -> FIFO (lowest latency, tears)
+enum class PresentModePolicy { LowLatency, Throughput, VSync, Immediate };
+
+struct SwapChainConfigInfo {
+  int framesInFlight = 2;
+  PresentModePolicy presentModePolicy = PresentModePolicy::LowLatency;
+};
+
+// CPU time spent blocked inside the swap chain during the last frame
+struct SwapChainWaitStats {
+  double frameWaitMs = 0.0;    // waiting for the frame that last used the current slot
+  double acquireWaitMs = 0.0;  // vkAcquireNextImageKHR
+  double imageWaitMs = 0.0;    // waiting for an older frame still rendering to the acquired image
+};
+
 class LveSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  static constexpr int MIN_FRAMES_IN_FLIGHT = 1;
+  static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
 
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
+  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, const SwapChainConfigInfo &configInfo);
   LveSwapChain(
-      LveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous);
+      LveDevice &deviceRef,
+      VkExtent2D windowExtent,
+      const SwapChainConfigInfo &configInfo,
+      std::shared_ptr<LveSwapChain> previous);
 
   ~LveSwapChain();
 
@@ -28,9 +51,13 @@ class LveSwapChain {
   VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
   VkRenderPass getRenderPass() { return renderPass; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  VkImage getImage(int index) { return swapChainImages[index]; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
+  int getFramesInFlight() const { return config.framesInFlight; }
+  VkPresentModeKHR getPresentMode() const { return presentMode; }
+  const SwapChainWaitStats &getWaitStats() const { return waitStats; }
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
 
@@ -42,6 +69,21 @@ class LveSwapChain {
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
+  // Frames are numbered from 1 in submission order, 0 means "no frame".
+  // getCurrentFrameNumber is the frame being recorded, getCompletedFrame the newest frame the
+  // GPU has finished, without blocking. Allocators and deletion queues key off these values.
+  uint64_t getCurrentFrameNumber() const { return submittedFrame + 1; }
+  uint64_t getSubmittedFrame() const { return submittedFrame; }
+  uint64_t getCompletedFrame();
+  void waitForFrame(uint64_t frame);
+  bool usesTimelineSemaphore() const { return frameTimeline != VK_NULL_HANDLE; }
+
+  // Without a surface the images are plain offscreen images left in TRANSFER_SRC_OPTIMAL,
+  // acquire hands them out round robin and submit skips present.
+  bool isHeadless() const { return device.isHeadless(); }
+
+  static const char *presentModeName(VkPresentModeKHR presentMode);
+
   bool compareSwapFormats(const LveSwapChain &swapChain) const {
     return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
            swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -50,11 +92,14 @@ class LveSwapChain {
  private:
   void init();
   void createSwapChain();
+  void createOffscreenImages();
   void createImageViews();
   void createDepthResources();
   void createRenderPass();
   void createFramebuffers();
   void createSyncObjects();
+  void adoptSyncObjects(LveSwapChain &previous);
+  size_t findFrameSlot(uint64_t frame) const;
 
   // Helper functions
   VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -70,22 +115,35 @@ class LveSwapChain {
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
 
-  std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
-  std::vector<VkImageView> depthImageViews;
+  // a single depth attachment is shared by every framebuffer, the render pass dependency
+  // orders depth writes of consecutive frames so no per-image copies are needed
+  VkImage depthImage = VK_NULL_HANDLE;
+  VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+  VkImageView depthImageView = VK_NULL_HANDLE;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
+  std::vector<VkDeviceMemory> offscreenImageMemory;
 
   LveDevice &device;
   VkExtent2D windowExtent;
+  SwapChainConfigInfo config;
+  VkPresentModeKHR presentMode;
+  SwapChainWaitStats waitStats{};
 
   VkSwapchainKHR swapChain;
   std::shared_ptr<LveSwapChain> oldSwapChain;
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
+
+  // frame pacing: a timeline semaphore signaled with the frame number, or one fence per frame
+  // slot on devices without timeline semaphore support
+  VkSemaphore frameTimeline = VK_NULL_HANDLE;
   std::vector<VkFence> inFlightFences;
-  std::vector<VkFence> imagesInFlight;
+  std::vector<uint64_t> frameSlotValues;   // last frame submitted in each slot
+  std::vector<uint64_t> imageFrameValues;  // last frame that rendered to each image
+  uint64_t submittedFrame = 0;
+  uint64_t completedFrame = 0;
   size_t currentFrame = 0;
 };
 
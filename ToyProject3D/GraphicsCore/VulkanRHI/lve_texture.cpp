@@ -1,5 +1,7 @@
 
 #include "lve_texture.hpp"
+#include "lve_profiler.hpp"
+#include "lve_upload_queue.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -9,56 +11,54 @@
 
 namespace lve {
 
-	LveTexture::LveTexture(LveDevice& device) : lveDevice(device) {
-		createTexture(DEFAULT_TEXTURE_PATH);
-		createTextureImageView(textureImage);
-		createTextureSampler();
-	}
+	LveTexture::LveTexture(LveDevice& device) : LveTexture(device, DEFAULT_TEXTURE_PATH) {}
 
-	LveTexture::LveTexture(LveDevice & device, const std::string & filepath) : lveDevice(device) {
-		createTexture(filepath);
+	LveTexture::LveTexture(LveDevice & device, const std::string & filepath)
+		: LveTexture(device, decodeFile(filepath)) {}
+
+	LveTexture::LveTexture(LveDevice& device, const ImageData& image) : lveDevice(device) {
+		createTexture(image);
 		createTextureImageView(textureImage);
 		createTextureSampler();
 	}
 
 	LveTexture::~LveTexture() {
-
-		vkDestroySampler(lveDevice.device(), textureSampler, nullptr);
-		if (textureImageView != nullptr)
-			vkDestroyImageView(lveDevice.device(), textureImageView, nullptr);
+		// frames in flight may still sample from this texture
+		auto& deletionQueue = lveDevice.deletionQueue();
+		deletionQueue.destroySampler(textureSampler);
+		deletionQueue.destroyImageView(textureImageView);
+		deletionQueue.destroyImage(textureImage);
+		deletionQueue.freeMemory(textureImageMemory);
 	}
 
 	std::unique_ptr<LveTexture> LveTexture::createTextureFromFile(LveDevice &device, const std::string &filepath) {
 		return std::make_unique<LveTexture>(device, filepath);
 	}
 
-	std::string LveTexture::DEFAULT_TEXTURE_PATH = std::filesystem::current_path().string() + "/ToyProject3D/Resources/Textures/checker.jpg";
+	void LveTexture::PixelDeleter::operator()(unsigned char* pixels) const {
+		stbi_image_free(pixels);
+	}
 
-	void LveTexture::createTexture(const std::string &filepath) {
+	LveTexture::ImageData LveTexture::decodeFile(const std::string& filepath) {
+		LVE_PROFILE_FUNCTION();
 
-		int texWidth, texHeight, texChannels;
-		stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-		VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-		if (!pixels) {
-			throw std::runtime_error("failed to load texture image!");
+		ImageData image{};
+		int texChannels;
+		image.pixels.reset(stbi_load(filepath.c_str(), &image.width, &image.height, &texChannels, STBI_rgb_alpha));
+		if (!image.pixels) {
+			throw std::runtime_error("failed to load texture image: " + filepath);
 		}
+		return image;
+	}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		lveDevice.createBuffer(
-			imageSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingBufferMemory);
+	std::string LveTexture::DEFAULT_TEXTURE_PATH = std::filesystem::current_path().string() + "/ToyProject3D/Resources/Textures/checker.jpg";
 
-		void* data;
-		vkMapMemory(lveDevice.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		vkUnmapMemory(lveDevice.device(), stagingBufferMemory);
+	void LveTexture::createTexture(const ImageData &image) {
+		LVE_PROFILE_FUNCTION();
 
-		stbi_image_free(pixels);
+		const int texWidth = image.width;
+		const int texHeight = image.height;
+		VkDeviceSize imageSize = texWidth * texHeight * 4;
 
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -81,15 +81,13 @@ namespace lve {
 			textureImage,
 			textureImageMemory);
 
-		lveDevice.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-		lveDevice.copyBufferToImage(stagingBuffer, textureImage,
-			static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1);
-
-		lveDevice.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		
+		// asynchronous, the image is ready for frames submitted after the upload queue's next flush
+		lveDevice.uploadQueue().uploadImage(
+			image.pixels.get(),
+			imageSize,
+			textureImage,
+			static_cast<uint32_t>(texWidth),
+			static_cast<uint32_t>(texHeight));
 	}
 
 	void LveTexture::createTextureImageView(VkImage image)
@@ -108,9 +106,13 @@ namespace lve {
 		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 
-		samplerInfo.anisotropyEnable = VK_TRUE;
-
-		samplerInfo.maxAnisotropy = lveDevice .properties.limits.maxSamplerAnisotropy;
+		if (lveDevice.supportsSamplerAnisotropy()) {
+			samplerInfo.anisotropyEnable = VK_TRUE;
+			samplerInfo.maxAnisotropy = lveDevice.properties.limits.maxSamplerAnisotropy;
+		} else {
+			samplerInfo.anisotropyEnable = VK_FALSE;
+			samplerInfo.maxAnisotropy = 1.0f;
+		}
 		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 		samplerInfo.unnormalizedCoordinates = VK_FALSE;
 		samplerInfo.compareEnable = VK_FALSE;
@@ -1,23 +1,38 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_resource_pool.hpp"
 
 //std
 #include <memory>
+#include <string>
 
 namespace lve {
 
 class LveTexture {
 
 public:
+	struct PixelDeleter {
+		void operator()(unsigned char *pixels) const;
+	};
+
+	// decoded RGBA8 pixels, produced without touching the device so decoding can run on any thread
+	struct ImageData {
+		int width = 0;
+		int height = 0;
+		std::unique_ptr<unsigned char, PixelDeleter> pixels;
+	};
+
 	LveTexture(LveDevice &device);
 	LveTexture(LveDevice &device, const std::string &filepath);
+	LveTexture(LveDevice &device, const ImageData &image);
 	~LveTexture();
 
 	LveTexture(const LveTexture &) = delete;
 	LveTexture &operator=(const LveTexture &) = delete;
 
 	static std::unique_ptr<LveTexture> createTextureFromFile(LveDevice &device, const std::string &filepath);
+	static ImageData decodeFile(const std::string &filepath);
 
 	VkDescriptorImageInfo descriptorInfo();
 
@@ -27,7 +42,7 @@ public:
 	static std::string DEFAULT_TEXTURE_PATH;
 
 private:
-	void createTexture(const std::string &filepath);
+	void createTexture(const ImageData &image);
 	void createTextureImageView(VkImage image);
 	void createTextureSampler();
 
@@ -37,4 +52,6 @@ private:
 	VkDeviceMemory textureImageMemory;
 
 };
+
+using LveTextureHandle = LveHandle<LveTexture>;
 }
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "lve_transform_batch.hpp"
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define LVE_TRANSFORM_BATCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_TRANSFORM_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+namespace {
+
+// Lane types: Floats holds one float per object of a step, Ints the matching 32 bit integers.
+// Masks are integer lanes with all bits set where true.
+
+#if defined(LVE_TRANSFORM_BATCH_AVX2)
+
+constexpr size_t WIDTH = 8;
+struct Floats {
+  __m256 v;
+};
+struct Ints {
+  __m256i v;
+};
+inline Floats load(const float *p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float *p, Floats a) { _mm256_storeu_ps(p, a.v); }
+inline Floats splat(float f) { return {_mm256_set1_ps(f)}; }
+inline Floats operator+(Floats a, Floats b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Floats operator-(Floats a, Floats b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Floats operator*(Floats a, Floats b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Floats operator/(Floats a, Floats b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline Floats operator-(Floats a) { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.f))}; }
+inline Ints roundToInts(Floats a) { return {_mm256_cvtps_epi32(a.v)}; }
+inline Floats toFloats(Ints a) { return {_mm256_cvtepi32_ps(a.v)}; }
+inline Ints operator&(Ints a, int32_t b) { return {_mm256_and_si256(a.v, _mm256_set1_epi32(b))}; }
+inline Ints operator+(Ints a, int32_t b) { return {_mm256_add_epi32(a.v, _mm256_set1_epi32(b))}; }
+inline Ints signBitFrom2(Ints a) { return {_mm256_slli_epi32(a.v, 30)}; }
+inline Ints isNonZero(Ints a) {
+  return {_mm256_xor_si256(
+      _mm256_cmpeq_epi32(a.v, _mm256_setzero_si256()), _mm256_set1_epi32(-1))};
+}
+inline Floats select(Ints mask, Floats a, Floats b) {
+  return {_mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(mask.v))};
+}
+inline Floats flipSign(Floats a, Ints signBit) {
+  return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(signBit.v))};
+}
+
+#elif defined(LVE_TRANSFORM_BATCH_SSE2)
+
+constexpr size_t WIDTH = 4;
+struct Floats {
+  __m128 v;
+};
+struct Ints {
+  __m128i v;
+};
+inline Floats load(const float *p) { return {_mm_loadu_ps(p)}; }
+inline void store(float *p, Floats a) { _mm_storeu_ps(p, a.v); }
+inline Floats splat(float f) { return {_mm_set1_ps(f)}; }
+inline Floats operator+(Floats a, Floats b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Floats operator-(Floats a, Floats b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Floats operator*(Floats a, Floats b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Floats operator/(Floats a, Floats b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Floats operator-(Floats a) { return {_mm_xor_ps(a.v, _mm_set1_ps(-0.f))}; }
+inline Ints roundToInts(Floats a) { return {_mm_cvtps_epi32(a.v)}; }
+inline Floats toFloats(Ints a) { return {_mm_cvtepi32_ps(a.v)}; }
+inline Ints operator&(Ints a, int32_t b) { return {_mm_and_si128(a.v, _mm_set1_epi32(b))}; }
+inline Ints operator+(Ints a, int32_t b) { return {_mm_add_epi32(a.v, _mm_set1_epi32(b))}; }
+inline Ints signBitFrom2(Ints a) { return {_mm_slli_epi32(a.v, 30)}; }
+inline Ints isNonZero(Ints a) {
+  return {_mm_xor_si128(_mm_cmpeq_epi32(a.v, _mm_setzero_si128()), _mm_set1_epi32(-1))};
+}
+inline Floats select(Ints mask, Floats a, Floats b) {
+  // no blendv before SSE4.1
+  const __m128 m = _mm_castsi128_ps(mask.v);
+  return {_mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v))};
+}
+inline Floats flipSign(Floats a, Ints signBit) {
+  return {_mm_xor_ps(a.v, _mm_castsi128_ps(signBit.v))};
+}
+
+#else
+
+constexpr size_t WIDTH = 1;
+struct Floats {
+  float v;
+};
+struct Ints {
+  int32_t v;
+};
+inline Floats load(const float *p) { return {*p}; }
+inline void store(float *p, Floats a) { *p = a.v; }
+inline Floats splat(float f) { return {f}; }
+inline Floats operator+(Floats a, Floats b) { return {a.v + b.v}; }
+inline Floats operator-(Floats a, Floats b) { return {a.v - b.v}; }
+inline Floats operator*(Floats a, Floats b) { return {a.v * b.v}; }
+inline Floats operator/(Floats a, Floats b) { return {a.v / b.v}; }
+inline Floats operator-(Floats a) { return {-a.v}; }
+inline Ints roundToInts(Floats a) {
+  return {static_cast<int32_t>(a.v < 0.f ? a.v - 0.5f : a.v + 0.5f)};
+}
+inline Floats toFloats(Ints a) { return {static_cast<float>(a.v)}; }
+inline Ints operator&(Ints a, int32_t b) { return {a.v & b}; }
+inline Ints operator+(Ints a, int32_t b) { return {a.v + b}; }
+inline Ints signBitFrom2(Ints a) {
+  return {static_cast<int32_t>(static_cast<uint32_t>(a.v) << 30)};
+}
+inline Ints isNonZero(Ints a) { return {a.v != 0 ? -1 : 0}; }
+inline Floats select(Ints mask, Floats a, Floats b) { return mask.v != 0 ? a : b; }
+inline Floats flipSign(Floats a, Ints signBit) {
+  uint32_t bits;
+  std::memcpy(&bits, &a.v, sizeof(bits));
+  bits ^= static_cast<uint32_t>(signBit.v);
+  std::memcpy(&a.v, &bits, sizeof(bits));
+  return a;
+}
+
+#endif
+
+// Sine and cosine together, after the Cephes sinf/cosf: x is reduced to r in [-pi/4, pi/4] by
+// the nearest multiple q of pi/2, subtracted in three parts so r stays exact for the angles of a
+// transform, and the quadrant q & 3 picks sign and polynomial.
+inline void sinCos(Floats x, Floats &sinX, Floats &cosX) {
+  const Ints quadrant = roundToInts(x * splat(0.636619772367581343f));  // 2 / pi
+  const Floats q = toFloats(quadrant);
+  Floats r = x - q * splat(1.5703125f);
+  r = r - q * splat(4.837512969970703125e-4f);
+  r = r - q * splat(7.54978995489188216e-8f);
+
+  const Floats r2 = r * r;
+  const Floats sinR =
+      ((splat(-1.9515295891e-4f) * r2 + splat(8.3321608736e-3f)) * r2 - splat(1.6666654611e-1f)) *
+          r2 * r +
+      r;
+  const Floats cosR =
+      ((splat(2.443315711809948e-5f) * r2 - splat(1.388731625493765e-3f)) * r2 +
+       splat(4.166664568298827e-2f)) *
+          r2 * r2 -
+      splat(0.5f) * r2 + splat(1.f);
+
+  // odd quadrants swap sine and cosine, sine is negative in quadrants 2 and 3, cosine in 1 and 2
+  const Ints swap = isNonZero(quadrant & 1);
+  sinX = flipSign(select(swap, cosR, sinR), signBitFrom2(quadrant & 2));
+  cosX = flipSign(select(swap, sinR, cosR), signBitFrom2((quadrant + 1) & 2));
+}
+
+// indices into the per step result rows, the model matrix's upper 3x3 then the normal matrix
+constexpr size_t ROWS = 18;
+
+// computes WIDTH objects starting at input element first into rows[entry][lane]
+inline void computeStep(
+    const std::array<const float *, 9> &columns, size_t first, float (&rows)[ROWS][WIDTH]) {
+  Floats s1, c1, s2, c2, s3, c3;
+  sinCos(load(columns[4] + first), s1, c1);  // rotation.y
+  sinCos(load(columns[3] + first), s2, c2);  // rotation.x
+  sinCos(load(columns[5] + first), s3, c3);  // rotation.z
+  const Floats scaleX = load(columns[6] + first);
+  const Floats scaleY = load(columns[7] + first);
+  const Floats scaleZ = load(columns[8] + first);
+  const Floats one = splat(1.f);
+  const Floats invScaleX = one / scaleX;
+  const Floats invScaleY = one / scaleY;
+  const Floats invScaleZ = one / scaleZ;
+
+  // rotation Ry * Rx * Rz, the same terms as TransformComponent::mat4
+  const Floats rotation[9] = {
+      c1 * c3 + s1 * s2 * s3,
+      c2 * s3,
+      c1 * s2 * s3 - c3 * s1,
+      c3 * s1 * s2 - c1 * s3,
+      c2 * c3,
+      c1 * c3 * s2 + s1 * s3,
+      c2 * s1,
+      -s2,
+      c1 * c2};
+  const Floats columnScale[3] = {scaleX, scaleY, scaleZ};
+  const Floats columnInvScale[3] = {invScaleX, invScaleY, invScaleZ};
+  for (size_t entry = 0; entry < 9; entry++) {
+    store(rows[entry], rotation[entry] * columnScale[entry / 3]);
+    store(rows[9 + entry], rotation[entry] * columnInvScale[entry / 3]);
+  }
+}
+
+inline void writeMatrices(
+    const std::array<const float *, 9> &columns,
+    size_t index,
+    const float (&rows)[ROWS][WIDTH],
+    size_t lane,
+    glm::mat4 &modelMatrix,
+    glm::mat3 &normalMatrix) {
+  for (int column = 0; column < 3; column++) {
+    modelMatrix[column] = {
+        rows[column * 3][lane], rows[column * 3 + 1][lane], rows[column * 3 + 2][lane], 0.f};
+    normalMatrix[column] = {
+        rows[9 + column * 3][lane], rows[9 + column * 3 + 1][lane], rows[9 + column * 3 + 2][lane]};
+  }
+  modelMatrix[3] = {columns[0][index], columns[1][index], columns[2][index], 1.f};
+}
+
+}  // namespace
+
+void computeTransformMatrices(
+    const TransformBatchInput &input,
+    size_t count,
+    glm::mat4 *modelMatrices,
+    glm::mat3 *normalMatrices) {
+  const std::array<const float *, 9> columns{
+      input.translation[0],
+      input.translation[1],
+      input.translation[2],
+      input.rotation[0],
+      input.rotation[1],
+      input.rotation[2],
+      input.scale[0],
+      input.scale[1],
+      input.scale[2]};
+
+  float rows[ROWS][WIDTH];
+  size_t first = 0;
+  for (; first + WIDTH <= count; first += WIDTH) {
+    computeStep(columns, first, rows);
+    for (size_t lane = 0; lane < WIDTH; lane++) {
+      writeMatrices(
+          columns, first + lane, rows, lane, modelMatrices[first + lane], normalMatrices[first + lane]);
+    }
+  }
+  if (first == count) {
+    return;
+  }
+
+  // the remainder goes through a padded copy, so every object gets the same arithmetic
+  float padded[9][WIDTH];
+  std::array<const float *, 9> paddedColumns;
+  for (size_t column = 0; column < 9; column++) {
+    std::fill(std::begin(padded[column]), std::end(padded[column]), column >= 6 ? 1.f : 0.f);
+    std::copy(columns[column] + first, columns[column] + count, padded[column]);
+    paddedColumns[column] = padded[column];
+  }
+  computeStep(paddedColumns, 0, rows);
+  for (size_t lane = 0; first + lane < count; lane++) {
+    writeMatrices(
+        paddedColumns, lane, rows, lane, modelMatrices[first + lane], normalMatrices[first + lane]);
+  }
+}
+
+const char *transformBatchInstructionSet() {
+#if defined(LVE_TRANSFORM_BATCH_AVX2)
+  return "avx2";
+#elif defined(LVE_TRANSFORM_BATCH_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+void LveTransformBatch::add(
+    const TransformComponent &transform, glm::mat4 *modelMatrix, glm::mat3 *normalMatrix) {
+  for (int axis = 0; axis < 3; axis++) {
+    staging[axis][size] = transform.translation[axis];
+    staging[3 + axis][size] = transform.rotation[axis];
+    staging[6 + axis][size] = transform.scale[axis];
+  }
+  modelTargets[size] = modelMatrix;
+  normalTargets[size] = normalMatrix;
+  if (++size == CAPACITY) {
+    flush();
+  }
+}
+
+void LveTransformBatch::flush() {
+  if (size == 0) {
+    return;
+  }
+  const TransformBatchInput input{
+      {staging[0].data(), staging[1].data(), staging[2].data()},
+      {staging[3].data(), staging[4].data(), staging[5].data()},
+      {staging[6].data(), staging[7].data(), staging[8].data()}};
+  computeTransformMatrices(input, size, modelResults.data(), normalResults.data());
+  for (size_t i = 0; i < size; i++) {
+    *modelTargets[i] = modelResults[i];
+    *normalTargets[i] = normalResults[i];
+  }
+  size = 0;
+}
+
+}  // namespace lve
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "lve_game_object.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstddef>
+
+namespace lve {
+
+// Transforms of a batch as separate arrays, element i of every array belongs to object i.
+// Rotations follow TransformComponent: Tait-Bryan angles Y(1), X(2), Z(3) in radians.
+struct TransformBatchInput {
+  std::array<const float *, 3> translation;
+  std::array<const float *, 3> rotation;
+  std::array<const float *, 3> scale;
+};
+
+// Computes what TransformComponent::mat4() and normalMatrix() return for count objects, several
+// objects per instruction and with each object's six sines and cosines evaluated once for both
+// matrices. Uses AVX2 in builds compiled with it, otherwise SSE2, otherwise plain C++.
+void computeTransformMatrices(
+    const TransformBatchInput &input,
+    size_t count,
+    glm::mat4 *modelMatrices,
+    glm::mat3 *normalMatrices);
+
+// instruction set computeTransformMatrices was compiled for: "avx2", "sse2" or "scalar"
+const char *transformBatchInstructionSet();
+
+// Gathers transforms of scattered objects into SoA staging arrays and computes them CAPACITY at a
+// time, writing the results to the matrices given with each transform. Not thread-safe, use one
+// per thread.
+class LveTransformBatch {
+ public:
+  static constexpr size_t CAPACITY = 64;
+
+  void add(const TransformComponent &transform, glm::mat4 *modelMatrix, glm::mat3 *normalMatrix);
+  // computes everything added since the last flush, also called by add once CAPACITY is reached
+  void flush();
+
+ private:
+  std::array<std::array<float, CAPACITY>, 9> staging;  // translation, rotation, scale xyz
+  std::array<glm::mat4 *, CAPACITY> modelTargets;
+  std::array<glm::mat3 *, CAPACITY> normalTargets;
+  std::array<glm::mat4, CAPACITY> modelResults;
+  std::array<glm::mat3, CAPACITY> normalResults;
+  size_t size = 0;
+};
+
+}  // namespace lve
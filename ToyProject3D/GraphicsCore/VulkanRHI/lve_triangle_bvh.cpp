@@ -0,0 +1,628 @@
+#include "lve_triangle_bvh.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_TRIANGLE_BVH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+namespace {
+
+// SAH candidates per axis and split, as in LveBvh
+constexpr int SAH_BINS = 16;
+// ranges with more triangles build their two halves as separate jobs
+constexpr uint32_t PARALLEL_BUILD_GRAIN = 4096;
+// below this binary depth splits fall back to halving the range, which bounds the tree's depth
+// and with it the traversal stack: 48 + 32 levels, three nodes pushed per level at most
+constexpr int MAX_SAH_DEPTH = 48;
+constexpr int TRAVERSAL_STACK_SIZE = 256;
+
+constexpr uint32_t FILE_MAGIC = 0x4254564cu;  // "LVTB"
+constexpr uint32_t FILE_VERSION = 1;
+
+// Four lanes of floats and comparison masks, one lane per child or triangle of a packet.
+
+#if defined(LVE_TRIANGLE_BVH_SSE2)
+
+struct Lanes {
+  __m128 v;
+};
+struct Mask {
+  __m128 v;
+};
+inline Lanes loadLanes(const float *p) { return {_mm_load_ps(p)}; }
+inline void storeLanes(float *p, Lanes a) { _mm_store_ps(p, a.v); }
+inline Lanes splat(float f) { return {_mm_set1_ps(f)}; }
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Lanes min(Lanes a, Lanes b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Lanes max(Lanes a, Lanes b) { return {_mm_max_ps(a.v, b.v)}; }
+inline Lanes abs(Lanes a) { return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)}; }
+inline Mask operator<(Lanes a, Lanes b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline Mask operator<=(Lanes a, Lanes b) { return {_mm_cmple_ps(a.v, b.v)}; }
+inline Mask operator&(Mask a, Mask b) { return {_mm_and_ps(a.v, b.v)}; }
+inline int bits(Mask a) { return _mm_movemask_ps(a.v); }
+
+#else
+
+struct Lanes {
+  float v[4];
+};
+struct Mask {
+  bool v[4];
+};
+template <typename Function>
+inline Lanes apply(Lanes a, Lanes b, Function function) {
+  return {{function(a.v[0], b.v[0]),
+           function(a.v[1], b.v[1]),
+           function(a.v[2], b.v[2]),
+           function(a.v[3], b.v[3])}};
+}
+template <typename Function>
+inline Mask compare(Lanes a, Lanes b, Function function) {
+  return {{function(a.v[0], b.v[0]),
+           function(a.v[1], b.v[1]),
+           function(a.v[2], b.v[2]),
+           function(a.v[3], b.v[3])}};
+}
+inline Lanes loadLanes(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void storeLanes(float *p, Lanes a) { std::copy(a.v, a.v + 4, p); }
+inline Lanes splat(float f) { return {{f, f, f, f}}; }
+inline Lanes operator+(Lanes a, Lanes b) {
+  return apply(a, b, [](float x, float y) { return x + y; });
+}
+inline Lanes operator-(Lanes a, Lanes b) {
+  return apply(a, b, [](float x, float y) { return x - y; });
+}
+inline Lanes operator*(Lanes a, Lanes b) {
+  return apply(a, b, [](float x, float y) { return x * y; });
+}
+inline Lanes operator/(Lanes a, Lanes b) {
+  return apply(a, b, [](float x, float y) { return x / y; });
+}
+// same operand order as minps and maxps, the second one wins when either is NaN
+inline Lanes min(Lanes a, Lanes b) {
+  return apply(a, b, [](float x, float y) { return x < y ? x : y; });
+}
+inline Lanes max(Lanes a, Lanes b) {
+  return apply(a, b, [](float x, float y) { return x > y ? x : y; });
+}
+inline Lanes abs(Lanes a) {
+  return {{std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3])}};
+}
+inline Mask operator<(Lanes a, Lanes b) {
+  return compare(a, b, [](float x, float y) { return x < y; });
+}
+inline Mask operator<=(Lanes a, Lanes b) {
+  return compare(a, b, [](float x, float y) { return x <= y; });
+}
+inline Mask operator&(Mask a, Mask b) {
+  return {{a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2], a.v[3] && b.v[3]}};
+}
+inline int bits(Mask a) { return a.v[0] | a.v[1] << 1 | a.v[2] << 2 | a.v[3] << 3; }
+
+#endif
+
+// the ray broadcast to every lane
+struct RayLanes {
+  Lanes origin[3];
+  Lanes direction[3];
+  Lanes inverseDirection[3];
+};
+
+template <typename T>
+void writeValue(std::ostream &stream, const T &value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream &stream, T &value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+void hashBytes(uint64_t &hash, const void *data, size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+}
+
+}  // namespace
+
+struct LveTriangleBvh::BuildState {
+  const std::vector<glm::vec3> &positions;
+  const std::vector<uint32_t> &indices;
+  LveJobSystem &jobSystem;
+  std::vector<BuildTriangle> triangles{};
+  std::vector<BuildNode> nodes{};  // at most 2n - 1 for n triangles, handed out by nodeCount
+  std::atomic<uint32_t> nodeCount{1};
+};
+
+void LveTriangleBvh::build(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &indices,
+    LveJobSystem &jobSystem) {
+  nodes.clear();
+  packets.clear();
+  bounds = {};
+  triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount == 0) {
+    return;
+  }
+
+  BuildState state{positions, indices, jobSystem};
+  state.triangles.resize(triangleCount);
+  state.nodes.resize(2 * static_cast<size_t>(triangleCount) - 1);
+  jobSystem.parallelFor(0, triangleCount, PARALLEL_BUILD_GRAIN, [&](size_t first, size_t last) {
+    for (size_t triangle = first; triangle < last; triangle++) {
+      const uint32_t *corners = &indices[3 * triangle];
+      assert(
+          std::max({corners[0], corners[1], corners[2]}) < positions.size() &&
+          "Triangle index out of range");
+      const glm::vec3 &a = positions[corners[0]];
+      const glm::vec3 &b = positions[corners[1]];
+      const glm::vec3 &c = positions[corners[2]];
+      BuildTriangle &buildTriangle = state.triangles[triangle];
+      buildTriangle.bounds = {glm::min(glm::min(a, b), c), glm::max(glm::max(a, b), c)};
+      buildTriangle.centroid = buildTriangle.bounds.center();
+      buildTriangle.triangle = static_cast<uint32_t>(triangle);
+    }
+  });
+
+  buildRange(state, 0, 0, triangleCount, 0);
+  bounds = state.nodes[0].bounds;
+  // the BVH4 keeps about a third of the binary nodes, leaves mostly hold two to four triangles
+  nodes.reserve(state.nodeCount.load() / 3 + 1);
+  packets.reserve(triangleCount / 2 + 1);
+  collapse(state, 0);
+}
+
+void LveTriangleBvh::buildRange(
+    BuildState &state, uint32_t node, uint32_t first, uint32_t count, int depth) {
+  BuildTriangle *triangles = &state.triangles[first];
+  LveAabb nodeBounds = triangles[0].bounds;
+  LveAabb centroidBounds{triangles[0].centroid, triangles[0].centroid};
+  for (uint32_t i = 1; i < count; i++) {
+    nodeBounds = LveAabb::merge(nodeBounds, triangles[i].bounds);
+    centroidBounds.min = glm::min(centroidBounds.min, triangles[i].centroid);
+    centroidBounds.max = glm::max(centroidBounds.max, triangles[i].centroid);
+  }
+  BuildNode &current = state.nodes[node];
+  current.bounds = nodeBounds;
+
+  // a packet tests four triangles for the price of one, so smaller ranges always end here
+  if (count <= WIDTH) {
+    current.first = first;
+    current.count = count;
+    return;
+  }
+
+  const glm::vec3 centroidSize = centroidBounds.max - centroidBounds.min;
+  int bestAxis = -1;
+  int bestBin = 0;
+  const glm::vec3 binScale{
+      centroidSize.x > 0.f ? SAH_BINS / centroidSize.x : 0.f,
+      centroidSize.y > 0.f ? SAH_BINS / centroidSize.y : 0.f,
+      centroidSize.z > 0.f ? SAH_BINS / centroidSize.z : 0.f};
+  auto binOf = [&](const BuildTriangle &triangle, int axis) {
+    const float offset = triangle.centroid[axis] - centroidBounds.min[axis];
+    return std::min(SAH_BINS - 1, static_cast<int>(offset * binScale[axis]));
+  };
+
+  if (depth < MAX_SAH_DEPTH) {
+    // all three axes binned in one pass over the triangles
+    std::array<std::array<LveAabb, SAH_BINS>, 3> binBounds;
+    std::array<std::array<uint32_t, SAH_BINS>, 3> binCounts{};
+    for (uint32_t i = 0; i < count; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        const int bin = binOf(triangles[i], axis);
+        LveAabb &binBox = binBounds[axis][bin];
+        binBox = binCounts[axis][bin] == 0 ? triangles[i].bounds
+                                           : LveAabb::merge(binBox, triangles[i].bounds);
+        binCounts[axis][bin]++;
+      }
+    }
+
+    // cost of a split is area * count on both sides, the constant node costs don't change the
+    // pick; counts are rounded up to whole packets, that is what the leaves below will test
+    auto packetCost = [](const LveAabb &box, uint32_t triangleCount) {
+      return box.halfArea() * static_cast<float>((triangleCount + WIDTH - 1) / WIDTH);
+    };
+    float bestCost = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; axis++) {
+      if (centroidSize[axis] <= 0.f) {
+        continue;
+      }
+      const auto &bins = binBounds[axis];
+      const auto &counts = binCounts[axis];
+
+      std::array<float, SAH_BINS> rightCosts{};
+      LveAabb right{};
+      uint32_t rightCount = 0;
+      for (int bin = SAH_BINS - 1; bin > 0; bin--) {
+        if (counts[bin] > 0) {
+          right = rightCount == 0 ? bins[bin] : LveAabb::merge(right, bins[bin]);
+          rightCount += counts[bin];
+        }
+        rightCosts[bin - 1] = rightCount == 0 ? 0.f : packetCost(right, rightCount);
+      }
+      LveAabb left{};
+      uint32_t leftCount = 0;
+      for (int bin = 0; bin < SAH_BINS - 1; bin++) {
+        if (counts[bin] > 0) {
+          left = leftCount == 0 ? bins[bin] : LveAabb::merge(left, bins[bin]);
+          leftCount += counts[bin];
+        }
+        if (leftCount == 0 || leftCount == count) {
+          continue;
+        }
+        const float cost = packetCost(left, leftCount) + rightCosts[bin];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = bin;
+        }
+      }
+    }
+  }
+
+  uint32_t middle = 0;
+  if (bestAxis >= 0) {
+    BuildTriangle *split =
+        std::partition(triangles, triangles + count, [&](const BuildTriangle &triangle) {
+          return binOf(triangle, bestAxis) <= bestBin;
+        });
+    middle = static_cast<uint32_t>(split - triangles);
+  }
+  // too deep or no usable split, e.g. identical centroids: halve along the widest axis
+  if (middle == 0 || middle == count) {
+    const int axis = centroidSize.x >= centroidSize.y && centroidSize.x >= centroidSize.z ? 0
+                     : centroidSize.y >= centroidSize.z                                  ? 1
+                                                                                         : 2;
+    middle = count / 2;
+    std::nth_element(
+        triangles,
+        triangles + middle,
+        triangles + count,
+        [axis](const BuildTriangle &a, const BuildTriangle &b) {
+          return a.centroid[axis] < b.centroid[axis];
+        });
+  }
+
+  const uint32_t left = state.nodeCount.fetch_add(2, std::memory_order_relaxed);
+  current.first = left;
+  current.count = 0;
+  if (count > PARALLEL_BUILD_GRAIN) {
+    LveJobSystem::Job *job = state.jobSystem.createJob(
+        [&state, this, left, first, middle, depth] {
+          buildRange(state, left, first, middle, depth + 1);
+        });
+    state.jobSystem.run(job);
+    buildRange(state, left + 1, first + middle, count - middle, depth + 1);
+    state.jobSystem.wait(job);
+  } else {
+    buildRange(state, left, first, middle, depth + 1);
+    buildRange(state, left + 1, first + middle, count - middle, depth + 1);
+  }
+}
+
+uint32_t LveTriangleBvh::collapse(const BuildState &state, uint32_t buildNode) {
+  // the binary node's children, the inner one with the largest area opened up while lanes remain
+  std::array<uint32_t, WIDTH> children{};
+  uint32_t childCount = 0;
+  const BuildNode &binary = state.nodes[buildNode];
+  if (binary.count > 0) {
+    children[childCount++] = buildNode;  // the whole mesh fits one leaf
+  } else {
+    children[childCount++] = binary.first;
+    children[childCount++] = binary.first + 1;
+  }
+  while (childCount < WIDTH) {
+    int largest = -1;
+    float largestArea = -1.f;
+    for (uint32_t i = 0; i < childCount; i++) {
+      const BuildNode &child = state.nodes[children[i]];
+      if (child.count == 0 && child.bounds.halfArea() > largestArea) {
+        largest = static_cast<int>(i);
+        largestArea = child.bounds.halfArea();
+      }
+    }
+    if (largest < 0) {
+      break;
+    }
+    const uint32_t opened = state.nodes[children[largest]].first;
+    children[largest] = opened;
+    children[childCount++] = opened + 1;
+  }
+
+  // children are collapsed before this node is written, nodes may reallocate meanwhile
+  const uint32_t index = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+  Node node{};
+  node.childCount = childCount;
+  for (uint32_t lane = 0; lane < childCount; lane++) {
+    const BuildNode &child = state.nodes[children[lane]];
+    for (int axis = 0; axis < 3; axis++) {
+      node.bounds[axis][lane] = child.bounds.min[axis];
+      node.bounds[3 + axis][lane] = child.bounds.max[axis];
+    }
+    if (child.count > 0) {
+      node.children[lane] = static_cast<uint32_t>(packets.size());
+      node.packetCounts[lane] = (child.count + WIDTH - 1) / WIDTH;
+      appendPackets(state, child);
+    } else {
+      node.children[lane] = collapse(state, children[lane]);
+    }
+  }
+  nodes[index] = node;
+  return index;
+}
+
+void LveTriangleBvh::appendPackets(const BuildState &state, const BuildNode &leaf) {
+  for (uint32_t offset = 0; offset < leaf.count; offset += WIDTH) {
+    TrianglePacket packet{};
+    for (uint32_t lane = 0; lane < WIDTH; lane++) {
+      if (offset + lane >= leaf.count) {
+        packet.triangles[lane] = NO_TRIANGLE;  // zero edges, never hit
+        continue;
+      }
+      const uint32_t triangle = state.triangles[leaf.first + offset + lane].triangle;
+      const glm::vec3 &a = state.positions[state.indices[3 * triangle + 0]];
+      const glm::vec3 &b = state.positions[state.indices[3 * triangle + 1]];
+      const glm::vec3 &c = state.positions[state.indices[3 * triangle + 2]];
+      for (int axis = 0; axis < 3; axis++) {
+        packet.v0[axis][lane] = a[axis];
+        packet.edge1[axis][lane] = b[axis] - a[axis];
+        packet.edge2[axis][lane] = c[axis] - a[axis];
+      }
+      packet.triangles[lane] = triangle;
+    }
+    packets.push_back(packet);
+  }
+}
+
+uint64_t LveTriangleBvh::hashMesh(
+    const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  const uint64_t sizes[2] = {positions.size(), indices.size()};
+  hashBytes(hash, sizes, sizeof(sizes));
+  hashBytes(hash, positions.data(), positions.size() * sizeof(glm::vec3));
+  hashBytes(hash, indices.data(), indices.size() * sizeof(uint32_t));
+  return hash;
+}
+
+void LveTriangleBvh::save(std::ostream &stream, uint64_t meshHash) const {
+  writeValue(stream, FILE_MAGIC);
+  writeValue(stream, FILE_VERSION);
+  writeValue(stream, meshHash);
+  writeValue(stream, triangleCount);
+  writeValue(stream, static_cast<uint32_t>(nodes.size()));
+  writeValue(stream, static_cast<uint32_t>(packets.size()));
+  writeValue(stream, bounds);
+  stream.write(reinterpret_cast<const char *>(nodes.data()), nodes.size() * sizeof(Node));
+  stream.write(
+      reinterpret_cast<const char *>(packets.data()), packets.size() * sizeof(TrianglePacket));
+}
+
+bool LveTriangleBvh::load(std::istream &stream, uint64_t meshHash) {
+  nodes.clear();
+  packets.clear();
+  bounds = {};
+  triangleCount = 0;
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t hash = 0;
+  uint32_t triangles = 0;
+  uint32_t nodeCount = 0;
+  uint32_t packetCount = 0;
+  LveAabb fileBounds{};
+  if (!readValue(stream, magic) || !readValue(stream, version) || !readValue(stream, hash) ||
+      !readValue(stream, triangles) || !readValue(stream, nodeCount) ||
+      !readValue(stream, packetCount) || !readValue(stream, fileBounds)) {
+    return false;
+  }
+  if (magic != FILE_MAGIC || version != FILE_VERSION || hash != meshHash ||
+      packetCount > triangles || nodeCount > triangles) {
+    return false;
+  }
+
+  std::vector<Node> fileNodes(nodeCount);
+  std::vector<TrianglePacket> filePackets(packetCount);
+  if (!stream.read(reinterpret_cast<char *>(fileNodes.data()), nodeCount * sizeof(Node)) ||
+      !stream.read(
+          reinterpret_cast<char *>(filePackets.data()), packetCount * sizeof(TrianglePacket))) {
+    return false;
+  }
+  // The hash only covers the mesh, a damaged tree must not send traversal out of bounds or
+  // around a cycle. Builds write every node before its children, so an inner child always has a
+  // larger index than its parent and is the child of no other node.
+  std::vector<uint32_t> depths(nodeCount, 0);
+  std::vector<bool> referenced(nodeCount, false);
+  for (uint32_t parent = 0; parent < nodeCount; parent++) {
+    const Node &node = fileNodes[parent];
+    if (node.childCount == 0 || node.childCount > WIDTH) {
+      return false;
+    }
+    for (uint32_t lane = 0; lane < node.childCount; lane++) {
+      const uint32_t child = node.children[lane];
+      if (node.packetCounts[lane] > 0) {
+        if (child >= packetCount || node.packetCounts[lane] > packetCount - child) {
+          return false;
+        }
+        continue;
+      }
+      if (child <= parent || child >= nodeCount || referenced[child]) {
+        return false;
+      }
+      referenced[child] = true;
+      depths[child] = depths[parent] + 1;
+      // every level leaves at most WIDTH - 1 siblings on the traversal stack
+      if ((WIDTH - 1) * depths[child] + 1 > static_cast<uint32_t>(TRAVERSAL_STACK_SIZE)) {
+        return false;
+      }
+    }
+  }
+  for (const TrianglePacket &packet : filePackets) {
+    for (uint32_t lane = 0; lane < WIDTH; lane++) {
+      if (packet.triangles[lane] >= triangles && packet.triangles[lane] != NO_TRIANGLE) {
+        return false;
+      }
+    }
+  }
+
+  nodes = std::move(fileNodes);
+  packets = std::move(filePackets);
+  bounds = fileBounds;
+  triangleCount = triangles;
+  return true;
+}
+
+bool LveTriangleBvh::intersect(
+    const glm::vec3 &origin, const glm::vec3 &direction, float tMax, Hit &hit) const {
+  return traverse<false>(origin, direction, tMax, hit);
+}
+
+bool LveTriangleBvh::occluded(
+    const glm::vec3 &origin, const glm::vec3 &direction, float tMax) const {
+  Hit hit{};
+  return traverse<true>(origin, direction, tMax, hit);
+}
+
+template <bool ANY_HIT>
+bool LveTriangleBvh::traverse(
+    const glm::vec3 &origin, const glm::vec3 &direction, float tMax, Hit &hit) const {
+  if (nodes.empty()) {
+    return false;
+  }
+  const glm::vec3 inverseDirection = 1.f / direction;
+  RayLanes ray{};
+  for (int axis = 0; axis < 3; axis++) {
+    ray.origin[axis] = splat(origin[axis]);
+    ray.direction[axis] = splat(direction[axis]);
+    ray.inverseDirection[axis] = splat(inverseDirection[axis]);
+  }
+  const Lanes zero = splat(0.f);
+  float closest = tMax;
+  bool found = false;
+
+  // Moeller-Trumbore against four triangles, keeps the closest hit below closest
+  auto intersectPacket = [&](const TrianglePacket &packet) {
+    const Lanes e1[3] = {
+        loadLanes(packet.edge1[0]), loadLanes(packet.edge1[1]), loadLanes(packet.edge1[2])};
+    const Lanes e2[3] = {
+        loadLanes(packet.edge2[0]), loadLanes(packet.edge2[1]), loadLanes(packet.edge2[2])};
+    const Lanes *d = ray.direction;
+    const Lanes p[3] = {
+        d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+    const Lanes determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    const Lanes inverseDeterminant = splat(1.f) / determinant;
+    const Lanes s[3] = {
+        ray.origin[0] - loadLanes(packet.v0[0]),
+        ray.origin[1] - loadLanes(packet.v0[1]),
+        ray.origin[2] - loadLanes(packet.v0[2])};
+    const Lanes u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+    const Lanes q[3] = {
+        s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+    const Lanes v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverseDeterminant;
+    const Lanes t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverseDeterminant;
+    // NaN lanes of degenerate triangles fail every comparison
+    int mask = bits(
+        (splat(std::numeric_limits<float>::min()) < abs(determinant)) & (zero <= u) &
+        (zero <= v) & (u + v <= splat(1.f)) & (zero < t) & (t < splat(closest)));
+    if (mask == 0) {
+      return;
+    }
+    alignas(16) float ts[WIDTH];
+    alignas(16) float us[WIDTH];
+    alignas(16) float vs[WIDTH];
+    storeLanes(ts, t);
+    storeLanes(us, u);
+    storeLanes(vs, v);
+    for (uint32_t lane = 0; lane < WIDTH; lane++) {
+      if ((mask & (1 << lane)) && ts[lane] < closest) {
+        closest = ts[lane];
+        hit = {ts[lane], packet.triangles[lane], us[lane], vs[lane]};
+        found = true;
+      }
+    }
+  };
+
+  struct Entry {
+    uint32_t node;
+    float entry;  // where the ray enters the node's bounds
+  };
+  Entry stack[TRAVERSAL_STACK_SIZE];
+  int stackSize = 0;
+  stack[stackSize++] = {0, 0.f};
+  while (stackSize > 0) {
+    const Entry current = stack[--stackSize];
+    if (current.entry >= closest) {
+      continue;
+    }
+    const Node &node = nodes[current.node];
+
+    // slab test against the four child boxes
+    Lanes enter = zero;
+    Lanes exit = splat(closest);
+    for (int axis = 0; axis < 3; axis++) {
+      const Lanes t0 =
+          (loadLanes(node.bounds[axis]) - ray.origin[axis]) * ray.inverseDirection[axis];
+      const Lanes t1 =
+          (loadLanes(node.bounds[3 + axis]) - ray.origin[axis]) * ray.inverseDirection[axis];
+      enter = max(enter, min(t0, t1));
+      exit = min(exit, max(t0, t1));
+    }
+    const int mask = bits(enter <= exit) & ((1 << node.childCount) - 1);
+    if (mask == 0) {
+      continue;
+    }
+    alignas(16) float enters[WIDTH];
+    storeLanes(enters, enter);
+
+    // leaves right away, inner children onto the stack farthest first so the nearest pops next
+    Entry inner[WIDTH];
+    int innerCount = 0;
+    for (uint32_t lane = 0; lane < WIDTH; lane++) {
+      if (!(mask & (1 << lane))) {
+        continue;
+      }
+      if (node.packetCounts[lane] == 0) {
+        inner[innerCount++] = {node.children[lane], enters[lane]};
+        continue;
+      }
+      const uint32_t firstPacket = node.children[lane];
+      for (uint32_t packet = 0; packet < node.packetCounts[lane]; packet++) {
+        intersectPacket(packets[firstPacket + packet]);
+        if (ANY_HIT && found) {
+          return true;
+        }
+      }
+    }
+    for (int i = 1; i < innerCount; i++) {
+      for (int j = i; j > 0 && inner[j - 1].entry < inner[j].entry; j--) {
+        std::swap(inner[j - 1], inner[j]);
+      }
+    }
+    assert(stackSize + innerCount <= TRAVERSAL_STACK_SIZE && "Triangle BVH too deep");
+    for (int i = 0; i < innerCount; i++) {
+      stack[stackSize++] = inner[i];
+    }
+  }
+  return found;
+}
+
+}  // namespace lve
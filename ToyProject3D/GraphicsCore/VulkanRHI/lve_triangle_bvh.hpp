@@ -0,0 +1,115 @@
+#pragma once
+
+#include "lve_bounds.hpp"
+#include "lve_job_system.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace lve {
+
+// Static bounding volume hierarchy over the triangles of one mesh, for ray picking and other CPU
+// ray queries in object space.
+//
+// The tree is built top-down as a binary tree with a binned surface area heuristic, subtrees of
+// large ranges on the job system, then collapsed into a BVH4: every node holds the bounds of up to
+// four children side by side, so one ray is tested against all of them in a single SIMD step.
+// Leaves point at packets of four triangles stored the same way, intersected four at a time.
+//
+// A built tree is self-contained and can be written to and read back from a stream; the stream
+// carries a hash of the mesh it was built from and load() refuses one built from another mesh.
+// Queries may run on several threads at once.
+class LveTriangleBvh {
+ public:
+  static constexpr uint32_t NO_TRIANGLE = ~0u;
+
+  struct Hit {
+    float t = 0.f;
+    uint32_t triangle = NO_TRIANGLE;  // index of the triangle's first index divided by three
+    float u = 0.f;  // barycentrics of the hit point, weights of the second and third vertex
+    float v = 0.f;
+  };
+
+  LveTriangleBvh() = default;
+
+  // replaces the tree with one over indices, three per triangle, into positions
+  void build(
+      const std::vector<glm::vec3> &positions,
+      const std::vector<uint32_t> &indices,
+      LveJobSystem &jobSystem);
+
+  // FNV-1a over the mesh, what load() compares against the stream
+  static uint64_t hashMesh(
+      const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices);
+  void save(std::ostream &stream, uint64_t meshHash) const;
+  // false, leaving the tree empty, if the stream is damaged, of another version or another mesh
+  bool load(std::istream &stream, uint64_t meshHash);
+
+  // Closest hit of origin + t * direction with t in (0, tMax), true if there is one. direction
+  // needn't be normalized, t is in its units.
+  bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, float tMax, Hit &hit) const;
+  // true as soon as any triangle is hit with t in (0, tMax)
+  bool occluded(const glm::vec3 &origin, const glm::vec3 &direction, float tMax) const;
+
+  bool empty() const { return nodes.empty(); }
+  uint32_t getTriangleCount() const { return triangleCount; }
+  size_t getNodeCount() const { return nodes.size(); }
+  size_t getMemorySize() const {
+    return nodes.size() * sizeof(Node) + packets.size() * sizeof(TrianglePacket);
+  }
+  const LveAabb &getBounds() const { return bounds; }
+
+ private:
+  static constexpr uint32_t WIDTH = 4;
+
+  // bounds of up to four children as min x, y, z then max x, y, z lanes; a child is a node, or
+  // for leaves the first of packetCounts consecutive packets
+  struct alignas(16) Node {
+    float bounds[6][WIDTH];
+    uint32_t children[WIDTH];
+    uint32_t packetCounts[WIDTH];  // 0 for inner children
+    uint32_t childCount;
+  };
+
+  // four triangles as first vertex and the two edges leaving it, unused lanes are degenerate
+  struct alignas(16) TrianglePacket {
+    float v0[3][WIDTH];
+    float edge1[3][WIDTH];
+    float edge2[3][WIDTH];
+    uint32_t triangles[WIDTH];
+  };
+
+  struct BuildTriangle {
+    LveAabb bounds{};
+    glm::vec3 centroid{};
+    uint32_t triangle = 0;
+  };
+
+  // binary build node, a leaf if count > 0 and then first is its offset in the build triangles
+  struct BuildNode {
+    LveAabb bounds{};
+    uint32_t first = 0;  // or the left child, the right one follows it
+    uint32_t count = 0;
+  };
+
+  struct BuildState;
+
+  void buildRange(BuildState &state, uint32_t node, uint32_t first, uint32_t count, int depth);
+  uint32_t collapse(const BuildState &state, uint32_t buildNode);
+  void appendPackets(const BuildState &state, const BuildNode &leaf);
+
+  template <bool ANY_HIT>
+  bool traverse(const glm::vec3 &origin, const glm::vec3 &direction, float tMax, Hit &hit) const;
+
+  std::vector<Node> nodes;
+  std::vector<TrianglePacket> packets;
+  LveAabb bounds{};
+  uint32_t triangleCount = 0;
+};
+
+}  // namespace lve
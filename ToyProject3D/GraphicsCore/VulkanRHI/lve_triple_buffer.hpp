@@ -0,0 +1,60 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace lve {
+
+// Lock-free handoff of a value from one producer thread to one consumer thread.
+//
+// The producer writes into back() and publishes it, the consumer acquires the newest published
+// value into front(). A third slot sits between them, so neither side ever waits for the other
+// or sees a slot the other is using. Publishing again before the consumer acquired replaces the
+// pending value; producers that must not drop values check hasPending() first.
+//
+// Slots are reused, so members like vectors keep their capacity across handoffs.
+template <typename T>
+class LveTripleBuffer {
+ public:
+  LveTripleBuffer() = default;
+
+  LveTripleBuffer(const LveTripleBuffer &) = delete;
+  LveTripleBuffer &operator=(const LveTripleBuffer &) = delete;
+
+  // producer only
+  T &back() { return slots[backIndex]; }
+  void publish() {
+    const uint32_t previous = middle.exchange(backIndex | PENDING_BIT, std::memory_order_acq_rel);
+    backIndex = previous & INDEX_MASK;
+  }
+  // true until the consumer has acquired the last published value
+  bool hasPending() const { return (middle.load(std::memory_order_acquire) & PENDING_BIT) != 0; }
+
+  // consumer only, false if nothing was published since the last acquire
+  bool acquire() {
+    if ((middle.load(std::memory_order_relaxed) & PENDING_BIT) == 0) {
+      return false;
+    }
+    const uint32_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+    frontIndex = previous & INDEX_MASK;
+    return true;
+  }
+  const T &front() const { return slots[frontIndex]; }
+
+  // before either side starts only, e.g. to reserve capacity in every slot
+  std::array<T, 3> &getSlots() { return slots; }
+
+ private:
+  static constexpr uint32_t INDEX_MASK = 0x3;
+  static constexpr uint32_t PENDING_BIT = 0x4;
+
+  std::array<T, 3> slots{};
+  // each index on its own cache line, the producer and consumer indices are never shared
+  alignas(64) uint32_t backIndex = 0;
+  alignas(64) std::atomic<uint32_t> middle{1};
+  alignas(64) uint32_t frontIndex = 2;
+};
+
+}  // namespace lve
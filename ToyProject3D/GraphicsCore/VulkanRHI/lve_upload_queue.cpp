@@ -0,0 +1,391 @@
+#include "lve_upload_queue.hpp"
+#include "lve_device.hpp"
+#include "lve_profiler.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+LveUploadQueue::LveUploadQueue(LveDevice &device) : lveDevice{device} {
+  const QueueFamilyIndices indices = lveDevice.findPhysicalQueueFamilies();
+  transferFamily = indices.transferFamily;
+  graphicsFamily = indices.graphicsFamily;
+  dedicated = lveDevice.hasDedicatedTransferQueue();
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = transferFamily;
+  if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &transferPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload command pool!");
+  }
+  if (dedicated) {
+    poolInfo.queueFamilyIndex = graphicsFamily;
+    if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &acquirePool) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload command pool!");
+    }
+  }
+}
+
+LveUploadQueue::~LveUploadQueue() {
+  waitIdle();
+  if (recording) {
+    release(current);  // recorded but never submitted
+  }
+  vkDestroyCommandPool(lveDevice.device(), transferPool, nullptr);
+  if (acquirePool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(lveDevice.device(), acquirePool, nullptr);
+  }
+}
+
+void LveUploadQueue::uploadBuffer(
+    const void *data,
+    VkDeviceSize size,
+    VkBuffer dstBuffer,
+    VkPipelineStageFlags dstStages,
+    VkAccessFlags dstAccess) {
+  Batch &batch = recordingBatch();
+  VkBuffer stagingBuffer = createStagingBuffer(batch, data, size);
+
+  VkBufferCopy copyRegion{};
+  copyRegion.size = size;
+  vkCmdCopyBuffer(batch.transferCommandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.buffer = dstBuffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  if (dedicated) {
+    // release, the matching acquire is recorded for the graphics queue in flush()
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    vkCmdPipelineBarrier(
+        batch.transferCommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    batch.bufferAcquires.push_back(barrier);
+    batch.acquireStages |= dstStages;
+  } else {
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    vkCmdPipelineBarrier(
+        batch.transferCommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        dstStages,
+        0,
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr);
+  }
+}
+
+void LveUploadQueue::uploadImage(
+    const void *data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height) {
+  Batch &batch = recordingBatch();
+  VkBuffer stagingBuffer = createStagingBuffer(batch, data, size);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      batch.transferCommandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(
+      batch.transferCommandBuffer,
+      stagingBuffer,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &region);
+
+  // the layout transition is part of both halves of an ownership transfer
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  if (dedicated) {
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    vkCmdPipelineBarrier(
+        batch.transferCommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    batch.imageAcquires.push_back(barrier);
+    batch.acquireStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  } else {
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        batch.transferCommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+  }
+}
+
+void LveUploadQueue::flush() {
+  if (!recording) {
+    return;
+  }
+  LVE_PROFILE_FUNCTION();
+  recording = false;
+  Batch &batch = current;
+
+  if (vkEndCommandBuffer(batch.transferCommandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(lveDevice.device(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload fence!");
+  }
+
+  VkSubmitInfo transferSubmit{};
+  transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  transferSubmit.commandBufferCount = 1;
+  transferSubmit.pCommandBuffers = &batch.transferCommandBuffer;
+
+  if (!dedicated) {
+    if (vkQueueSubmit(lveDevice.graphicsQueue(), 1, &transferSubmit, batch.fence) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit upload command buffer!");
+    }
+    queueCurrentBatch();
+    return;
+  }
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  if (vkCreateSemaphore(lveDevice.device(), &semaphoreInfo, nullptr, &batch.transferDone) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload semaphore!");
+  }
+  transferSubmit.signalSemaphoreCount = 1;
+  transferSubmit.pSignalSemaphores = &batch.transferDone;
+  if (vkQueueSubmit(lveDevice.transferQueue(), 1, &transferSubmit, VK_NULL_HANDLE) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+
+  // acquire on the graphics queue, the barrier's source stages chain onto the semaphore wait
+  batch.acquireCommandBuffer = beginCommandBuffer(acquirePool);
+  vkCmdPipelineBarrier(
+      batch.acquireCommandBuffer,
+      batch.acquireStages,
+      batch.acquireStages,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(batch.bufferAcquires.size()),
+      batch.bufferAcquires.data(),
+      static_cast<uint32_t>(batch.imageAcquires.size()),
+      batch.imageAcquires.data());
+  if (vkEndCommandBuffer(batch.acquireCommandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  // the acquire can't finish before the transfer it waits for, so its fence covers both
+  VkSubmitInfo acquireSubmit{};
+  acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  acquireSubmit.waitSemaphoreCount = 1;
+  acquireSubmit.pWaitSemaphores = &batch.transferDone;
+  acquireSubmit.pWaitDstStageMask = &batch.acquireStages;
+  acquireSubmit.commandBufferCount = 1;
+  acquireSubmit.pCommandBuffers = &batch.acquireCommandBuffer;
+  if (vkQueueSubmit(lveDevice.graphicsQueue(), 1, &acquireSubmit, batch.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload acquire command buffer!");
+  }
+  queueCurrentBatch();
+}
+
+void LveUploadQueue::queueCurrentBatch() {
+  inFlight.push_back(std::move(current));
+  if (spareBatches.empty()) {
+    current = {};
+  } else {
+    current = std::move(spareBatches.back());
+    spareBatches.pop_back();
+  }
+}
+
+void LveUploadQueue::collect() {
+  auto it = inFlight.begin();
+  while (it != inFlight.end()) {
+    if (vkGetFenceStatus(lveDevice.device(), it->fence) == VK_SUCCESS) {
+      release(*it);
+      spareBatches.push_back(std::move(*it));
+      it = inFlight.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void LveUploadQueue::waitIdle() {
+  for (const auto &batch : inFlight) {
+    vkWaitForFences(lveDevice.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+  }
+  collect();
+}
+
+LveUploadQueue::Batch &LveUploadQueue::recordingBatch() {
+  if (!recording) {
+    recording = true;
+    current.transferCommandBuffer = beginCommandBuffer(transferPool);
+    // orders this batch's copies after those of earlier batches writing the same destination
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        current.transferCommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+  return current;
+}
+
+VkBuffer LveUploadQueue::createStagingBuffer(Batch &batch, const void *data, VkDeviceSize size) {
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  lveDevice.createBuffer(
+      size,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      buffer,
+      memory);
+  batch.stagingBuffers.push_back({buffer, memory});
+
+  void *mapped;
+  vkMapMemory(lveDevice.device(), memory, 0, size, 0, &mapped);
+  std::memcpy(mapped, data, static_cast<size_t>(size));
+  vkUnmapMemory(lveDevice.device(), memory);
+
+  batch.bytes += size;
+  pendingBytes += size;
+  return buffer;
+}
+
+VkCommandBuffer LveUploadQueue::beginCommandBuffer(VkCommandPool pool) {
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = pool;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer commandBuffer;
+  if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate upload command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording upload command buffer!");
+  }
+  return commandBuffer;
+}
+
+void LveUploadQueue::release(Batch &batch) {
+  const VkDevice device = lveDevice.device();
+  for (const auto &[buffer, memory] : batch.stagingBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+    vkFreeMemory(device, memory, nullptr);
+  }
+  vkFreeCommandBuffers(device, transferPool, 1, &batch.transferCommandBuffer);
+  if (batch.acquireCommandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(device, acquirePool, 1, &batch.acquireCommandBuffer);
+  }
+  if (batch.transferDone != VK_NULL_HANDLE) {
+    vkDestroySemaphore(device, batch.transferDone, nullptr);
+  }
+  if (batch.fence != VK_NULL_HANDLE) {
+    vkDestroyFence(device, batch.fence, nullptr);
+  }
+  pendingBytes -= batch.bytes;
+  completedBytes += batch.bytes;
+
+  // empty again, but the vectors keep their capacity for the next batch
+  batch.transferCommandBuffer = VK_NULL_HANDLE;
+  batch.acquireCommandBuffer = VK_NULL_HANDLE;
+  batch.transferDone = VK_NULL_HANDLE;
+  batch.fence = VK_NULL_HANDLE;
+  batch.stagingBuffers.clear();
+  batch.bufferAcquires.clear();
+  batch.imageAcquires.clear();
+  batch.acquireStages = 0;
+  batch.bytes = 0;
+}
+
+}  // namespace lve
@@ -0,0 +1,92 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+class LveDevice;
+
+// Staging uploads that never block the frame. Uploads are recorded into a batch that flush()
+// submits, the renderer flushes right before it submits a frame, so the frame and every later
+// graphics submission may use the uploaded data. Staging memory is released by collect() once
+// the batch has finished, the batch itself is kept for reuse.
+//
+// With a dedicated transfer queue family the copies run there. Every destination then changes
+// queue family ownership: the transfer submission releases it and signals a semaphore, a graphics
+// submission waits on the semaphore and acquires it. Without one the copies and the barriers to
+// their consumers are submitted to the graphics queue.
+//
+// Destinations must not be in use by the GPU while they are uploaded to. Call from the thread
+// that owns the device.
+class LveUploadQueue {
+ public:
+  explicit LveUploadQueue(LveDevice &device);
+  ~LveUploadQueue();
+
+  LveUploadQueue(const LveUploadQueue &) = delete;
+  LveUploadQueue &operator=(const LveUploadQueue &) = delete;
+
+  // dstStages/dstAccess describe how graphics work reads the buffer, e.g. as vertex input
+  void uploadBuffer(
+      const void *data,
+      VkDeviceSize size,
+      VkBuffer dstBuffer,
+      VkPipelineStageFlags dstStages,
+      VkAccessFlags dstAccess);
+  // tightly packed pixels of a single level 2D color image, which ends up in
+  // SHADER_READ_ONLY_OPTIMAL for fragment shaders
+  void uploadImage(
+      const void *data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height);
+
+  void flush();
+  void collect();  // never waits, releases what has already finished
+  void waitIdle();
+
+  bool isDedicated() const { return dedicated; }
+  // recorded or submitted but not finished yet
+  VkDeviceSize getPendingBytes() const { return pendingBytes; }
+  uint64_t getCompletedBytes() const { return completedBytes; }
+
+ private:
+  struct Batch {
+    VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+    VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;  // dedicated only
+    VkSemaphore transferDone = VK_NULL_HANDLE;              // dedicated only
+    VkFence fence = VK_NULL_HANDLE;  // signaled by the last submission of the batch
+    std::vector<std::pair<VkBuffer, VkDeviceMemory>> stagingBuffers;
+    std::vector<VkBufferMemoryBarrier> bufferAcquires;
+    std::vector<VkImageMemoryBarrier> imageAcquires;
+    VkPipelineStageFlags acquireStages = 0;
+    VkDeviceSize bytes = 0;
+  };
+
+  Batch &recordingBatch();
+  // moves the submitted batch to inFlight and continues with a spare one
+  void queueCurrentBatch();
+  VkBuffer createStagingBuffer(Batch &batch, const void *data, VkDeviceSize size);
+  VkCommandBuffer beginCommandBuffer(VkCommandPool pool);
+  void release(Batch &batch);
+
+  LveDevice &lveDevice;
+  bool dedicated;
+  uint32_t transferFamily;
+  uint32_t graphicsFamily;
+  VkCommandPool transferPool = VK_NULL_HANDLE;
+  VkCommandPool acquirePool = VK_NULL_HANDLE;  // graphics family, dedicated only
+
+  bool recording = false;
+  Batch current{};
+  std::vector<Batch> inFlight;  // in submission order
+  // finished batches, reused so a steady stream of uploads stops allocating vectors for them
+  std::vector<Batch> spareBatches;
+  VkDeviceSize pendingBytes = 0;
+  uint64_t completedBytes = 0;
+};
+
+}  // namespace lve
@@ -5,11 +5,17 @@
 
 namespace lve {
 
-LveWindow::LveWindow(int w, int h, std::string name) : width{w}, height{h}, windowName{name} {
-  initWindow();
+LveWindow::LveWindow(int w, int h, std::string name, bool headless)
+    : width{w}, height{h}, headless{headless}, windowName{name} {
+  if (!headless) {
+    initWindow();
+  }
 }
 
 LveWindow::~LveWindow() {
+  if (headless) {
+    return;
+  }
   glfwDestroyWindow(window);
   glfwTerminate();
 }
@@ -25,6 +31,9 @@ void LveWindow::initWindow() {
 }
 
 void LveWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
+  if (headless) {
+    throw std::runtime_error("headless window has no surface");
+  }
   if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS) {
     throw std::runtime_error("failed to craete window surface");
   }
@@ -8,13 +8,15 @@ namespace lve {
 
 class LveWindow {
  public:
-  LveWindow(int w, int h, std::string name);
+  // a headless window never creates a GLFW window, only its extent is used for offscreen targets
+  LveWindow(int w, int h, std::string name, bool headless = false);
   ~LveWindow();
 
   LveWindow(const LveWindow &) = delete;
   LveWindow &operator=(const LveWindow &) = delete;
 
-  bool shouldClose() { return glfwWindowShouldClose(window); }
+  bool shouldClose() { return !headless && glfwWindowShouldClose(window); }
+  bool isHeadless() const { return headless; }
   VkExtent2D getExtent() { return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}; }
   bool wasWindowResized() { return framebufferResized; }
   void resetWindowResizedFlag() { framebufferResized = false; }
@@ -29,8 +31,9 @@ class LveWindow {
   int width;
   int height;
   bool framebufferResized = false;
+  bool headless = false;
 
   std::string windowName;
-  GLFWwindow *window;
+  GLFWwindow *window = nullptr;
 };
 }  // namespace lve
@@ -1,4 +1,5 @@
 #include "simple_render_system.hpp"
+#include "lve_command_stats.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -35,7 +36,7 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetlay
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(SimplePushConstantData);
 
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetlayout };
+  const std::array<VkDescriptorSetLayout, 1> descriptorSetLayouts{ globalSetlayout };
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -63,13 +64,15 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
       pipelineConfig);
 }
 
-void SimpleRenderSystem::renderGameObjects(
+void SimpleRenderSystem::renderDraw(
 	FrameInfo& frameInfo,
-	LveGameObject& gameObject)
+	const DrawPacket& draw,
+	VkBuffer meshletCommands)
 {
+  assert(frameInfo.globalDescriptorSet != VK_NULL_HANDLE && "Frame info needs a descriptor set");
   lvePipeline->bind(frameInfo.commandBuffer);
 
-  vkCmdBindDescriptorSets(
+  cmd::bindDescriptorSets(
 	  frameInfo.commandBuffer,
 	  VK_PIPELINE_BIND_POINT_GRAPHICS,
 	  pipelineLayout,
@@ -80,18 +83,27 @@ void SimpleRenderSystem::renderGameObjects(
 	  nullptr);
 
   SimplePushConstantData push{};
-  push.modelMatrix = gameObject.transform.mat4();
-  push.normalMatrix = gameObject.transform.normalMatrix();
+  push.modelMatrix = draw.modelMatrix;
+  push.normalMatrix = draw.normalMatrix;
 
-  vkCmdPushConstants(
+  cmd::pushConstants(
 	  frameInfo.commandBuffer,
 	  pipelineLayout,
 	  VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 	  0,
 	  sizeof(SimplePushConstantData),
 	  &push);
-  gameObject.model->bind(frameInfo.commandBuffer);
-  gameObject.model->draw(frameInfo.commandBuffer);
+  draw.model->bind(frameInfo.commandBuffer);
+  if (draw.commandCount > 0) {
+	  assert(meshletCommands != VK_NULL_HANDLE && "Meshlet draws need the packet's command buffer");
+	  draw.model->drawIndirect(
+		  frameInfo.commandBuffer,
+		  meshletCommands,
+		  VkDeviceSize{draw.firstCommand} * sizeof(VkDrawIndexedIndirectCommand),
+		  draw.commandCount);
+  } else {
+	  draw.model->draw(frameInfo.commandBuffer, draw.lod);
+  }
 }
 
 }  // namespace lve
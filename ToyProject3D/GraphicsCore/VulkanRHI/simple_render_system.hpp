@@ -4,6 +4,7 @@
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
 #include "lve_frame_info.hpp"
+#include "lve_frame_packet.hpp"
 #include "lve_pipeline.hpp"
 
 // std
@@ -19,9 +20,13 @@ class SimpleRenderSystem {
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
   SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
-  void renderGameObjects(
+  // draws with commandCount > 0 read their commands from meshletCommands, which holds the
+  // packet's FramePacket::meshletCommands; called once per draw, so it isn't a profiler zone,
+  // callers profile their whole draw loop instead
+  void renderDraw(
 	  FrameInfo& frameInfo,
-	  LveGameObject& gameObject);
+	  const DrawPacket& draw,
+	  VkBuffer meshletCommands = VK_NULL_HANDLE);
 
  private:
   void createPipelineLayout(VkDescriptorSetLayout globalSetlayout);
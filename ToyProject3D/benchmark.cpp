@@ -0,0 +1,1049 @@
+#include "benchmark.hpp"
+#include "GraphicsCore/VulkanRHI/lve_bvh.hpp"
+#include "GraphicsCore/VulkanRHI/lve_camera.hpp"
+#include "GraphicsCore/VulkanRHI/lve_components.hpp"
+#include "GraphicsCore/VulkanRHI/lve_entity_registry.hpp"
+#include "GraphicsCore/VulkanRHI/lve_frame_packet.hpp"
+#include "GraphicsCore/VulkanRHI/lve_job_system.hpp"
+#include "GraphicsCore/VulkanRHI/lve_mesh_lods.hpp"
+#include "GraphicsCore/VulkanRHI/lve_resource_pool.hpp"
+#include "GraphicsCore/VulkanRHI/lve_scene_graph.hpp"
+#include "GraphicsCore/VulkanRHI/lve_transform_batch.hpp"
+#include "GraphicsCore/VulkanRHI/lve_triangle_bvh.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+// nearest-rank percentile of an already sorted range
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  rank = std::clamp<size_t>(rank, 1, sorted.size());
+  return sorted[rank - 1];
+}
+
+void writeCommandAverages(std::ostream &out, const LveCommandStats &totals, uint64_t frames) {
+  const double scale = frames == 0 ? 0.0 : 1.0 / frames;
+  out << "{\"draws\": " << totals.draws * scale
+      << ", \"indexedDraws\": " << totals.indexedDraws * scale
+      << ", \"indirectDraws\": " << totals.indirectDraws * scale
+      << ", \"indexedPrimitives\": " << totals.indexedPrimitives * scale
+      << ", \"pipelineBinds\": " << totals.pipelineBinds * scale
+      << ", \"descriptorSetBinds\": " << totals.descriptorSetBinds * scale
+      << ", \"pushConstantBytes\": " << totals.pushConstantBytes * scale
+      << ", \"vertexBufferBinds\": " << totals.vertexBufferBinds * scale
+      << ", \"indexBufferBinds\": " << totals.indexBufferBinds * scale
+      << ", \"barriers\": " << totals.barriers * scale
+      << ", \"renderPasses\": " << totals.renderPasses * scale << "}";
+}
+
+void writeDistribution(std::ostream &out, std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  double sum = 0.0;
+  for (double value : values) {
+    sum += value;
+  }
+  out << "{\"avg\": " << (values.empty() ? 0.0 : sum / values.size())
+      << ", \"min\": " << (values.empty() ? 0.0 : values.front())
+      << ", \"max\": " << (values.empty() ? 0.0 : values.back())
+      << ", \"p50\": " << percentile(values, 50.0) << ", \"p95\": " << percentile(values, 95.0)
+      << ", \"p99\": " << percentile(values, 99.0) << "}";
+}
+
+// best instead of average, the other iterations mostly measure scheduler noise of the host
+template <typename Function>
+double bestTimeMs(int warmupIterations, int iterations, Function &&function) {
+  double bestMs = std::numeric_limits<double>::max();
+  for (int iteration = 0; iteration < warmupIterations + iterations; iteration++) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (iteration >= warmupIterations) {
+      bestMs = std::min(bestMs, ms);
+    }
+  }
+  return bestMs;
+}
+
+// latitude-longitude sphere with ripples of about triangleCount triangles, two per cell
+void buildRippledSphere(
+    size_t triangleCount, std::vector<glm::vec3> &positions, std::vector<uint32_t> &indices) {
+  const size_t columns = std::max<size_t>(
+      4, static_cast<size_t>(std::sqrt(static_cast<double>(triangleCount))));
+  const size_t rows = std::max<size_t>(2, triangleCount / (2 * columns));
+  positions.clear();
+  positions.reserve((rows + 1) * (columns + 1));
+  for (size_t row = 0; row <= rows; row++) {
+    const float polar = glm::pi<float>() * row / rows;
+    for (size_t column = 0; column <= columns; column++) {
+      const float azimuth = glm::two_pi<float>() * column / columns;
+      const float radius = 1.f + 0.05f * std::sin(13.f * polar) * std::cos(17.f * azimuth);
+      positions.push_back(
+          radius * glm::vec3{
+                       std::sin(polar) * std::cos(azimuth),
+                       std::cos(polar),
+                       std::sin(polar) * std::sin(azimuth)});
+    }
+  }
+  indices.clear();
+  indices.reserve(6 * rows * columns);
+  for (size_t row = 0; row < rows; row++) {
+    for (size_t column = 0; column < columns; column++) {
+      const uint32_t corner = static_cast<uint32_t>(row * (columns + 1) + column);
+      const uint32_t below = corner + static_cast<uint32_t>(columns + 1);
+      indices.insert(indices.end(), {corner, below, corner + 1, corner + 1, below, below + 1});
+    }
+  }
+}
+
+}  // namespace
+
+CameraPath CameraPath::loadFromFile(const std::string &filepath) {
+  std::ifstream file{filepath};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open camera path: " + filepath);
+  }
+
+  CameraPath path{};
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream stream{line};
+    Key key{};
+    if (!(stream >> key.time)) {
+      continue;  // blank or comment line
+    }
+    if (!(stream >> key.translation.x >> key.translation.y >> key.translation.z >>
+          key.rotation.x >> key.rotation.y >> key.rotation.z)) {
+      throw std::runtime_error("malformed camera path key in " + filepath + ": " + line);
+    }
+    key.rotation = glm::radians(key.rotation);
+    if (!path.keys.empty() && key.time <= path.keys.back().time) {
+      throw std::runtime_error("camera path keys must have increasing times: " + filepath);
+    }
+    path.keys.push_back(key);
+  }
+
+  if (path.keys.empty()) {
+    throw std::runtime_error("camera path has no keys: " + filepath);
+  }
+  return path;
+}
+
+CameraPath CameraPath::createOrbit(float radius, float height, float duration, int keyCount) {
+  // circles the origin looking at it, -y is up so a negative height orbits above the grid
+  CameraPath path{};
+  const float pitch = -std::atan2(-height, radius);
+  for (int i = 0; i <= keyCount; i++) {
+    const float t = static_cast<float>(i) / keyCount;
+    const float angle = t * glm::two_pi<float>();
+    Key key{};
+    key.time = t * duration;
+    key.translation = {radius * std::sin(angle), height, radius * std::cos(angle)};
+    // facing the origin, kept continuous so interpolation never spins the long way around
+    key.rotation = {pitch, angle + glm::pi<float>(), 0.f};
+    path.keys.push_back(key);
+  }
+  return path;
+}
+
+void CameraPath::apply(float time, LveGameObject &viewerObject) const {
+  if (keys.empty()) {
+    return;
+  }
+  if (keys.size() == 1 || duration() <= 0.f) {
+    viewerObject.transform.translation = keys.front().translation;
+    viewerObject.transform.rotation = keys.front().rotation;
+    return;
+  }
+
+  time = std::fmod(time, duration());
+  auto next = std::upper_bound(
+      keys.begin(), keys.end(), time, [](float t, const Key &key) { return t < key.time; });
+  if (next == keys.begin()) {
+    next++;
+  } else if (next == keys.end()) {
+    next--;
+  }
+  const Key &a = *(next - 1);
+  const Key &b = *next;
+  const float alpha = std::clamp((time - a.time) / (b.time - a.time), 0.f, 1.f);
+
+  viewerObject.transform.translation = glm::mix(a.translation, b.translation, alpha);
+  viewerObject.transform.rotation = glm::mix(a.rotation, b.rotation, alpha);
+}
+
+BenchmarkRecorder::BenchmarkRecorder(const BenchmarkConfigInfo &configInfo) : config{configInfo} {
+  const size_t frames = config.enabled ? static_cast<size_t>(std::max(config.frameCount, 0)) : 0;
+  samples.reserve(frames);
+  vertexInvocations.reserve(frames);
+  fragmentInvocations.reserve(frames);
+}
+
+void BenchmarkRecorder::addGpuZone(const char *zone, double ms) {
+  auto it = std::find_if(gpuZoneMs.begin(), gpuZoneMs.end(), [&](const auto &entry) {
+    return entry.first == zone;
+  });
+  if (it == gpuZoneMs.end()) {
+    gpuZoneMs.push_back({zone, {}});
+    it = gpuZoneMs.end() - 1;
+    it->second.reserve(samples.capacity());
+  }
+  it->second.push_back(ms);
+}
+
+void BenchmarkRecorder::addPipelineStatistics(
+    uint64_t vertexInvocations, uint64_t fragmentInvocations) {
+  this->vertexInvocations.push_back(static_cast<double>(vertexInvocations));
+  this->fragmentInvocations.push_back(static_cast<double>(fragmentInvocations));
+}
+
+void BenchmarkRecorder::addCommandStats(const LveCommandStatsCollector &commandStats) {
+  if (!LveCommandStatsCollector::enabled) {
+    return;
+  }
+  commandStatsFrames++;
+  commandTotals += commandStats.getFrameStats();
+  for (const auto &[name, stats] : commandStats.getScopeStats()) {
+    auto it = std::find_if(
+        commandScopeTotals.begin(),
+        commandScopeTotals.end(),
+        [&](const auto &entry) { return entry.first == name; });
+    if (it == commandScopeTotals.end()) {
+      commandScopeTotals.push_back({name, {}});
+      it = commandScopeTotals.end() - 1;
+    }
+    it->second += stats;
+  }
+}
+
+void BenchmarkRecorder::setStreamingResult(
+    uint64_t uploadedBytes, double seconds, bool dedicatedTransferQueue) {
+  streamedBytes = uploadedBytes;
+  streamingSeconds = seconds;
+  streamedOnDedicatedQueue = dedicatedTransferQueue;
+}
+
+double BenchmarkRecorder::averageFrameMs() const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (const auto &sample : samples) {
+    sum += sample.frameMs;
+  }
+  return sum / samples.size();
+}
+
+const char *BenchmarkRecorder::phaseName(BenchmarkPhase phase) {
+  switch (phase) {
+    case BenchmarkPhase::Update:
+      return "update";
+    case BenchmarkPhase::Culling:
+      return "culling";
+    case BenchmarkPhase::Recording:
+      return "recording";
+    case BenchmarkPhase::Submit:
+      return "submit";
+    case BenchmarkPhase::PresentWait:
+      return "presentWait";
+    case BenchmarkPhase::SimulationWait:
+      return "simulationWait";
+    default:
+      return "unknown";
+  }
+}
+
+void BenchmarkRecorder::writeReport(
+    const std::string &presentMode,
+    int framesInFlight,
+    size_t sceneObjects,
+    int recordingThreads,
+    bool pipelined) const {
+  std::ofstream out{config.reportPath};
+  if (!out.is_open()) {
+    throw std::runtime_error("failed to open benchmark report: " + config.reportPath);
+  }
+
+  std::vector<double> values(samples.size());
+  auto collect = [&](auto &&getter) {
+    for (size_t i = 0; i < samples.size(); i++) {
+      values[i] = getter(samples[i]);
+    }
+    return values;
+  };
+
+  out << "{\n";
+  out << "  \"frames\": " << samples.size() << ",\n";
+  out << "  \"warmupFrames\": " << config.warmupFrames << ",\n";
+  out << "  \"fixedDt\": " << config.fixedDt << ",\n";
+  out << "  \"cameraPath\": \""
+      << (config.cameraPathFile.empty() ? "orbit" : config.cameraPathFile) << "\",\n";
+  out << "  \"sceneObjects\": " << sceneObjects << ",\n";
+  out << "  \"framesInFlight\": " << framesInFlight << ",\n";
+  out << "  \"presentMode\": \"" << presentMode << "\",\n";
+  out << "  \"recordingThreads\": " << recordingThreads << ",\n";
+  out << "  \"pipelined\": " << (pipelined ? "true" : "false") << ",\n";
+  const double avgFrameMs = averageFrameMs();
+  out << "  \"throughputFps\": " << (avgFrameMs > 0.0 ? 1000.0 / avgFrameMs : 0.0) << ",\n";
+
+  out << "  \"frameTimeMs\": ";
+  writeDistribution(out, collect([](const FrameSample &s) { return s.frameMs; }));
+  out << ",\n";
+
+  out << "  \"phasesMs\": {\n";
+  for (size_t phase = 0; phase < static_cast<size_t>(BenchmarkPhase::Count); phase++) {
+    out << "    \"" << phaseName(static_cast<BenchmarkPhase>(phase)) << "\": ";
+    writeDistribution(out, collect([phase](const FrameSample &s) { return s.phaseMs[phase]; }));
+    out << (phase + 1 < static_cast<size_t>(BenchmarkPhase::Count) ? ",\n" : "\n");
+  }
+  out << "  },\n";
+
+  out << "  \"gpuMs\": {";
+  for (size_t zone = 0; zone < gpuZoneMs.size(); zone++) {
+    out << (zone == 0 ? "\n" : ",\n") << "    \"" << gpuZoneMs[zone].first << "\": ";
+    writeDistribution(out, gpuZoneMs[zone].second);
+  }
+  out << (gpuZoneMs.empty() ? "},\n" : "\n  },\n");
+
+  if (!vertexInvocations.empty()) {
+    out << "  \"pipelineStatistics\": {\n    \"vertexInvocations\": ";
+    writeDistribution(out, vertexInvocations);
+    out << ",\n    \"fragmentInvocations\": ";
+    writeDistribution(out, fragmentInvocations);
+    out << "\n  },\n";
+  }
+
+  if (commandStatsFrames > 0) {
+    out << "  \"commandsPerFrame\": {\n    \"total\": ";
+    writeCommandAverages(out, commandTotals, commandStatsFrames);
+    for (const auto &[name, totals] : commandScopeTotals) {
+      out << ",\n    \"" << name << "\": ";
+      writeCommandAverages(out, totals, commandStatsFrames);
+    }
+    out << "\n  },\n";
+  }
+
+  if (config.streamBytesPerFrame > 0) {
+    const double megabytes = streamedBytes / (1024.0 * 1024.0);
+    out << "  \"streaming\": {\"bytesPerFrame\": " << config.streamBytesPerFrame
+        << ", \"dedicatedTransferQueue\": " << (streamedOnDedicatedQueue ? "true" : "false")
+        << ", \"uploadedMB\": " << megabytes << ", \"throughputMBps\": "
+        << (streamingSeconds > 0.0 ? megabytes / streamingSeconds : 0.0) << "},\n";
+  }
+
+  const bool clusterCulled = std::any_of(samples.begin(), samples.end(), [](const FrameSample &s) {
+    return s.meshletTriangles > 0;
+  });
+  if (clusterCulled) {
+    out << "  \"clusterCulling\": {\n    \"trianglesTested\": ";
+    writeDistribution(
+        out,
+        collect([](const FrameSample &s) { return static_cast<double>(s.meshletTriangles); }));
+    out << ",\n    \"trianglesCulled\": ";
+    writeDistribution(
+        out,
+        collect([](const FrameSample &s) { return static_cast<double>(s.culledTriangles); }));
+    out << "\n  },\n";
+  }
+
+  out << "  \"drawCalls\": ";
+  writeDistribution(
+      out,
+      collect([](const FrameSample &s) { return static_cast<double>(s.drawCount); }));
+  out << "\n}\n";
+
+  std::cout << "benchmark report written to " << config.reportPath << std::endl;
+}
+
+void runJobScalingBenchmark(size_t objectCount, int maxThreads) {
+  constexpr int WARMUP_ITERATIONS = 10;
+  constexpr int ITERATIONS = 100;
+
+  std::vector<TransformComponent> transforms(objectCount);
+  for (size_t i = 0; i < objectCount; i++) {
+    const float f = static_cast<float>(i);
+    transforms[i].translation = {f, 0.5f * f, -f};
+    transforms[i].rotation = {0.01f * f, 0.02f * f, 0.03f * f};
+  }
+  std::vector<glm::mat4> modelMatrices(objectCount);
+  std::vector<glm::mat3> normalMatrices(objectCount);
+
+  std::cout << "job system scaling, " << objectCount << " transforms, best of " << ITERATIONS
+            << " iterations\n";
+  std::cout << "threads        ms   speedup  efficiency\n";
+  double singleThreadMs = 0.0;
+  for (int threads = 1; threads <= maxThreads; threads++) {
+    LveJobSystem jobSystem{threads - 1};
+    auto update = [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        modelMatrices[i] = transforms[i].mat4();
+        normalMatrices[i] = transforms[i].normalMatrix();
+      }
+    };
+
+    const double bestMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+      jobSystem.parallelFor(0, objectCount, 64, update);
+    });
+    if (threads == 1) {
+      singleThreadMs = bestMs;
+    }
+
+    const double speedup = singleThreadMs / bestMs;
+    std::cout << std::setw(7) << threads << std::fixed << std::setprecision(3) << std::setw(10)
+              << bestMs << std::setw(9) << std::setprecision(2) << speedup << "x"
+              << std::setw(11) << std::setprecision(0) << 100.0 * speedup / threads << "%\n";
+    std::cout.unsetf(std::ios::fixed);
+  }
+}
+
+void runEntityStorageBenchmark(size_t entityCount) {
+  constexpr int WARMUP_ITERATIONS = 2;
+  constexpr int ITERATIONS = 10;
+
+  // one object per entity with everything inline, as LveGameObject plus its world matrices was
+  struct ObjectLayout {
+    LveGameObject::id_t id;
+    std::shared_ptr<LveModel> model;
+    std::shared_ptr<LveTexture> texture;
+    TransformComponent transform;
+    glm::mat4 modelMatrix{1.f};
+    glm::mat3 normalMatrix{1.f};
+    LveModel::BoundingBox bounds;
+  };
+
+  std::vector<ObjectLayout> objects(entityCount);
+  LveEntityRegistry registry;
+  // stays empty, gathering pays for the handle lookup but every model resolves to null
+  LveDeletionQueue deletionQueue;
+  LveResourcePool<LveModel> modelPool{deletionQueue};
+  for (size_t i = 0; i < entityCount; i++) {
+    const float f = static_cast<float>(i);
+    TransformComponent transform{};
+    transform.translation = {f, 0.5f * f, -f};
+    transform.rotation = {0.01f * f, 0.02f * f, 0.03f * f};
+
+    objects[i].id = static_cast<LveGameObject::id_t>(i);
+    objects[i].transform = transform;
+
+    const LveEntity entity = registry.create();
+    registry.add<TransformComponent>(entity, transform);
+    registry.add<WorldTransformComponent>(entity);
+    registry.add<BoundsComponent>(entity);
+    registry.add<ModelComponent>(entity);
+    registry.add<TextureComponent>(entity);
+  }
+  std::vector<DrawPacket> draws;
+  draws.reserve(entityCount);
+  glm::vec3 translationSum{0.f};
+
+  std::cout << "entity storage, " << entityCount << " entities, best of " << ITERATIONS
+            << " iterations\n";
+  std::cout << "pass        objects ms  registry ms  speedup\n";
+  auto report = [](const char *pass, double objectMs, double registryMs) {
+    std::cout << std::left << std::setw(10) << pass << std::right << std::fixed
+              << std::setprecision(3) << std::setw(12) << objectMs << std::setw(13) << registryMs
+              << std::setw(8) << std::setprecision(2) << objectMs / registryMs << "x\n";
+    std::cout.unsetf(std::ios::fixed);
+  };
+
+  // world matrices from transforms, what updateTransforms does every frame
+  report(
+      "update",
+      bestTimeMs(
+          WARMUP_ITERATIONS,
+          ITERATIONS,
+          [&] {
+            for (auto &object : objects) {
+              object.modelMatrix = object.transform.mat4();
+              object.normalMatrix = object.transform.normalMatrix();
+            }
+          }),
+      bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+        registry.view<TransformComponent, WorldTransformComponent>().each(
+            [](LveEntity, TransformComponent &transform, WorldTransformComponent &world) {
+              world.modelMatrix = transform.mat4();
+              world.normalMatrix = transform.normalMatrix();
+            });
+      }));
+
+  // reading a single component, the object layout drags the rest of each object through cache
+  report(
+      "iterate",
+      bestTimeMs(
+          WARMUP_ITERATIONS,
+          ITERATIONS,
+          [&] {
+            for (const auto &object : objects) {
+              translationSum += object.transform.translation;
+            }
+          }),
+      bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+        registry.view<TransformComponent>().each([&](LveEntity, TransformComponent &transform) {
+          translationSum += transform.translation;
+        });
+      }));
+
+  // draw data for every entity, what culling hands to the renderer
+  report(
+      "gather",
+      bestTimeMs(
+          WARMUP_ITERATIONS,
+          ITERATIONS,
+          [&] {
+            draws.clear();
+            for (const auto &object : objects) {
+              draws.push_back(
+                  {object.modelMatrix, object.normalMatrix, object.model.get(), object.id});
+            }
+          }),
+      bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+        draws.clear();
+        registry.view<WorldTransformComponent, ModelComponent>().each(
+            [&](LveEntity entity, WorldTransformComponent &world, ModelComponent &model) {
+              draws.push_back(
+                  {world.modelMatrix,
+                   world.normalMatrix,
+                   modelPool.find(model.model),
+                   entity.index});
+            });
+      }));
+
+  // keeps the read-only pass from being optimized away
+  if (translationSum.x == 1.f) {
+    std::cout << "\n";
+  }
+}
+
+void runTransformBatchBenchmark(size_t objectCount) {
+  constexpr int WARMUP_ITERATIONS = 3;
+  constexpr int ITERATIONS = 20;
+
+  std::mt19937 random{42};
+  std::vector<TransformComponent> transforms(objectCount);
+  std::array<std::vector<float>, 9> columns;  // translation, rotation, scale xyz
+  for (auto &column : columns) {
+    column.resize(objectCount);
+  }
+  std::vector<glm::mat4> modelMatrices(objectCount);
+  std::vector<glm::mat3> normalMatrices(objectCount);
+  const TransformBatchInput input{
+      {columns[0].data(), columns[1].data(), columns[2].data()},
+      {columns[3].data(), columns[4].data(), columns[5].data()},
+      {columns[6].data(), columns[7].data(), columns[8].data()}};
+
+  auto generate = [&](float maxAngle) {
+    std::uniform_real_distribution<float> position{-1000.f, 1000.f};
+    std::uniform_real_distribution<float> angle{-maxAngle, maxAngle};
+    std::uniform_real_distribution<float> scale{0.1f, 10.f};
+    for (size_t i = 0; i < objectCount; i++) {
+      transforms[i].translation = {position(random), position(random), position(random)};
+      transforms[i].rotation = {angle(random), angle(random), angle(random)};
+      transforms[i].scale = {scale(random), scale(random), scale(random)};
+      for (int axis = 0; axis < 3; axis++) {
+        columns[axis][i] = transforms[i].translation[axis];
+        columns[3 + axis][i] = transforms[i].rotation[axis];
+        columns[6 + axis][i] = transforms[i].scale[axis];
+      }
+    }
+  };
+
+  std::cout << "transform batch (" << transformBatchInstructionSet() << "), " << objectCount
+            << " transforms\n";
+
+  // error of each matrix column relative to the scale it carries, so it measures the rotation
+  std::cout << "angles        model error  normal error\n";
+  for (float maxAngle : {glm::pi<float>(), 100.f}) {
+    generate(maxAngle);
+    computeTransformMatrices(input, objectCount, modelMatrices.data(), normalMatrices.data());
+    float modelError = 0.f;
+    float normalError = 0.f;
+    for (size_t i = 0; i < objectCount; i++) {
+      const glm::mat4 model = transforms[i].mat4();
+      const glm::mat3 normal = transforms[i].normalMatrix();
+      for (int column = 0; column < 3; column++) {
+        const float scale = transforms[i].scale[column];
+        for (int row = 0; row < 3; row++) {
+          modelError = std::max(
+              modelError, std::abs(modelMatrices[i][column][row] - model[column][row]) / scale);
+          normalError = std::max(
+              normalError, std::abs(normalMatrices[i][column][row] - normal[column][row]) * scale);
+        }
+      }
+      modelError = std::max(modelError, glm::length(modelMatrices[i][3] - model[3]));
+    }
+    std::cout << "+-" << std::left << std::setw(11) << maxAngle << std::right << std::setw(12)
+              << modelError << std::setw(14) << normalError << "\n";
+  }
+
+  // one thread, so the rate is per core
+  const double glmMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+    for (size_t i = 0; i < objectCount; i++) {
+      modelMatrices[i] = transforms[i].mat4();
+      normalMatrices[i] = transforms[i].normalMatrix();
+    }
+  });
+  const double batchMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+    computeTransformMatrices(input, objectCount, modelMatrices.data(), normalMatrices.data());
+  });
+  // what updateTransforms does, gathering scattered components into the batch first
+  const double gatherMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+    LveTransformBatch batch;
+    for (size_t i = 0; i < objectCount; i++) {
+      batch.add(transforms[i], &modelMatrices[i], &normalMatrices[i]);
+    }
+    batch.flush();
+  });
+
+  std::cout << "path              ms  Mtransforms/s  speedup\n";
+  for (const auto &[path, ms] : {std::pair<const char *, double>{"glm", glmMs},
+                                 {"batch", batchMs},
+                                 {"batch + gather", gatherMs}}) {
+    std::cout << std::left << std::setw(14) << path << std::right << std::fixed
+              << std::setprecision(3) << std::setw(8) << ms << std::setw(15)
+              << std::setprecision(1) << objectCount / (ms * 1000.0) << std::setw(8)
+              << std::setprecision(2) << glmMs / ms << "x\n";
+    std::cout.unsetf(std::ios::fixed);
+  }
+}
+
+void runHierarchyBenchmark(size_t nodeCount, int threads) {
+  constexpr int WARMUP_ITERATIONS = 2;
+  constexpr int ITERATIONS = 10;
+
+  std::cout << "scene graph update, " << nodeCount << " nodes, best of " << ITERATIONS
+            << " iterations, patching included\n";
+  std::cout << "shape   levels  all 1 thread  all " << std::setw(2) << threads
+            << " threads  1% patched  unchanged\n";
+
+  // wide: one root with every other node as its child, deep: a single chain, tree: 8 children
+  // per node
+  for (const char *shape : {"wide", "deep", "tree"}) {
+    const std::string name = shape;
+    LveEntityRegistry registry;
+    LveSceneGraph graph;
+    std::vector<LveEntity> nodes(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+      nodes[i] = registry.create();
+      TransformComponent transform{};
+      transform.translation = {1.f, 0.f, 0.f};
+      transform.rotation = {0.f, 0.001f * static_cast<float>(i % 1000), 0.f};
+      registry.add<TransformComponent>(nodes[i], transform);
+      registry.add<WorldTransformComponent>(nodes[i]);
+
+      if (i == 0) {
+        graph.insert(nodes[i]);
+      } else {
+        graph.insert(nodes[i], nodes[name == "wide" ? 0 : name == "deep" ? i - 1 : (i - 1) / 8]);
+      }
+    }
+
+    LveComponentPool<TransformComponent> &transforms = registry.pool<TransformComponent>();
+    auto patch = [&](size_t stride) {
+      for (size_t i = stride / 2; i < nodeCount; i += stride) {
+        transforms.patch(nodes[i].index).rotation.x += 0.001f;
+      }
+    };
+
+    // one job system at a time, the calling thread belongs to the last one created
+    double serialMs = 0.0;
+    {
+      LveJobSystem jobSystem{0};
+      graph.update(registry, jobSystem);
+      serialMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+        patch(1);
+        graph.update(registry, jobSystem);
+      });
+    }
+    LveJobSystem jobSystem{threads - 1};
+    const double parallelMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+      patch(1);
+      graph.update(registry, jobSystem);
+    });
+    // spread out and missing the root, still in the deep chain the first one dirties half of it
+    const double partialMs = bestTimeMs(WARMUP_ITERATIONS, ITERATIONS, [&] {
+      patch(100);
+      graph.update(registry, jobSystem);
+    });
+    const double unchangedMs = bestTimeMs(
+        WARMUP_ITERATIONS, ITERATIONS, [&] { graph.update(registry, jobSystem); });
+
+    std::cout << std::left << std::setw(6) << shape << std::right << std::setw(8)
+              << graph.getLevelCount() << std::fixed << std::setprecision(3) << std::setw(14)
+              << serialMs << std::setw(15) << parallelMs << std::setw(12) << partialMs
+              << std::setw(11) << unchangedMs << "\n";
+    std::cout.unsetf(std::ios::fixed);
+  }
+}
+
+void runBvhBenchmark(size_t maxObjects) {
+  constexpr int ITERATIONS = 5;
+  constexpr size_t QUERIES = 10000;
+  constexpr size_t VERIFIED_QUERIES = 100;  // also answered by brute force
+  constexpr size_t NEAREST = 8;
+
+  for (size_t objectCount = 10000; objectCount <= maxObjects; objectCount *= 10) {
+    // same density at every size, about one object per 20^3 volume
+    const float side = 20.f * std::cbrt(static_cast<float>(objectCount));
+    std::mt19937 random{7};
+    std::uniform_real_distribution<float> position{0.f, side};
+    std::uniform_real_distribution<float> size{0.5f, 3.f};
+    std::uniform_real_distribution<float> unit{-1.f, 1.f};
+    auto randomBox = [&](float extent) {
+      const glm::vec3 center{position(random), position(random), position(random)};
+      return LveAabb{center - extent, center + extent};
+    };
+
+    std::vector<LveBvh::Item> items(objectCount);
+    for (size_t i = 0; i < objectCount; i++) {
+      items[i] = {randomBox(size(random)), static_cast<uint32_t>(i)};
+    }
+
+    LveBvh bvh;
+    std::vector<uint32_t> proxies;
+    const double buildMs = bestTimeMs(0, ITERATIONS, [&] { proxies = bvh.build(items); });
+    const float builtCost = bvh.getSahCost();
+    const int builtHeight = bvh.getHeight();
+    const double insertMs = bestTimeMs(0, 1, [&] {
+      LveBvh inserted;
+      for (const LveBvh::Item &item : items) {
+        inserted.createProxy(item.bounds, item.userData);
+      }
+    });
+
+    // a tenth of the objects moves by up to one unit, past the margin, each iteration
+    const double refitMs = bestTimeMs(0, ITERATIONS, [&] {
+      for (size_t i = 0; i < objectCount; i += 10) {
+        const glm::vec3 offset{unit(random), unit(random), unit(random)};
+        items[i].bounds = {items[i].bounds.min + offset, items[i].bounds.max + offset};
+        bvh.moveProxy(proxies[i], items[i].bounds);
+      }
+    });
+
+    std::cout << "bvh, " << objectCount << " objects: SAH build " << buildMs
+              << " ms (height " << builtHeight << ", SAH cost " << builtCost
+              << "), incremental insert " << insertMs << " ms, moving 10% " << refitMs
+              << " ms (SAH cost after " << ITERATIONS << " moves " << bvh.getSahCost() << ")\n";
+    std::cout << "query          per second  brute force/s  mismatches\n";
+    // rates of count bvh queries taking ms and of the brute force answers to the first few
+    auto report = [](const char *query, size_t count, double ms, size_t bruteCount,
+                     double bruteMs, size_t mismatches) {
+      std::cout << std::left << std::setw(13) << query << std::right << std::setw(12)
+                << static_cast<size_t>(count / (ms / 1000.0)) << std::setw(15)
+                << static_cast<size_t>(bruteCount / (bruteMs / 1000.0)) << std::setw(12)
+                << mismatches << " of " << bruteCount << "\n";
+    };
+    auto timeMs = [](auto &&function) { return bestTimeMs(0, 1, function); };
+
+    // from the middle of one face towards the center and halfway through, what culling asks
+    {
+      LveCamera camera{};
+      camera.setViewTarget(glm::vec3{0.5f * side, 0.5f * side, 0.f}, glm::vec3{0.5f * side});
+      camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, 0.5f * side);
+      const LveFrustum frustum =
+          LveFrustum::fromViewProjection(camera.getProjection() * camera.getView());
+      size_t visible = 0;
+      const double ms = bestTimeMs(1, ITERATIONS, [&] {
+        visible = 0;
+        bvh.queryFrustum(frustum, [&](uint32_t) { visible++; });
+      });
+      size_t expected = 0;
+      const double bruteMs = timeMs([&] {
+        for (const LveBvh::Item &item : items) {
+          expected += frustum.classify(item.bounds) != LveFrustum::Overlap::Outside;
+        }
+      });
+      report("frustum", 1, ms, 1, bruteMs, visible == expected ? 0 : 1);
+      std::cout << "  " << visible << " of " << objectCount << " visible\n";
+    }
+
+    std::vector<LveAabb> boxes(QUERIES);
+    std::vector<std::pair<glm::vec3, glm::vec3>> rays(QUERIES);
+    for (size_t i = 0; i < QUERIES; i++) {
+      boxes[i] = randomBox(10.f);
+      rays[i] = {boxes[i].center(), glm::normalize(glm::vec3{unit(random), unit(random), 1.f})};
+    }
+
+    std::vector<size_t> overlapCounts(QUERIES);
+    const double overlapMs = bestTimeMs(0, 1, [&] {
+      for (size_t i = 0; i < QUERIES; i++) {
+        overlapCounts[i] = 0;
+        bvh.queryOverlap(boxes[i], [&](uint32_t) { overlapCounts[i]++; });
+      }
+    });
+    size_t overlapMismatches = 0;
+    const double overlapBruteMs = timeMs([&] {
+      for (size_t i = 0; i < VERIFIED_QUERIES; i++) {
+        size_t expected = 0;
+        for (const LveBvh::Item &item : items) {
+          expected += item.bounds.overlaps(boxes[i]);
+        }
+        overlapMismatches += expected != overlapCounts[i];
+      }
+    });
+    report(
+        "aabb overlap", QUERIES, overlapMs, VERIFIED_QUERIES, overlapBruteMs, overlapMismatches);
+
+    // nearest hit, every hit shortens the ray
+    const float rayLength = 0.25f * side;
+    std::vector<float> hits(QUERIES);
+    const double rayMs = bestTimeMs(0, 1, [&] {
+      for (size_t i = 0; i < QUERIES; i++) {
+        hits[i] = rayLength;
+        bvh.queryRay(rays[i].first, rays[i].second, rayLength, [&](uint32_t, float t) {
+          hits[i] = std::min(hits[i], t);
+          return hits[i];
+        });
+      }
+    });
+    size_t rayMismatches = 0;
+    const double rayBruteMs = timeMs([&] {
+      for (size_t i = 0; i < VERIFIED_QUERIES; i++) {
+        float expected = rayLength;
+        const glm::vec3 inverseDirection = 1.f / rays[i].second;
+        for (const LveBvh::Item &item : items) {
+          const float t =
+              item.bounds.intersectRay(rays[i].first, inverseDirection, 0.f, expected);
+          if (t >= 0.f) {
+            expected = std::min(expected, t);
+          }
+        }
+        rayMismatches += expected != hits[i];
+      }
+    });
+    report("ray", QUERIES, rayMs, VERIFIED_QUERIES, rayBruteMs, rayMismatches);
+
+    std::vector<std::vector<std::pair<uint32_t, float>>> nearest(QUERIES);
+    const double nearestMs = bestTimeMs(0, 1, [&] {
+      for (size_t i = 0; i < QUERIES; i++) {
+        nearest[i] = bvh.queryNearest(rays[i].first, NEAREST);
+      }
+    });
+    size_t nearestMismatches = 0;
+    std::vector<float> distances(objectCount);
+    const double nearestBruteMs = timeMs([&] {
+      for (size_t i = 0; i < VERIFIED_QUERIES; i++) {
+        for (size_t object = 0; object < objectCount; object++) {
+          distances[object] = items[object].bounds.distanceSquared(rays[i].first);
+        }
+        std::nth_element(distances.begin(), distances.begin() + NEAREST - 1, distances.end());
+        nearestMismatches += distances[NEAREST - 1] != nearest[i].back().second;
+      }
+    });
+    report(
+        "8 nearest", QUERIES, nearestMs, VERIFIED_QUERIES, nearestBruteMs, nearestMismatches);
+  }
+}
+
+void runTriangleBvhBenchmark(size_t triangleCount, int threads) {
+  constexpr int ITERATIONS = 5;
+  constexpr size_t RAYS = 100000;
+  constexpr size_t VERIFIED_RAYS = 200;  // also answered by testing every triangle
+
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+  buildRippledSphere(triangleCount, positions, indices);
+  const size_t triangles = indices.size() / 3;
+
+  // one job system at a time, the owner thread can only belong to one
+  LveTriangleBvh bvh;
+  double serialMs = 0.0;
+  {
+    LveJobSystem jobSystem{0};
+    serialMs = bestTimeMs(0, ITERATIONS, [&] { bvh.build(positions, indices, jobSystem); });
+  }
+  double parallelMs = 0.0;
+  {
+    LveJobSystem jobSystem{threads - 1};
+    parallelMs = bestTimeMs(0, ITERATIONS, [&] { bvh.build(positions, indices, jobSystem); });
+  }
+
+  const uint64_t meshHash = LveTriangleBvh::hashMesh(positions, indices);
+  std::string cache;
+  const double saveMs = bestTimeMs(0, ITERATIONS, [&] {
+    std::ostringstream stream;
+    bvh.save(stream, meshHash);
+    cache = stream.str();
+  });
+  LveTriangleBvh loaded;
+  bool loadedMatches = true;
+  const double loadMs = bestTimeMs(0, ITERATIONS, [&] {
+    std::istringstream stream{cache};
+    loadedMatches = loaded.load(stream, meshHash) && loadedMatches;
+  });
+  std::istringstream staleStream{cache};
+  const bool staleRejected = !LveTriangleBvh{}.load(staleStream, meshHash + 1);
+  const double hashMs = bestTimeMs(0, ITERATIONS, [&] {
+    loadedMatches = LveTriangleBvh::hashMesh(positions, indices) == meshHash && loadedMatches;
+  });
+
+  std::cout << "triangle bvh, " << triangles << " triangles: build " << serialMs << " ms on 1 "
+            << "thread, " << parallelMs << " ms on " << threads << " (" << serialMs / parallelMs
+            << "x), " << bvh.getNodeCount() << " nodes, " << bvh.getMemorySize() / 1024
+            << " KiB\n";
+  std::cout << "cache: write " << saveMs << " ms, hash mesh " << hashMs << " ms, read " << loadMs
+            << " ms, " << (loadedMatches ? "loaded" : "NOT loaded") << ", stale cache "
+            << (staleRejected ? "rejected" : "NOT rejected") << "\n";
+
+  // from a shell around the mesh towards points near its center, most hit and some miss
+  std::mt19937 random{11};
+  std::uniform_real_distribution<float> unit{-1.f, 1.f};
+  auto randomDirection = [&] {
+    glm::vec3 direction;
+    do {
+      direction = {unit(random), unit(random), unit(random)};
+    } while (glm::dot(direction, direction) > 1.f || glm::dot(direction, direction) < 1e-4f);
+    return glm::normalize(direction);
+  };
+  std::vector<std::pair<glm::vec3, glm::vec3>> rays(RAYS);
+  for (auto &[origin, direction] : rays) {
+    origin = 3.f * randomDirection();
+    direction = glm::normalize(randomDirection() - origin);
+  }
+  constexpr float RAY_LENGTH = 10.f;
+
+  std::vector<LveTriangleBvh::Hit> hits(RAYS);
+  std::vector<uint8_t> found(RAYS);
+  const double closestMs = bestTimeMs(1, ITERATIONS, [&] {
+    for (size_t i = 0; i < RAYS; i++) {
+      found[i] = loaded.intersect(rays[i].first, rays[i].second, RAY_LENGTH, hits[i]);
+    }
+  });
+  size_t occludedCount = 0;
+  const double occlusionMs = bestTimeMs(1, ITERATIONS, [&] {
+    occludedCount = 0;
+    for (const auto &[origin, direction] : rays) {
+      occludedCount += loaded.occluded(origin, direction, RAY_LENGTH);
+    }
+  });
+  const size_t hitCount = std::count(found.begin(), found.end(), uint8_t{1});
+
+  // Moeller-Trumbore over every triangle, hits on shared edges may name either triangle
+  size_t mismatches = 0;
+  const double bruteMs = bestTimeMs(0, 1, [&] {
+    for (size_t i = 0; i < VERIFIED_RAYS; i++) {
+      const auto &[origin, direction] = rays[i];
+      float closest = RAY_LENGTH;
+      for (size_t triangle = 0; triangle < triangles; triangle++) {
+        const glm::vec3 &a = positions[indices[3 * triangle]];
+        const glm::vec3 edge1 = positions[indices[3 * triangle + 1]] - a;
+        const glm::vec3 edge2 = positions[indices[3 * triangle + 2]] - a;
+        const glm::vec3 p = glm::cross(direction, edge2);
+        const float determinant = glm::dot(edge1, p);
+        if (std::abs(determinant) <= std::numeric_limits<float>::min()) {
+          continue;
+        }
+        const glm::vec3 s = origin - a;
+        const float u = glm::dot(s, p) / determinant;
+        const glm::vec3 q = glm::cross(s, edge1);
+        const float v = glm::dot(direction, q) / determinant;
+        const float t = glm::dot(edge2, q) / determinant;
+        if (u >= 0.f && v >= 0.f && u + v <= 1.f && t > 0.f && t < closest) {
+          closest = t;
+        }
+      }
+      const bool expected = closest < RAY_LENGTH;
+      mismatches += expected != static_cast<bool>(found[i]) ||
+                    (expected && std::abs(closest - hits[i].t) > 1e-4f * closest);
+    }
+  });
+  auto raysPerSecond = [](size_t count, double ms) {
+    return static_cast<size_t>(count / (ms / 1000.0));
+  };
+  std::cout << "rays: " << hitCount << " of " << RAYS << " hit, closest hit "
+            << raysPerSecond(RAYS, closestMs) << " rays/s, occlusion "
+            << raysPerSecond(RAYS, occlusionMs) << " rays/s (" << occludedCount
+            << " occluded), every triangle " << raysPerSecond(VERIFIED_RAYS, bruteMs)
+            << " rays/s, " << mismatches << " of " << VERIFIED_RAYS << " mismatched\n";
+}
+
+
+void runMeshLodBenchmark(size_t triangleCount) {
+  constexpr int ITERATIONS = 5;
+  // file layout of LveMeshLods::save: magic, version, mesh hash, level and index counts, levels
+  constexpr size_t LODS_OFFSET = 2 * sizeof(uint32_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+  constexpr size_t LOD0_INDEX_COUNT_OFFSET = LODS_OFFSET + sizeof(uint32_t);
+
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+  buildRippledSphere(triangleCount, positions, indices);
+  const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+  const uint32_t meshIndexCount = static_cast<uint32_t>(indices.size());
+
+  LveMeshLods lods;
+  const double buildMs = bestTimeMs(0, ITERATIONS, [&] { lods.build(positions, indices); });
+  if (lods.getLodCount() < 2) {
+    throw std::runtime_error("lod benchmark: the sphere was not simplified");
+  }
+
+  const uint64_t meshHash = LveTriangleBvh::hashMesh(positions, indices);
+  std::ostringstream saveStream;
+  lods.save(saveStream, meshHash);
+  const std::string cache = saveStream.str();
+  auto loads = [&](const std::string &file, uint64_t hash, uint32_t indexCount) {
+    std::istringstream stream{file};
+    return LveMeshLods{}.load(stream, hash, vertexCount, indexCount);
+  };
+  bool loaded = true;
+  const double loadMs = bestTimeMs(0, ITERATIONS, [&] {
+    loaded = loads(cache, meshHash, meshIndexCount) && loaded;
+  });
+
+  // each of these must be refused, a draw of level 0 would read past the mesh's indices or
+  // a simplified level would index vertices the mesh doesn't have
+  auto withValue = [&](size_t offset, uint32_t value) {
+    std::string file = cache;
+    std::memcpy(&file[offset], &value, sizeof(value));
+    return file;
+  };
+  const std::pair<const char *, bool> tampered[] = {
+      {"level 0 larger than the mesh",
+       loads(withValue(LOD0_INDEX_COUNT_OFFSET, meshIndexCount + 3), meshHash, meshIndexCount)},
+      {"level 0 smaller than the mesh",
+       loads(withValue(LOD0_INDEX_COUNT_OFFSET, meshIndexCount - 3), meshHash, meshIndexCount)},
+      {"index past the vertices",
+       loads(withValue(cache.size() - sizeof(uint32_t), vertexCount), meshHash, meshIndexCount)},
+      {"truncated", loads(cache.substr(0, cache.size() - 1), meshHash, meshIndexCount)},
+      {"other mesh", loads(cache, meshHash + 1, meshIndexCount)},
+      {"other index count", loads(cache, meshHash, meshIndexCount + 3)},
+  };
+
+  std::cout << "lods, " << meshIndexCount / 3 << " triangles: build " << buildMs << " ms, "
+            << lods.getLodCount() << " levels of";
+  for (uint32_t lod = 0; lod < lods.getLodCount(); lod++) {
+    std::cout << " " << lods.getLod(lod).indexCount / 3;
+  }
+  std::cout << " triangles\ncache: read " << loadMs << " ms, "
+            << (loaded ? "loaded" : "NOT loaded") << "\n";
+  size_t accepted = 0;
+  for (const auto &[name, wasLoaded] : tampered) {
+    std::cout << "tampered cache, " << name << ": " << (wasLoaded ? "NOT rejected" : "rejected")
+              << "\n";
+    accepted += wasLoaded;
+  }
+  if (!loaded || accepted != 0) {
+    throw std::runtime_error("lod benchmark: cache round trip failed");
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "GraphicsCore/VulkanRHI/lve_command_stats.hpp"
+#include "GraphicsCore/VulkanRHI/lve_game_object.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+struct BenchmarkConfigInfo {
+  bool enabled = false;
+  std::string cameraPathFile;  // empty uses a procedural orbit around the scene
+  int frameCount = 1000;       // measured frames
+  int warmupFrames = 60;       // rendered before measuring, not part of the report
+  float fixedDt = 1.f / 60.f;  // simulation step, independent of the measured frame time
+  int sceneCopies = 0;         // extra bb8/vase instances laid out on a grid
+  size_t streamBytesPerFrame = 0;  // uploaded each frame while rendering, 0 disables streaming
+  std::string reportPath = "benchmark.json";
+};
+
+// A sequence of viewer transforms, linearly interpolated and looped over its duration.
+class CameraPath {
+ public:
+  struct Key {
+    float time;
+    glm::vec3 translation;
+    glm::vec3 rotation;  // radians, same convention as TransformComponent
+  };
+
+  // One key per line: "time tx ty tz rx ry rz" with the rotation in degrees, '#' starts a comment
+  static CameraPath loadFromFile(const std::string &filepath);
+  static CameraPath createOrbit(float radius, float height, float duration, int keyCount = 64);
+
+  void apply(float time, LveGameObject &viewerObject) const;
+  float duration() const { return keys.empty() ? 0.f : keys.back().time; }
+
+ private:
+  std::vector<Key> keys;
+};
+
+// SimulationWait is the time the render thread waited for a frame packet when pipelined
+enum class BenchmarkPhase {
+  Update,
+  Culling,
+  Recording,
+  Submit,
+  PresentWait,
+  SimulationWait,
+  Count
+};
+
+// Collects per-frame CPU timings and writes percentiles as JSON for regression tracking.
+class BenchmarkRecorder {
+ public:
+  struct FrameSample {
+    double frameMs = 0.0;  // wall time since the previous frame, phases may overlap when pipelined
+    std::array<double, static_cast<size_t>(BenchmarkPhase::Count)> phaseMs{};
+    uint32_t drawCount = 0;
+    // triangles of the meshlets tested with cluster culling and of those it culled
+    uint64_t meshletTriangles = 0;
+    uint64_t culledTriangles = 0;
+  };
+
+  // reserves room for config.frameCount samples when enabled, adding them does not allocate
+  explicit BenchmarkRecorder(const BenchmarkConfigInfo &configInfo);
+
+  void addSample(const FrameSample &sample) { samples.push_back(sample); }
+  // GPU results arrive framesInFlight frames late and are collected separately, the first result
+  // of a zone reserves its storage
+  void addGpuZone(const char *zone, double ms);
+  void addPipelineStatistics(uint64_t vertexInvocations, uint64_t fragmentInvocations);
+  // summed per frame, reported as averages when command stats are compiled in
+  void addCommandStats(const LveCommandStatsCollector &commandStats);
+  // bytes whose upload finished during the measured frames
+  void setStreamingResult(uint64_t uploadedBytes, double seconds, bool dedicatedTransferQueue);
+  size_t sampleCount() const { return samples.size(); }
+  double averageFrameMs() const;
+
+  void writeReport(
+      const std::string &presentMode,
+      int framesInFlight,
+      size_t sceneObjects,
+      int recordingThreads,
+      bool pipelined) const;
+
+  static const char *phaseName(BenchmarkPhase phase);
+
+ private:
+  BenchmarkConfigInfo config;
+  std::vector<FrameSample> samples;
+  std::vector<std::pair<std::string, std::vector<double>>> gpuZoneMs;  // in first-seen order
+  std::vector<double> vertexInvocations;
+  std::vector<double> fragmentInvocations;
+  uint64_t commandStatsFrames = 0;
+  LveCommandStats commandTotals{};
+  std::vector<std::pair<std::string, LveCommandStats>> commandScopeTotals;
+  uint64_t streamedBytes = 0;
+  double streamingSeconds = 0.0;
+  bool streamedOnDedicatedQueue = false;
+};
+
+// Times the per-object transform update through LveJobSystem::parallelFor with 1 to maxThreads
+// threads and prints the speedup over a single thread. Needs no device or window.
+void runJobScalingBenchmark(size_t objectCount, int maxThreads);
+
+// Compares LveEntityRegistry views against an array of whole objects, the layout the scene had as
+// std::vector<LveGameObject>, for updating world matrices, reading one component and gathering
+// draw data of entityCount entities on one thread.
+void runEntityStorageBenchmark(size_t entityCount);
+
+// Checks computeTransformMatrices against TransformComponent::mat4 and normalMatrix for small and
+// large angles, then compares single-thread throughput of both for objectCount transforms.
+void runTransformBatchBenchmark(size_t objectCount);
+
+// Times LveSceneGraph::update on a wide, a deep and a branching hierarchy of nodeCount nodes, with
+// every node patched on one and on all threads, with 1% patched and with nothing patched.
+void runHierarchyBenchmark(size_t nodeCount, int threads);
+
+// Builds LveBvh over 10k, 100k, ... up to maxObjects random boxes, times SAH builds, incremental
+// inserts and moving objects, then frustum, overlap, ray and nearest neighbour queries, checking
+// a sample of the answers against brute force.
+void runBvhBenchmark(size_t maxObjects);
+
+// Builds LveTriangleBvh over a bumpy sphere of about triangleCount triangles on one and on all
+// threads, times writing and reading it back as a cache would, then casts closest hit and
+// occlusion rays and checks a sample of the hits against testing every triangle.
+void runTriangleBvhBenchmark(size_t triangleCount, int threads);
+
+// Builds LveMeshLods for a bumpy sphere of about triangleCount triangles, times the build and
+// reading the levels back from a cache, then checks that caches with a damaged level 0, an index
+// past the vertices, a cut off end or another mesh's hash or index count are rejected. Throws if
+// one of them is loaded.
+void runMeshLodBenchmark(size_t triangleCount);
+
+}  // namespace lve
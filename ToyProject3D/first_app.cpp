@@ -1,9 +1,13 @@
 #include "first_app.hpp"
 
 #include "keyboard_movement_controller.hpp"
+#include "GraphicsCore/VulkanRHI/lve_allocation_counter.hpp"
 #include "GraphicsCore/VulkanRHI/lve_buffer.hpp"
 #include "GraphicsCore/VulkanRHI/lve_frame_info.hpp"
 #include "GraphicsCore/VulkanRHI/lve_camera.hpp"
+#include "GraphicsCore/VulkanRHI/lve_profiler.hpp"
+#include "GraphicsCore/VulkanRHI/lve_triple_buffer.hpp"
+#include "GraphicsCore/VulkanRHI/lve_upload_queue.hpp"
 #include "GraphicsCore/VulkanRHI/simple_render_system.hpp"
 #include "GraphicsCore/VulkanRHI/grid_render_system.hpp"
 
@@ -15,39 +19,74 @@
 
 // std
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cassert>
+#include <cmath>
+#include <exception>
 #include <stdexcept>
 #include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <limits>
 #include <numeric>
+#include <thread>
 
 namespace lve {
 
+// visible objects recorded per secondary command buffer with parallelRecording
+constexpr size_t RECORDING_CHUNK_SIZE = 128;
+// streaming skips a frame's upload while this many frames' worth is still in flight
+constexpr size_t STREAM_FRAMES_IN_FLIGHT = 4;
+// frames that may still grow containers and arenas, after them the loop must not allocate
+constexpr int ALLOCATION_WARMUP_FRAMES = 10;
+// render systems with a command stats scope, SimpleRenderSystem and GridRenderSystem
+constexpr size_t COMMAND_STATS_SCOPES = 2;
+
 struct GlobalUbo {
 	glm::mat4 projectionViewMatrix{ 1.f };
 	glm::vec3 lightDirection = glm::normalize(glm::vec3{1.f, -3.f, -1.f});
 };
 
-FirstApp::FirstApp() {
+FirstApp::FirstApp(const FirstAppConfigInfo& configInfo) : config{configInfo} {
+	for (int thread = 0; thread < jobSystem.getThreadCount(); thread++) {
+		frameArenas.push_back(std::make_unique<LveFrameArena>());
+	}
+	meshletCullStats.assign(jobSystem.getThreadCount(), {});
 	loadGameObjects();
 	makeGridObject();
+	viewerObject.transform.translation = { 0.f, -30.f, -50.f };
+	viewerObject.transform.rotation = { glm::radians(-25.f), glm::radians(0.0001f), 0.f };
+	cameraPath = config.benchmark.cameraPathFile.empty()
+		? CameraPath::createOrbit(60.f, -30.f, 20.f)
+		: CameraPath::loadFromFile(config.benchmark.cameraPathFile);
+	const uint32_t framesInFlight = static_cast<uint32_t>(lveRenderer.getFramesInFlight());
+	// a set per entity and frame, plus the grid's ubo only set per frame
 	globalPool = LveDescriptorPool::Builder(lveDevice)
-		.setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT * gameObjects.size())
-		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT * gameObjects.size())
-		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, LveSwapChain::MAX_FRAMES_IN_FLIGHT * gameObjects.size())
+		.setMaxSets(framesInFlight * (scene.getEntityCount() + 1))
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight * (scene.getEntityCount() + 1))
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, framesInFlight * scene.getEntityCount())
 		.build();
 }
 
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {
+	LVE_PROFILE_THREAD("main");
 	// find lowest common multiple
 	auto minOffsetAlignment = std::lcm(
 		lveDevice.properties.limits.minUniformBufferOffsetAlignment,
 		lveDevice.properties.limits.nonCoherentAtomSize
 	);
 
-	std::vector<std::unique_ptr<LveBuffer>> uboBuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+	const int framesInFlight = lveRenderer.getFramesInFlight();
+	// once, recreated swap chains keep the mode the policy picked from the same surface
+	if (!config.headless) {
+		std::cout << "present mode: " << LveSwapChain::presentModeName(lveRenderer.getPresentMode())
+			<< " | frames in flight: " << framesInFlight << std::endl;
+	}
+
+	std::vector<std::unique_ptr<LveBuffer>> uboBuffers(framesInFlight);
 	for (int i = 0; i < uboBuffers.size(); ++i)
 	{
 		uboBuffers[i] = std::make_unique<LveBuffer>(
@@ -61,7 +100,7 @@ void FirstApp::run() {
 		uboBuffers[i]->map();
 	}
 
-	//std::vector<std::unique_ptr<LveTexture>> imageInfos(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+	//std::vector<std::unique_ptr<LveTexture>> imageInfos(framesInFlight);
 	//for (int i = 0; i < imageInfos.size(); ++i)
 	//{
 	//	imageInfos[i] = std::make_unique<LveTexture>(lveDevice);
@@ -72,19 +111,28 @@ void FirstApp::run() {
 		.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
 		.build();
 
-	std::vector<std::vector<VkDescriptorSet>> globalDescriptorSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+	// indexed by entity, every textured entity has one set per frame
+	std::vector<std::vector<VkDescriptorSet>> globalDescriptorSets(framesInFlight);
+	// the grid only reads the ubo, its sets leave the texture binding unwritten
+	std::vector<VkDescriptorSet> gridDescriptorSets(framesInFlight, VK_NULL_HANDLE);
 	for (int i = 0; i < globalDescriptorSets.size(); i++) {
-		for (auto& obj : gameObjects) {
+		auto gridBufferInfo = uboBuffers[i]->descriptorInfo();
+		LveDescriptorWriter(*globalSetLayout, *globalPool)
+			.writeBuffer(0, &gridBufferInfo)
+			.build(gridDescriptorSets[i]);
+
+		globalDescriptorSets[i].resize(scene.getSlotCount(), VK_NULL_HANDLE);
+		scene.view<TextureComponent>().each([&](LveEntity entity, TextureComponent& texture) {
 			VkDescriptorSet objDescriptorSet;
 			auto bufferInfo = uboBuffers[i]->descriptorInfo();
-			auto ImageInfo = obj.texture->descriptorInfo();
+			auto ImageInfo = texturePool.get(texture.texture).descriptorInfo();
 			LveDescriptorWriter(*globalSetLayout, *globalPool)
 				.writeBuffer(0, &bufferInfo)
 				.writeImage(1, &ImageInfo)
 				.build(objDescriptorSet);
 
-			globalDescriptorSets[i].push_back(objDescriptorSet);
-		}
+			globalDescriptorSets[i][entity.index] = objDescriptorSet;
+		});
 	}
 
   SimpleRenderSystem simpleRenderSystem{
@@ -95,91 +143,799 @@ void FirstApp::run() {
 	  lveDevice,
 	  lveRenderer.getSwapChainRenderPass(),
 	  globalSetLayout->getDescriptorSetLayout() };
-  LveCamera camera{};
 
-  auto viewerObject = LveGameObject::createGameObject();
-  viewerObject.transform.translation = { 0.f, -30.f, -50.f };
-  viewerObject.transform.rotation = { glm::radians(-25.f), glm::radians(0.0001f), 0.f };
-  KeyboardMovementController cameraController{};
+  // benchmark mode: scripted camera, fixed dt and a bounded number of frames
+  const bool benchmarking = config.benchmark.enabled;
+  BenchmarkRecorder benchmarkRecorder{config.benchmark};
+  const int frameLimit = benchmarking
+	  ? config.benchmark.warmupFrames + config.benchmark.frameCount
+	  : config.frameCount;
+  LveGpuProfiler& gpuProfiler = lveRenderer.getGpuProfiler();
+  LveCommandStatsCollector& commandStats = lveRenderer.getCommandStats();
+  // sized for every object being visible, recording never grows them
+  const size_t maxRecordingChunks =
+	  (scene.getEntityCount() + RECORDING_CHUNK_SIZE - 1) / RECORDING_CHUNK_SIZE + 1;
+  std::vector<VkCommandBuffer> secondaryCommandBuffers;
+  std::vector<LveCommandStatsCollector> chunkCommandStats(maxRecordingChunks);
+  if (config.parallelRecording) {
+	  secondaryCommandBuffers.reserve(maxRecordingChunks);
+	  lveRenderer.reserveSecondaryCommandBuffers(maxRecordingChunks);
+	  for (auto& chunkStats : chunkCommandStats) {
+		  chunkStats.reserveScopes(COMMAND_STATS_SCOPES);
+	  }
+  }
+  commandStats.reserveScopes(COMMAND_STATS_SCOPES);
+  uint64_t gpuResolvedFrames = 0;
+
+  // cluster culling: per frame indirect commands with room for every meshlet in the scene, the
+  // simulation writes a draw's commands into its own range of the packet
+  uint32_t sceneMeshlets = 0;
+  scene.view<ModelComponent>().each([&](LveEntity, ModelComponent& model) {
+	  if (const LveMeshlets* meshlets = modelPool.get(model.model).getMeshlets()) {
+		  sceneMeshlets += meshlets->getMeshletCount();
+	  }
+  });
+  std::vector<std::unique_ptr<LveBuffer>> meshletCommandBuffers(framesInFlight);
+  if (config.clusterCulling && sceneMeshlets > 0) {
+	  for (auto& buffer : meshletCommandBuffers) {
+		  buffer = std::make_unique<LveBuffer>(
+			  lveDevice,
+			  sizeof(VkDrawIndexedIndirectCommand),
+			  sceneMeshlets,
+			  VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		  buffer->map();
+	  }
+	  std::cout << "cluster culling: " << sceneMeshlets << " meshlets"
+		  << " | multi draw indirect: " << (lveDevice.supportsMultiDrawIndirect() ? "yes" : "no")
+		  << " | mesh shaders: " << (lveDevice.supportsMeshShaders() ? "supported, unused" : "no")
+		  << std::endl;
+  }
+  LveMeshlets::CullStats meshletTotals{};
+  std::array<uint64_t, LveMeshLods::MAX_LODS> lodDrawTotals{};
 
-  auto currentTime = std::chrono::high_resolution_clock::now();
+  // streaming load: the measured rate is what the upload queue sustains while rendering
+  LveUploadQueue& uploadQueue = lveDevice.uploadQueue();
+  std::vector<uint8_t> streamData(config.benchmark.streamBytesPerFrame);
+  std::unique_ptr<LveBuffer> streamTarget;
+  if (!streamData.empty()) {
+	  std::iota(streamData.begin(), streamData.end(), uint8_t{0});
+	  // only ever written, nothing reads or renders its contents
+	  streamTarget = std::make_unique<LveBuffer>(
+		  lveDevice,
+		  streamData.size(),
+		  1,
+		  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+  uint64_t streamStartBytes = 0;
+  auto streamStartTime = std::chrono::steady_clock::now();
 
-  while (!lveWindow.shouldClose()) {
-    glfwPollEvents();
+  // Pipelined: the simulation runs on its own thread and hands finished packets to this loop,
+  // which keeps polling events, recording and submitting. It waits while a finished packet is
+  // still pending, so every packet gets rendered and it never runs more than a frame ahead.
+  LveTripleBuffer<FrameInput> inputs;
+  LveTripleBuffer<FramePacket> packets;
+  FramePacket serialPacket{};
+  // every packet has room for a draw per object and a command per meshlet, the simulation never
+  // grows them
+  auto reservePacket = [&](FramePacket& packet) {
+	  packet.draws.reserve(scene.getEntityCount());
+	  packet.meshletCommands.reserve(config.clusterCulling ? sceneMeshlets : 0);
+  };
+  reservePacket(serialPacket);
+  for (FramePacket& packet : packets.getSlots()) {
+	  reservePacket(packet);
+  }
+  std::atomic<bool> stopSimulation{false};
+  std::atomic<bool> simulationFailed{false};
+  std::exception_ptr simulationError;
+  std::thread simulationThread;
+  lastSimulationTime = std::chrono::steady_clock::now();
+  if (config.pipelinedRendering) {
+	  inputs.back() = sampleInput();
+	  inputs.publish();
+	  simulationThread = std::thread([&] {
+		  LVE_PROFILE_THREAD("simulation");
+		  jobSystem.attachThread();
+		  try {
+			  LveFrameArena& simulationArena = *frameArenas[jobSystem.currentThreadIndex()];
+			  LveFrameArenaBinding simulationArenaBinding{simulationArena};
+			  FrameInput input{};
+			  while (!stopSimulation.load(std::memory_order_relaxed)) {
+				  if (inputs.acquire()) {
+					  input = inputs.front();
+				  }
+				  simulationArena.reset();
+				  simulateFrame(input, packets.back());
+				  while (packets.hasPending() && !stopSimulation.load(std::memory_order_relaxed)) {
+					  std::this_thread::yield();
+				  }
+				  packets.publish();
+			  }
+		  } catch (...) {
+			  simulationError = std::current_exception();
+			  simulationFailed.store(true, std::memory_order_release);
+		  }
+		  jobSystem.detachThread();
+	  });
+  }
+  // stops the simulation however run() is left, a joinable std::thread must not be destroyed
+  struct SimulationThreadGuard {
+	  std::atomic<bool>& stop;
+	  std::thread& thread;
+	  ~SimulationThreadGuard() {
+		  stop.store(true, std::memory_order_relaxed);
+		  if (thread.joinable()) {
+			  thread.join();
+		  }
+	  }
+  } simulationThreadGuard{stopSimulation, simulationThread};
 
-	auto newTime = std::chrono::high_resolution_clock::now();
-	float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
-	currentTime = newTime;
+  auto lastFrameEnd = std::chrono::steady_clock::now();
 
-	
-	cameraController.moveInPlaneXZ(lveWindow.getGLFWwindow(), frameTime, viewerObject);
-	camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+  // accumulated swap chain wait times, reported once per second with printWaitStats
+  SwapChainWaitStats waitTotals{};
+  int waitFrames = 0;
+  float waitReportTime = 0.f;
 
-	float aspect = lveRenderer.getAspectRatio();
-	camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 3000.f);
+  // frame times of the whole run, reported when a frame count was requested
+  int renderedFrames = 0;
+  // heap allocations are counted from this frame on: containers and arenas have grown by then,
+  // a capture has made its readback buffer and the benchmark results their storage, which they
+  // get within the first measured frames
+  int allocationStartFrame = ALLOCATION_WARMUP_FRAMES;
+  if (benchmarking) {
+	  allocationStartFrame += config.benchmark.warmupFrames;
+  }
+  if (config.headless && config.captureFrame >= 0) {
+	  allocationStartFrame = std::max(allocationStartFrame, config.captureFrame + 1);
+  }
+  uint64_t warmAllocationCount = 0;
+  float totalFrameTime = 0.f;
+  float minFrameTime = std::numeric_limits<float>::max();
+  float maxFrameTime = 0.f;
 
-    if (auto commandBuffer = lveRenderer.beginFrame()) {
+  // temporaries of this thread and of the recording jobs come from the owner's and workers'
+  // arenas; the simulation thread resets its own
+  LveFrameArenaBinding frameArenaBinding{*frameArenas[0]};
+  while (!lveWindow.shouldClose() && (frameLimit == 0 || renderedFrames < frameLimit)) {
+	LVE_PROFILE_SCOPE("Frame");
+	if (!lveWindow.isHeadless()) {
+		glfwPollEvents();
+	}
+	// the previous frame's jobs have all finished, nothing points into the arenas anymore
+	for (int thread = 0; thread <= jobSystem.getWorkerCount(); thread++) {
+		frameArenas[thread]->reset();
+	}
+	if (renderedFrames == allocationStartFrame) {
+		warmAllocationCount = LveAllocationCounter::getCount();
+	}
+
+	BenchmarkRecorder::FrameSample sample{};
+	auto phaseStart = std::chrono::steady_clock::now();
+	auto endPhase = [&](BenchmarkPhase phase) {
+		auto now = std::chrono::steady_clock::now();
+		sample.phaseMs[static_cast<size_t>(phase)] +=
+			std::chrono::duration<double, std::milli>(now - phaseStart).count();
+		phaseStart = now;
+	};
+
+	const FramePacket* packet = &serialPacket;
+	if (config.pipelinedRendering) {
+		inputs.back() = sampleInput();
+		inputs.publish();
+		{
+			LVE_PROFILE_SCOPE("WaitForSimulation");
+			while (!packets.acquire()) {
+				if (simulationFailed.load(std::memory_order_acquire)) {
+					std::rethrow_exception(simulationError);
+				}
+				std::this_thread::yield();
+			}
+		}
+		packet = &packets.front();
+		endPhase(BenchmarkPhase::SimulationWait);
+	} else {
+		simulateFrame(sampleInput(), serialPacket);
+		phaseStart = std::chrono::steady_clock::now();
+	}
+	// simulation phases are timed where they ran, possibly overlapping the previous frame
+	sample.phaseMs[static_cast<size_t>(BenchmarkPhase::Update)] += packet->updateMs;
+	sample.phaseMs[static_cast<size_t>(BenchmarkPhase::Culling)] += packet->cullingMs;
+
+	if (streamTarget) {
+		if (renderedFrames == config.benchmark.warmupFrames) {
+			uploadQueue.collect();
+			streamStartBytes = uploadQueue.getCompletedBytes();
+			streamStartTime = std::chrono::steady_clock::now();
+		}
+		if (uploadQueue.getPendingBytes() < STREAM_FRAMES_IN_FLIGHT * streamData.size()) {
+			uploadQueue.uploadBuffer(
+				streamData.data(),
+				streamData.size(),
+				streamTarget->getBuffer(),
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+		}
+		endPhase(BenchmarkPhase::Submit);
+	}
+
+	auto commandBuffer = lveRenderer.beginFrame();
+	// resources destroyed while a frame the GPU has now finished was being recorded
+	modelPool.collect(lveRenderer.getCompletedFrame());
+	texturePool.collect(lveRenderer.getCompletedFrame());
+	endPhase(BenchmarkPhase::PresentWait);
+    if (commandBuffer) {
 		int frameIndex = lveRenderer.getFrameIndex();
+		// FrameInfo takes a mutable camera, the packet's stays untouched
+		LveCamera camera = packet->camera;
 		FrameInfo frameInfo{
 			frameIndex,
-			frameTime,
+			packet->frameTime,
 			commandBuffer,
 			camera,
 			nullptr
 		};
+		const std::vector<DrawPacket>& draws = packet->draws;
 
 		// update
 		GlobalUbo ubo{};
 		ubo.projectionViewMatrix = camera.getProjection() * camera.getView();
 		uboBuffers[frameIndex]->writeToBuffer(&ubo);
 		uboBuffers[frameIndex]->flush();
+		VkBuffer meshletCommands = VK_NULL_HANDLE;
+		if (!packet->meshletCommands.empty()) {
+			LveBuffer& commands = *meshletCommandBuffers[frameIndex];
+			commands.writeToBuffer(
+				packet->meshletCommands.data(),
+				packet->meshletCommands.size() * sizeof(VkDrawIndexedIndirectCommand));
+			commands.flush();
+			meshletCommands = commands.getBuffer();
+		}
+		endPhase(BenchmarkPhase::Update);
 
 		// render
-		lveRenderer.beginSwapChainRenderPass(commandBuffer);
-		for (int i = 0 ; i < gameObjects.size() ; i ++)
-		{
-			auto& obj = gameObjects[i];
-			frameInfo.globalDescriptorSet = globalDescriptorSets[frameIndex][i];
-			// TODO reuse desctripor Writer
-			/*auto ImageInfo = obj.texture->descriptorInfo();
-			LveDescriptorWriter(*globalSetLayout, *globalPool)
-				.writeImage(1, &ImageInfo)
-				.overwrite(globalDescriptorSets[frameIndex]);*/
-			simpleRenderSystem.renderGameObjects(frameInfo, obj);
+		if (config.parallelRecording) {
+			// one secondary per chunk of draws plus a last one for the grid, every job records
+			// with the pools and command counters of the thread it runs on
+			lveRenderer.beginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			const size_t chunkCount = (draws.size() + RECORDING_CHUNK_SIZE - 1) / RECORDING_CHUNK_SIZE;
+			secondaryCommandBuffers.assign(chunkCount + 1, VK_NULL_HANDLE);
+			jobSystem.parallelFor(0, chunkCount + 1, 1, [&](size_t firstChunk, size_t lastChunk) {
+				for (size_t chunk = firstChunk; chunk < lastChunk; chunk++) {
+					VkCommandBuffer secondary = lveRenderer.beginSecondaryCommandBuffer(jobSystem.currentThreadIndex());
+					chunkCommandStats[chunk].reset();
+					LveCommandStatsBinding statsBinding{chunkCommandStats[chunk]};
+					LveFrameArenaBinding arenaBinding{*frameArenas[jobSystem.currentThreadIndex()]};
+					FrameInfo chunkInfo{frameIndex, packet->frameTime, secondary, camera, nullptr};
+					if (chunk == chunkCount) {
+						LveCommandStatsScope gridStats{chunkCommandStats[chunk], "GridRenderSystem"};
+						chunkInfo.globalDescriptorSet = gridDescriptorSets[frameIndex];
+						gridRenderSystem.renderGrid(chunkInfo, *gridObject.get(), modelPool.get(gridObject->model));
+					} else {
+						LVE_PROFILE_SCOPE("RecordDrawChunk");
+						LveCommandStatsScope simpleStats{chunkCommandStats[chunk], "SimpleRenderSystem"};
+						const size_t last = std::min(draws.size(), (chunk + 1) * RECORDING_CHUNK_SIZE);
+						for (size_t d = chunk * RECORDING_CHUNK_SIZE; d < last; d++) {
+							chunkInfo.globalDescriptorSet = globalDescriptorSets[frameIndex][draws[d].objectIndex];
+							simpleRenderSystem.renderDraw(chunkInfo, draws[d], meshletCommands);
+						}
+					}
+					lveRenderer.endSecondaryCommandBuffer(secondary);
+					secondaryCommandBuffers[chunk] = secondary;
+				}
+			});
+			lveRenderer.executeSecondaryCommandBuffers(commandBuffer, secondaryCommandBuffers);
+			for (size_t chunk = 0; chunk <= chunkCount; chunk++) {
+				commandStats.merge(chunkCommandStats[chunk]);
+			}
+		} else {
+			lveRenderer.beginSwapChainRenderPass(commandBuffer);
+			{
+				LVE_PROFILE_SCOPE("RecordDraws");
+				LveGpuZone simpleZone{gpuProfiler, commandBuffer, "SimpleRenderSystem"};
+				LveCommandStatsScope simpleStats{commandStats, "SimpleRenderSystem"};
+				for (const DrawPacket& draw : draws)
+				{
+					frameInfo.globalDescriptorSet = globalDescriptorSets[frameIndex][draw.objectIndex];
+					// TODO reuse desctripor Writer
+					/*auto ImageInfo = obj.texture->descriptorInfo();
+					LveDescriptorWriter(*globalSetLayout, *globalPool)
+						.writeImage(1, &ImageInfo)
+						.overwrite(globalDescriptorSets[frameIndex]);*/
+					simpleRenderSystem.renderDraw(frameInfo, draw, meshletCommands);
+				}
+			}
+			{
+				LveGpuZone gridZone{gpuProfiler, commandBuffer, "GridRenderSystem"};
+				LveCommandStatsScope gridStats{commandStats, "GridRenderSystem"};
+				// culling may have left no draws, the grid binds its own set either way
+				frameInfo.globalDescriptorSet = gridDescriptorSets[frameIndex];
+				gridRenderSystem.renderGrid(frameInfo, *gridObject.get(), modelPool.get(gridObject->model));
+			}
 		}
-		gridRenderSystem.renderGrid(frameInfo, *gridObject.get());
 		lveRenderer.endSwapChainRenderPass(commandBuffer);
+		if (config.headless && renderedFrames == config.captureFrame) {
+			lveRenderer.requestCapture(config.capturePath);
+		}
+		sample.drawCount = static_cast<uint32_t>(draws.size()) + 1;
+		sample.meshletTriangles = packet->meshletStats.triangles;
+		sample.culledTriangles = packet->meshletStats.culledTriangles;
+		endPhase(BenchmarkPhase::Recording);
+
 		lveRenderer.endFrame();
+		endPhase(BenchmarkPhase::Submit);
+
+		// waiting on an image still in use by an older frame happens inside submit
+		const double imageWaitMs = lveRenderer.getWaitStats().imageWaitMs;
+		sample.phaseMs[static_cast<size_t>(BenchmarkPhase::Submit)] -= imageWaitMs;
+		sample.phaseMs[static_cast<size_t>(BenchmarkPhase::PresentWait)] += imageWaitMs;
+
+		const auto frameEnd = std::chrono::steady_clock::now();
+		const float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(frameEnd - lastFrameEnd).count();
+		lastFrameEnd = frameEnd;
+		if (benchmarking && renderedFrames >= config.benchmark.warmupFrames) {
+			sample.frameMs = frameTime * 1000.0;
+			benchmarkRecorder.addSample(sample);
+			benchmarkRecorder.addCommandStats(commandStats);
+
+			// GPU times of an older frame, read back by beginFrame without waiting
+			if (gpuProfiler.getResolvedFrameCount() != gpuResolvedFrames) {
+				for (const auto& zone : gpuProfiler.getZoneResults()) {
+					benchmarkRecorder.addGpuZone(zone.name, zone.ms);
+				}
+				if (gpuProfiler.hasPipelineStatistics()) {
+					const auto& statistics = gpuProfiler.getPipelineStatistics();
+					benchmarkRecorder.addPipelineStatistics(
+						statistics.vertexInvocations, statistics.fragmentInvocations);
+				}
+			}
+		}
+		gpuResolvedFrames = gpuProfiler.getResolvedFrameCount();
+
+		// the first frame time includes setup, leave it out of the statistics
+		if (renderedFrames > 0) {
+			totalFrameTime += frameTime;
+			minFrameTime = std::min(minFrameTime, frameTime);
+			maxFrameTime = std::max(maxFrameTime, frameTime);
+			meshletTotals += packet->meshletStats;
+			for (size_t lod = 0; lod < lodDrawTotals.size(); lod++) {
+				lodDrawTotals[lod] += packet->lodDraws[lod];
+			}
+		}
+		renderedFrames++;
+
+		if (config.printWaitStats) {
+			const auto& waitStats = lveRenderer.getWaitStats();
+			waitTotals.frameWaitMs += waitStats.frameWaitMs;
+			waitTotals.acquireWaitMs += waitStats.acquireWaitMs;
+			waitTotals.imageWaitMs += waitStats.imageWaitMs;
+			waitFrames++;
+			waitReportTime += frameTime;
+			if (waitReportTime >= 1.f) {
+				std::cout << "frames: " << waitFrames
+					<< " | avg wait (ms) frame: " << waitTotals.frameWaitMs / waitFrames
+					<< " acquire: " << waitTotals.acquireWaitMs / waitFrames
+					<< " image: " << waitTotals.imageWaitMs / waitFrames << std::endl;
+				waitTotals = {};
+				waitFrames = 0;
+				waitReportTime = 0.f;
+			}
+		}
     }
   }
 
+  const uint64_t loopAllocationCount = LveAllocationCounter::getCount();
   vkDeviceWaitIdle(lveDevice.device());
+  LVE_PROFILE_WRITE_TRACE(config.tracePath);
+
+  if (benchmarking) {
+	  if (streamTarget) {
+		  uploadQueue.collect();
+		  benchmarkRecorder.setStreamingResult(
+			  uploadQueue.getCompletedBytes() - streamStartBytes,
+			  std::chrono::duration<double>(std::chrono::steady_clock::now() - streamStartTime).count(),
+			  uploadQueue.isDedicated());
+	  }
+	  benchmarkRecorder.writeReport(
+		  LveSwapChain::presentModeName(lveRenderer.getPresentMode()),
+		  lveRenderer.getFramesInFlight(),
+		  scene.getEntityCount(),
+		  config.parallelRecording ? jobSystem.getThreadCount() : 1,
+		  config.pipelinedRendering);
+	  benchmarkFrameMs = benchmarkRecorder.averageFrameMs();
+  }
+
+  if (!benchmarking && frameLimit > 0 && renderedFrames > 1) {
+	  const float avgFrameTime = totalFrameTime / (renderedFrames - 1);
+	  std::cout << "rendered " << renderedFrames << " frames"
+		  << " | frame time (ms) avg: " << avgFrameTime * 1000.f
+		  << " min: " << minFrameTime * 1000.f
+		  << " max: " << maxFrameTime * 1000.f
+		  << " | fps: " << 1.f / avgFrameTime << std::endl;
+	  std::cout << "draws per frame by level of detail:";
+	  for (size_t lod = 0; lod < lodDrawTotals.size(); lod++) {
+		  std::cout << " " << lod << ": " << lodDrawTotals[lod] / (renderedFrames - 1);
+	  }
+	  std::cout << std::endl;
+	  if (meshletTotals.triangles > 0) {
+		  const uint64_t frames = renderedFrames - 1;
+		  std::cout << "cluster culling per frame | meshlets culled: "
+			  << meshletTotals.culledMeshlets / frames << " of " << meshletTotals.meshlets / frames
+			  << " | triangles culled: " << meshletTotals.culledTriangles / frames << " of "
+			  << meshletTotals.triangles / frames << " ("
+			  << 100.0 * meshletTotals.culledTriangles / meshletTotals.triangles << "%)" << std::endl;
+	  }
+  }
+
+  // a steady frame loop reuses everything it needs, any allocation in it is a regression
+  if (LveAllocationCounter::enabled && frameLimit > 0 && renderedFrames > allocationStartFrame) {
+	  const uint64_t loopAllocations = loopAllocationCount - warmAllocationCount;
+	  std::cout << "heap allocations in the " << renderedFrames - allocationStartFrame
+		  << " frames from frame " << allocationStartFrame << " on: " << loopAllocations << std::endl;
+	  if (loopAllocations > 0) {
+		  throw std::runtime_error(
+			  "the frame loop made " + std::to_string(loopAllocations) +
+			  " heap allocations after warming up, it has to make none!");
+	  }
+  }
 }
 
 void FirstApp::loadGameObjects() {
+	LVE_PROFILE_FUNCTION();
 	std::string currentPath = std::filesystem::current_path().string();
-	std::vector<std::shared_ptr<LveModel>> lveModels;
-	LveModel::createModelFromFile(lveModels, lveDevice, currentPath + "/ToyProject3D/Resources/Models/bb8.obj");
-	std::shared_ptr<LveTexture> lveHeadDiffuseTexture = LveTexture::createTextureFromFile(lveDevice, currentPath + "/ToyProject3D/Resources/Textures/HEAD diff MAP.jpg");
-	std::shared_ptr<LveTexture> lveBodyDiffuseTexture = LveTexture::createTextureFromFile(lveDevice, currentPath + "/ToyProject3D/Resources/Textures/Body diff MAP.jpg");
-	defaultTexture = LveTexture::createTextureFromFile(lveDevice, currentPath + "/ToyProject3D/Resources/Textures/checker.jpg");
-
-
-	auto objHeadPart = LveGameObject::createGameObject();
-	objHeadPart.model = lveModels[0];
-	objHeadPart.texture = lveHeadDiffuseTexture;
-	objHeadPart.transform.translation = { .0f, .0f, .0f };
-	objHeadPart.transform.rotation = { 0.f, glm::radians(90.f), glm::radians(180.f) };
-	objHeadPart.transform.scale = glm::vec3(.1f);
-	gameObjects.push_back(std::move(objHeadPart));
-
-	auto objBodyPart = LveGameObject::createGameObject();
-	objBodyPart.model = lveModels[1];
-	objBodyPart.texture = lveBodyDiffuseTexture;
-	objBodyPart.transform.translation = { .0f, .0f, .0f };
-	objBodyPart.transform.rotation = { 0.f, glm::radians(90.f), glm::radians(180.f) };
-	objBodyPart.transform.scale = glm::vec3(.1f);
-	gameObjects.push_back(std::move(objBodyPart));
+
+	// parse and decode on the job system, device uploads stay on this thread
+	const bool loadVase = config.benchmark.sceneCopies > 0;
+	const std::array<std::string, 3> texturePaths{
+		currentPath + "/ToyProject3D/Resources/Textures/HEAD diff MAP.jpg",
+		currentPath + "/ToyProject3D/Resources/Textures/Body diff MAP.jpg",
+		currentPath + "/ToyProject3D/Resources/Textures/checker.jpg"};
+	std::array<LveTexture::ImageData, 3> images;
+	LveModel::Builder bb8Builder{};
+	LveModel::Builder vaseBuilder{};
+	// texture of every bb8 part, indices into images
+	std::vector<uint32_t> bb8Materials{0, 1};
+	size_t bb8SourceParts = 0;
+	{
+		LVE_PROFILE_SCOPE("DecodeAssets");
+		auto* loading = jobSystem.createJob([] {});
+		// triangle BVHs for picking and levels of detail are cached next to each model
+		jobSystem.run(jobSystem.createJob([&] {
+			const std::string path = currentPath + "/ToyProject3D/Resources/Models/bb8.obj";
+			bb8Builder.loadModel(path);
+			bb8SourceParts = bb8Builder.parts.size();
+			if (config.staticBatching) {
+				bb8Materials = bb8Builder.batchParts(bb8Materials);
+			}
+			bb8Builder.buildMeshlets();
+			bb8Builder.loadTriangleBvhs(path + ".bvh", jobSystem);
+			bb8Builder.loadLods(path + ".lod", jobSystem);
+		}, loading));
+		if (loadVase) {
+			jobSystem.run(jobSystem.createJob([&] {
+				const std::string path = currentPath + "/ToyProject3D/Resources/Models/smooth_vase.obj";
+				vaseBuilder.loadModel(path);
+				vaseBuilder.buildMeshlets();
+				vaseBuilder.loadTriangleBvhs(path + ".bvh", jobSystem);
+				vaseBuilder.loadLods(path + ".lod", jobSystem);
+			}, loading));
+		}
+		for (size_t i = 0; i < texturePaths.size(); i++) {
+			jobSystem.run(jobSystem.createJob([&, i] {
+				images[i] = LveTexture::decodeFile(texturePaths[i]);
+			}, loading));
+		}
+		jobSystem.run(loading);
+		jobSystem.wait(loading);
+	}
+
+	if (config.staticBatching) {
+		// one draw per part, parts with different textures still need their own
+		std::cout << "static batching: bb8 draws " << bb8SourceParts << " before, "
+			<< bb8Builder.parts.size() << " after" << std::endl;
+	}
+
+	std::vector<LveModelHandle> lveModels;
+	LveModel::createModelFromBuilder(lveModels, modelPool, lveDevice, bb8Builder);
+	const std::array<LveTextureHandle, 2> bb8Textures{
+		texturePool.create(lveDevice, images[0]),
+		texturePool.create(lveDevice, images[1])};
+	defaultTexture = texturePool.create(lveDevice, images[2]);
+
+
+	// the parts share one transform through their group, copies move both by moving the group
+	TransformComponent bb8Transform{};
+	bb8Transform.translation = { .0f, .0f, .0f };
+	bb8Transform.rotation = { 0.f, glm::radians(90.f), glm::radians(180.f) };
+	bb8Transform.scale = glm::vec3(.1f);
+	const LveEntity bb8 = createSceneGroup(bb8Transform);
+	std::vector<LveEntity> bb8Parts;
+	for (size_t i = 0; i < lveModels.size(); i++) {
+		bb8Parts.push_back(createSceneObject(lveModels[i], bb8Textures[bb8Materials[i]], {}, bb8));
+	}
+
+	if (loadVase) {
+		std::vector<LveModelHandle> vaseModels;
+		LveModel::createModelFromBuilder(vaseModels, modelPool, lveDevice, vaseBuilder);
+		makeBenchmarkObjects(bb8, bb8Parts, vaseModels);
+	}
+}
+
+LveEntity FirstApp::createSceneObject(
+	LveModelHandle model,
+	LveTextureHandle texture,
+	const TransformComponent& transform,
+	LveEntity parent)
+{
+	const LveEntity entity = createSceneGroup(transform, parent);
+	scene.add<WorldTransformComponent>(entity);
+	scene.add<BoundsComponent>(entity, {modelPool.get(model).getBoundingBox()});
+	scene.add<ModelComponent>(entity, {model});
+	scene.add<TextureComponent>(entity, {texture});
+	return entity;
+}
+
+LveEntity FirstApp::createSceneGroup(const TransformComponent& transform, LveEntity parent)
+{
+	const LveEntity entity = scene.create();
+	scene.add<TransformComponent>(entity, transform);
+	sceneGraph.insert(entity, parent);
+	return entity;
+}
+
+void FirstApp::makeBenchmarkObjects(
+	LveEntity bb8,
+	const std::vector<LveEntity>& bb8Parts,
+	const std::vector<LveModelHandle>& vaseModels)
+{
+	// synthetic load: alternating bb8 and vase copies on a square grid around the original
+	const int copies = config.benchmark.sceneCopies;
+	const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(copies + 1))));
+	const float spacing = 25.f;
+	for (int i = 1; i <= copies; i++) {
+		const glm::vec3 offset{
+			(i % columns - columns / 2) * spacing,
+			0.f,
+			(i / columns - columns / 2) * spacing};
+
+		if (i % 2 == 0) {
+			TransformComponent vaseTransform{};
+			vaseTransform.translation = offset;
+			vaseTransform.scale = glm::vec3(20.f);
+			createSceneObject(vaseModels[0], defaultTexture, vaseTransform);
+			continue;
+		}
+		TransformComponent copyTransform = scene.get<TransformComponent>(bb8);
+		copyTransform.translation += offset;
+		const LveEntity copy = createSceneGroup(copyTransform);
+		for (LveEntity part : bb8Parts) {
+			createSceneObject(
+				scene.get<ModelComponent>(part).model,
+				scene.get<TextureComponent>(part).texture,
+				scene.get<TransformComponent>(part),
+				copy);
+		}
+	}
+}
+
+void FirstApp::updateTransforms()
+{
+	LVE_PROFILE_FUNCTION();
+	// only subtrees below a patched TransformComponent are recomputed
+	sceneGraph.update(scene, jobSystem);
+}
+
+void FirstApp::updateBounds()
+{
+	LVE_PROFILE_FUNCTION();
+	// world bounds of every object whose world transform changed, refitted into the BVH
+	LveComponentPool<WorldTransformComponent>& worlds = scene.pool<WorldTransformComponent>();
+	LveComponentPool<BoundsComponent>& bounds = scene.pool<BoundsComponent>();
+	const std::vector<LveEntity>& entities = worlds.entities();
+	size_t created = 0;
+	for (size_t position = 0; position < worlds.size(); position++) {
+		if (!worlds.isChanged(position)) {
+			continue;
+		}
+		worlds.clearChanged(position);
+		const uint32_t boundsPosition = bounds.find(entities[position].index, position);
+		if (boundsPosition == LveComponentPool<BoundsComponent>::ABSENT) {
+			continue;
+		}
+
+		BoundsComponent& object = bounds.at(boundsPosition);
+		const LveAabb worldBounds = object.local.transformed(worlds.at(position).modelMatrix);
+		if (object.proxy == LveBvh::NULL_NODE) {
+			object.proxy = sceneBvh.createProxy(worldBounds, entities[position].index);
+			created++;
+		} else {
+			sceneBvh.moveProxy(object.proxy, worldBounds);
+		}
+	}
+	// inserting one by one suits a few new objects, after loading a scene a SAH build is better
+	if (created > sceneBvh.size() / 2) {
+		sceneBvh.rebuild();
+	}
+}
+
+FrameInput FirstApp::sampleInput()
+{
+	FrameInput input{};
+	input.aspectRatio = lveRenderer.getAspectRatio();
+	input.viewportHeight = static_cast<float>(lveRenderer.getExtent().height);
+	if (!lveWindow.isHeadless()) {
+		input.controls = cameraController.sampleInput(lveWindow.getGLFWwindow());
+	}
+	return input;
+}
+
+void FirstApp::simulateFrame(const FrameInput& input, FramePacket& packet)
+{
+	LVE_PROFILE_FUNCTION();
+	const auto updateStart = std::chrono::steady_clock::now();
+	float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(updateStart - lastSimulationTime).count();
+	lastSimulationTime = updateStart;
+
+	if (config.benchmark.enabled) {
+		LVE_PROFILE_SCOPE("CameraPath");
+		frameTime = config.benchmark.fixedDt;
+		simulationTime += frameTime;
+		cameraPath.apply(simulationTime, viewerObject);
+	} else if (!lveWindow.isHeadless()) {
+		cameraController.applyInput(input.controls, frameTime, viewerObject);
+	}
+	packet.camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+	packet.camera.setPerspectiveProjection(glm::radians(50.f), input.aspectRatio, 0.1f, 3000.f);
+	updateTransforms();
+	updateBounds();
+	glm::vec2 cursor{};
+	if (!config.benchmark.enabled && !lveWindow.isHeadless() && cameraController.takePick(input.controls, cursor)) {
+		pickObject(packet.camera, cursor);
+	}
+	const auto cullingStart = std::chrono::steady_clock::now();
+
+	// culling: the objects whose world bounds touch the view frustum become draws
+	{
+		LVE_PROFILE_SCOPE("Culling");
+		packet.draws.clear();
+		const LveFrustum frustum = LveFrustum::fromViewProjection(packet.camera.getProjection() * packet.camera.getView());
+		LveComponentPool<WorldTransformComponent>& worlds = scene.pool<WorldTransformComponent>();
+		LveComponentPool<ModelComponent>& models = scene.pool<ModelComponent>();
+		const glm::vec3 cameraPosition = viewerObject.transform.translation;
+		const float pixelsPerUnit = 0.5f * input.viewportHeight * packet.camera.getProjection()[1][1];
+		sceneBvh.queryFrustum(frustum, [&](uint32_t entityIndex) {
+			const WorldTransformComponent& world = worlds.get(entityIndex);
+			LveModel& model = modelPool.get(models.get(entityIndex).model);
+			const uint32_t lod = selectLod(model, world.modelMatrix, cameraPosition, pixelsPerUnit);
+			packet.draws.push_back({world.modelMatrix, world.normalMatrix, &model, entityIndex, lod});
+		});
+		packet.meshletCommands.clear();
+		packet.meshletStats = {};
+		if (config.clusterCulling) {
+			cullMeshlets(frustum, packet);
+		}
+		packet.lodDraws = {};
+		for (const DrawPacket& draw : packet.draws) {
+			packet.lodDraws[draw.lod]++;
+		}
+	}
+
+	packet.frameNumber = ++simulationFrame;
+	packet.frameTime = frameTime;
+	packet.updateMs = std::chrono::duration<double, std::milli>(cullingStart - updateStart).count();
+	packet.cullingMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullingStart).count();
+}
+
+void FirstApp::cullMeshlets(const LveFrustum& frustum, FramePacket& packet)
+{
+	LVE_PROFILE_FUNCTION();
+	// every draw gets room for a command per meshlet, merged runs of visible ones take less;
+	// meshlets cover the full mesh, simpler levels of detail are drawn whole
+	std::vector<DrawPacket>& draws = packet.draws;
+	uint32_t commandCount = 0;
+	for (DrawPacket& draw : draws) {
+		const LveMeshlets* meshlets = draw.lod == 0 ? draw.model->getMeshlets() : nullptr;
+		draw.firstCommand = commandCount;
+		draw.commandCount = 0;
+		commandCount += meshlets ? meshlets->getMeshletCount() : 0;
+	}
+	packet.meshletCommands.resize(commandCount);
+
+	std::fill(meshletCullStats.begin(), meshletCullStats.end(), LveMeshlets::CullStats{});
+	const glm::vec3 cameraPosition = viewerObject.transform.translation;
+	jobSystem.parallelFor(0, draws.size(), 16, [&](size_t first, size_t last) {
+		LveMeshlets::CullStats& stats = meshletCullStats[jobSystem.currentThreadIndex()];
+		for (size_t d = first; d < last; d++) {
+			DrawPacket& draw = draws[d];
+			const LveMeshlets* meshlets = draw.model->getMeshlets();
+			if (draw.lod == 0 && meshlets) {
+				draw.commandCount = meshlets->cull(
+					frustum,
+					draw.modelMatrix,
+					cameraPosition,
+					&packet.meshletCommands[draw.firstCommand],
+					stats);
+			}
+		}
+	});
+	for (const LveMeshlets::CullStats& stats : meshletCullStats) {
+		packet.meshletStats += stats;
+	}
+
+	// no commands left means every meshlet was culled
+	draws.erase(
+		std::remove_if(draws.begin(), draws.end(), [](const DrawPacket& draw) {
+			return draw.lod == 0 && draw.commandCount == 0 && draw.model->getMeshlets();
+		}),
+		draws.end());
+}
+
+uint32_t FirstApp::selectLod(
+	const LveModel& model,
+	const glm::mat4& modelMatrix,
+	const glm::vec3& cameraPosition,
+	float pixelsPerUnit) const
+{
+	const LveMeshLods* lods = model.getLods();
+	if (!lods || config.lodPixelError <= 0.f) {
+		return 0;
+	}
+	// errors are in object space, the largest scale of the model matrix bounds them in world space
+	const float scale = std::max({
+		glm::length(glm::vec3{modelMatrix[0]}),
+		glm::length(glm::vec3{modelMatrix[1]}),
+		glm::length(glm::vec3{modelMatrix[2]})});
+	const LveAabb& bounds = model.getBoundingBox();
+	const glm::vec3 center{modelMatrix * glm::vec4{0.5f * (bounds.min + bounds.max), 1.f}};
+	const float radius = scale * 0.5f * glm::length(bounds.max - bounds.min);
+	// the closest the model's surface can get to the camera, at least the near plane
+	const float distance = std::max(glm::length(center - cameraPosition) - radius, 0.1f);
+	return lods->selectLod(scale * pixelsPerUnit / distance, config.lodPixelError);
+}
+
+void FirstApp::pickObject(const LveCamera& camera, const glm::vec2& cursor)
+{
+	LVE_PROFILE_FUNCTION();
+	// the cursor's points on the near and far plane, the ray runs between them
+	const glm::mat4 inverseViewProjection = glm::inverse(camera.getProjection() * camera.getView());
+	const glm::vec4 nearPoint = inverseViewProjection * glm::vec4{cursor, 0.f, 1.f};
+	const glm::vec4 farPoint = inverseViewProjection * glm::vec4{cursor, 1.f, 1.f};
+	const glm::vec3 origin = glm::vec3{nearPoint} / nearPoint.w;
+	const glm::vec3 direction = glm::vec3{farPoint} / farPoint.w - origin;
+
+	// t is along the whole near to far segment, in model space as well since the model matrix is
+	// affine, so hits of different objects compare directly
+	LveComponentPool<WorldTransformComponent>& worlds = scene.pool<WorldTransformComponent>();
+	LveComponentPool<ModelComponent>& models = scene.pool<ModelComponent>();
+	float closest = 1.f;
+	uint32_t picked = LveEntity::INVALID_INDEX;
+	LveTriangleBvh::Hit pickedHit{};
+	sceneBvh.queryRay(origin, direction, closest, [&](uint32_t entityIndex, float) {
+		const LveTriangleBvh* triangleBvh = modelPool.get(models.get(entityIndex).model).getTriangleBvh();
+		if (!triangleBvh) {
+			return closest;
+		}
+		const glm::mat4 toModel = glm::inverse(worlds.get(entityIndex).modelMatrix);
+		const glm::vec3 modelOrigin{toModel * glm::vec4{origin, 1.f}};
+		const glm::vec3 modelDirection{toModel * glm::vec4{direction, 0.f}};
+		LveTriangleBvh::Hit hit{};
+		if (triangleBvh->intersect(modelOrigin, modelDirection, closest, hit)) {
+			closest = hit.t;
+			picked = entityIndex;
+			pickedHit = hit;
+		}
+		return closest;
+	});
+
+	if (picked == LveEntity::INVALID_INDEX) {
+		std::cout << "picked nothing" << std::endl;
+		return;
+	}
+	const glm::vec3 point = origin + pickedHit.t * direction;
+	std::cout << "picked entity " << picked << ", triangle " << pickedHit.triangle << " at ("
+		<< point.x << ", " << point.y << ", " << point.z << ")" << std::endl;
 }
 
 void FirstApp::makeGridObject()
@@ -283,10 +1039,8 @@ void FirstApp::makeGridObject()
 	}*/
 	grid.vertices.emplace_back(vertex);
 	
-	std::shared_ptr<LveModel> gridModel = std::make_unique<LveModel>(lveDevice, grid);
-
 	auto gridObj = LveGameObject::createGameObject();
-	gridObj.model = gridModel;
+	gridObj.model = modelPool.create(lveDevice, grid);
 	gridObj.texture = defaultTexture;
 	gridObj.transform.translation = { .0f, .0f, .0f };
 	gridObj.transform.rotation = { 0.f, 0.f, 0.f };
@@ -1,42 +1,142 @@
 #pragma once
 
+#include "benchmark.hpp"
+#include "keyboard_movement_controller.hpp"
+#include "GraphicsCore/VulkanRHI/lve_bvh.hpp"
+#include "GraphicsCore/VulkanRHI/lve_components.hpp"
 #include "GraphicsCore/VulkanRHI/lve_device.hpp"
+#include "GraphicsCore/VulkanRHI/lve_entity_registry.hpp"
+#include "GraphicsCore/VulkanRHI/lve_frame_arena.hpp"
+#include "GraphicsCore/VulkanRHI/lve_frame_packet.hpp"
 #include "GraphicsCore/VulkanRHI/lve_game_object.hpp"
+#include "GraphicsCore/VulkanRHI/lve_job_system.hpp"
 #include "GraphicsCore/VulkanRHI/lve_renderer.hpp"
+#include "GraphicsCore/VulkanRHI/lve_resource_pool.hpp"
+#include "GraphicsCore/VulkanRHI/lve_scene_graph.hpp"
 #include "GraphicsCore/VulkanRHI/lve_window.hpp"
 #include "GraphicsCore/VulkanRHI/lve_descriptors.hpp"
 
 // std
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace lve {
+
+// window state sampled where GLFW events are polled, read by the simulation
+struct FrameInput {
+  KeyboardMovementController::InputState controls{};
+  float aspectRatio = 1.f;
+  float viewportHeight = 1.f;  // pixels
+};
+
+struct FirstAppConfigInfo {
+  SwapChainConfigInfo swapChain{};
+  bool printWaitStats = false;
+
+  // headless renders offscreen without a window, e.g. on CI hosts with lavapipe or SwiftShader
+  bool headless = false;
+  int frameCount = 0;     // frames to render before run() returns, 0 runs until the window closes
+  int captureFrame = -1;  // headless only, frame to save to capturePath, -1 disables capture
+  std::string capturePath = "capture.png";
+
+  // Chrome trace written at the end of run(), only in builds with LVE_ENABLE_PROFILER
+  std::string tracePath = "trace.json";
+
+  // job system workers besides the main thread, -1 uses one per remaining hardware thread
+  int workerThreads = -1;
+  // records the scene into secondary command buffers on the job system threads
+  bool parallelRecording = false;
+  // simulates on its own thread, one frame ahead of the render loop, see FramePacket
+  bool pipelinedRendering = false;
+  // culls the meshlets of every visible model and draws the rest through indirect commands
+  bool clusterCulling = false;
+  // screen space error in pixels a level of detail may have to be drawn, 0 always draws models in
+  // full
+  float lodPixelError = 1.f;
+  // merges the parts of a model that share a texture into one part, see Builder::batchParts
+  bool staticBatching = false;
+
+  // replaces keyboard input with a camera path and writes a frame-time report, see benchmark.hpp
+  BenchmarkConfigInfo benchmark{};
+};
+
 class FirstApp {
  public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
 
-  FirstApp();
+  FirstApp(const FirstAppConfigInfo &configInfo = {});
   ~FirstApp();
 
   FirstApp(const FirstApp &) = delete;
   FirstApp &operator=(const FirstApp &) = delete;
 
   void run();
+  // average measured frame time of the last benchmark run, 0 if none was recorded
+  double getBenchmarkFrameMs() const { return benchmarkFrameMs; }
 
  private:
   void loadGameObjects();
   void makeGridObject();
+  void makeBenchmarkObjects(
+      LveEntity bb8,
+      const std::vector<LveEntity> &bb8Parts,
+      const std::vector<LveModelHandle> &vaseModels);
+  LveEntity createSceneObject(
+      LveModelHandle model,
+      LveTextureHandle texture,
+      const TransformComponent &transform,
+      LveEntity parent = {});
+  // node without a model that moves its children, transform is relative to parent
+  LveEntity createSceneGroup(const TransformComponent &transform, LveEntity parent = {});
+  void updateTransforms();
+  void updateBounds();
+  // casts a ray through cursor, in normalized device coordinates, and reports the hit object
+  void pickObject(const LveCamera &camera, const glm::vec2 &cursor);
+  FrameInput sampleInput();
+  void simulateFrame(const FrameInput &input, FramePacket &packet);
+  // replaces the packet's draws of models with meshlets by indirect draws of the visible ones
+  void cullMeshlets(const LveFrustum &frustum, FramePacket &packet);
+  // coarsest level of detail of model whose error stays below config.lodPixelError, pixelsPerUnit
+  // being the pixels a world space unit covers at distance 1
+  uint32_t selectLod(
+      const LveModel &model,
+      const glm::mat4 &modelMatrix,
+      const glm::vec3 &cameraPosition,
+      float pixelsPerUnit) const;
 
-  LveWindow lveWindow{WIDTH, HEIGHT, "Vulkan Tutorial"};
+  FirstAppConfigInfo config;
+  // the simulation thread attaches to the job system when pipelined
+  LveJobSystem jobSystem{config.workerThreads, config.pipelinedRendering ? 1 : 0};
+  LveWindow lveWindow{WIDTH, HEIGHT, "Vulkan Tutorial", config.headless};
   LveDevice lveDevice {lveWindow};
-  LveRenderer lveRenderer {lveWindow, lveDevice};
+  LveRenderer lveRenderer {lveWindow, lveDevice, config.swapChain, jobSystem.getThreadCount()};
+  // per job system thread, for temporaries that last at most a frame, see LveFrameArena
+  std::vector<std::unique_ptr<LveFrameArena>> frameArenas;
 
-  std::shared_ptr<LveTexture> defaultTexture;
+  // everything the scene draws, referenced by handle and released before the device
+  LveResourcePool<LveModel> modelPool{lveDevice.deletionQueue()};
+  LveResourcePool<LveTexture> texturePool{lveDevice.deletionQueue()};
+  LveTextureHandle defaultTexture{};
 
   // note: order of declarations matters
   std::unique_ptr<LveDescriptorPool> globalPool{};
-  std::vector<LveGameObject> gameObjects;
+  LveEntityRegistry scene;
+  LveSceneGraph sceneGraph;
   std::unique_ptr<LveGameObject> gridObject{};
+
+  // simulation state, only touched by the thread running simulateFrame
+  LveBvh sceneBvh;  // world bounds of the scene objects, entity indices as user data
+  LveGameObject viewerObject = LveGameObject::createGameObject();
+  KeyboardMovementController cameraController{};
+  CameraPath cameraPath{};
+  std::vector<LveMeshlets::CullStats> meshletCullStats;  // per job system thread
+  float simulationTime = 0.f;
+  uint64_t simulationFrame = 0;
+  std::chrono::steady_clock::time_point lastSimulationTime{};
+
+  double benchmarkFrameMs = 0.0;
 };
 }  // namespace lve
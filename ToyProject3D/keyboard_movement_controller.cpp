@@ -5,29 +5,56 @@
 
 namespace lve {
 
-void KeyboardMovementController::moveInPlaneXZ(
-    GLFWwindow* window, float dt, LveGameObject& gameObject) {
+KeyboardMovementController::InputState KeyboardMovementController::sampleInput(
+    GLFWwindow* window) const {
+  InputState input{};
+  input.lookActive = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+  input.selectActive = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+  glfwGetCursorPos(window, &input.cursorX, &input.cursorY);
+  glfwGetWindowSize(window, &input.windowWidth, &input.windowHeight);
+  input.moveLeft = glfwGetKey(window, keys.moveLeft) == GLFW_PRESS;
+  input.moveRight = glfwGetKey(window, keys.moveRight) == GLFW_PRESS;
+  input.moveForward = glfwGetKey(window, keys.moveForward) == GLFW_PRESS;
+  input.moveBackward = glfwGetKey(window, keys.moveBackward) == GLFW_PRESS;
+  input.moveUp = glfwGetKey(window, keys.moveUp) == GLFW_PRESS;
+  input.moveDown = glfwGetKey(window, keys.moveDown) == GLFW_PRESS;
+  return input;
+}
+
+bool KeyboardMovementController::takePick(const InputState& input, glm::vec2& cursorNdc) {
+  const bool pressed = input.selectActive && !bSelectState;
+  bSelectState = input.selectActive;
+  if (!pressed || input.windowWidth <= 0 || input.windowHeight <= 0) {
+    return false;
+  }
+  // window coordinates run down from the top left corner like Vulkan's device coordinates
+  cursorNdc = {
+      2.f * static_cast<float>(input.cursorX / input.windowWidth) - 1.f,
+      2.f * static_cast<float>(input.cursorY / input.windowHeight) - 1.f};
+  return true;
+}
+
+void KeyboardMovementController::applyInput(
+    const InputState& input, float dt, LveGameObject& gameObject) {
   glm::vec3 rotate{0};
   
-  if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
+  if (input.lookActive)
   {
       if (bClickState == false)
       {
           bClickState = true;
-          glfwGetCursorPos(window, &xPosOld, &yPosOld);
+          xPosOld = input.cursorX;
+          yPosOld = input.cursorY;
       }
       else
       {
-          double xPos = .0f;
-          double yPos = .0f;
-          glfwGetCursorPos(window, &xPos, &yPos);
-          rotate.x = -(yPos - yPosOld);
-          rotate.y = xPos - xPosOld;
-          xPosOld = xPos;
-          yPosOld = yPos;
+          rotate.x = -(input.cursorY - yPosOld);
+          rotate.y = input.cursorX - xPosOld;
+          xPosOld = input.cursorX;
+          yPosOld = input.cursorY;
       }
   }
-  if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE)
+  else
   {
       bClickState = false;
       xPosOld = 0.f;
@@ -48,12 +75,12 @@ void KeyboardMovementController::moveInPlaneXZ(
   const glm::vec3 upDir{0.f, -1.f, 0.f};
 
   glm::vec3 moveDir{0.f};
-  if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) moveDir += forwardDir;
-  if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= forwardDir;
-  if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) moveDir += rightDir;
-  if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) moveDir -= rightDir;
-  if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) moveDir += upDir;
-  if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
+  if (input.moveForward) moveDir += forwardDir;
+  if (input.moveBackward) moveDir -= forwardDir;
+  if (input.moveRight) moveDir += rightDir;
+  if (input.moveLeft) moveDir -= rightDir;
+  if (input.moveUp) moveDir += upDir;
+  if (input.moveDown) moveDir -= upDir;
 
   if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
     gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
@@ -19,12 +19,37 @@ class KeyboardMovementController {
     int lookDown = GLFW_KEY_DOWN;
   };
 
-  void moveInPlaneXZ(GLFWwindow* window, float dt, LveGameObject& gameObject);
+  // device state for one frame, sampled on the thread that polls GLFW events
+  struct InputState {
+    bool lookActive = false;  // right mouse button held
+    bool selectActive = false;  // left mouse button held
+    double cursorX = 0.0;
+    double cursorY = 0.0;
+    int windowWidth = 0;
+    int windowHeight = 0;
+    bool moveLeft = false;
+    bool moveRight = false;
+    bool moveForward = false;
+    bool moveBackward = false;
+    bool moveUp = false;
+    bool moveDown = false;
+  };
+
+  InputState sampleInput(GLFWwindow* window) const;
+  // may run on another thread than sampleInput, e.g. the simulation thread
+  void applyInput(const InputState& input, float dt, LveGameObject& gameObject);
+  void moveInPlaneXZ(GLFWwindow* window, float dt, LveGameObject& gameObject) {
+    applyInput(sampleInput(window), dt, gameObject);
+  }
+  // true once per press of the left mouse button, with the cursor in normalized device
+  // coordinates for picking; a press shorter than a simulated frame can go unnoticed
+  bool takePick(const InputState& input, glm::vec2& cursorNdc);
 
   KeyMappings keys{};
   double xPosOld = 0;
   double yPosOld = 0;
   bool bClickState = false;
+  bool bSelectState = false;
   float moveSpeed{50.f};
   float lookSpeed{5.f};
 };
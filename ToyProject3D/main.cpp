@@ -1,15 +1,225 @@
-
 #include "first_app.hpp"
+#include "GraphicsCore/VulkanRHI/lve_profiler.hpp"
 
 // std
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+// the profiler's options only exist in builds that compile it in
+#ifdef LVE_ENABLE_PROFILER
+constexpr const char *PROFILER_USAGE = "[--trace=file.json] [--profiler-overhead] ";
+#else
+constexpr const char *PROFILER_USAGE = "";
+#endif
+
+lve::PresentModePolicy parsePresentModePolicy(const std::string &name) {
+  if (name == "low-latency") return lve::PresentModePolicy::LowLatency;
+  if (name == "throughput") return lve::PresentModePolicy::Throughput;
+  if (name == "vsync") return lve::PresentModePolicy::VSync;
+  if (name == "immediate") return lve::PresentModePolicy::Immediate;
+  throw std::invalid_argument("unknown present mode: " + name);
+}
+
+lve::FirstAppConfigInfo parseArguments(int argc, char **argv) {
+  lve::FirstAppConfigInfo config{};
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const auto separator = arg.find('=');
+    const std::string key = arg.substr(0, separator);
+    const std::string value = separator == std::string::npos ? "" : arg.substr(separator + 1);
+
+    if (key == "--frames-in-flight") {
+      config.swapChain.framesInFlight = std::stoi(value);
+    } else if (key == "--present-mode") {
+      config.swapChain.presentModePolicy = parsePresentModePolicy(value);
+    } else if (key == "--print-wait-stats") {
+      config.printWaitStats = true;
+    } else if (key == "--headless") {
+      config.headless = true;
+    } else if (key == "--frames") {
+      config.frameCount = std::stoi(value);
+    } else if (key == "--capture-frame") {
+      config.captureFrame = std::stoi(value);
+    } else if (key == "--capture-path") {
+      config.capturePath = value;
+    } else if (key == "--workers") {
+      config.workerThreads = std::stoi(value);
+    } else if (key == "--parallel-recording") {
+      config.parallelRecording = true;
+    } else if (key == "--pipelined") {
+      config.pipelinedRendering = true;
+    } else if (key == "--cluster-culling") {
+      config.clusterCulling = true;
+    } else if (key == "--lod-error") {
+      config.lodPixelError = std::stof(value);
+    } else if (key == "--static-batching") {
+      config.staticBatching = true;
+    } else if (key == "--trace" || key == "--profiler-overhead") {
+#ifdef LVE_ENABLE_PROFILER
+      if (key == "--profiler-overhead") {
+        throw std::invalid_argument("--profiler-overhead takes no other arguments");
+      }
+      config.tracePath = value;
+#else
+      throw std::invalid_argument(key + " needs a build with LVE_ENABLE_PROFILER defined");
+#endif
+    } else if (key == "--benchmark") {
+      config.benchmark.enabled = true;
+    } else if (key == "--camera-path") {
+      config.benchmark.cameraPathFile = value;
+    } else if (key == "--benchmark-frames") {
+      config.benchmark.frameCount = std::stoi(value);
+    } else if (key == "--warmup-frames") {
+      config.benchmark.warmupFrames = std::stoi(value);
+    } else if (key == "--fixed-dt") {
+      config.benchmark.fixedDt = std::stof(value);
+    } else if (key == "--scene-copies") {
+      config.benchmark.sceneCopies = std::stoi(value);
+    } else if (key == "--stream-bytes") {
+      config.benchmark.streamBytesPerFrame = std::stoul(value);
+    } else if (key == "--benchmark-report") {
+      config.benchmark.reportPath = value;
+    } else {
+      throw std::invalid_argument(
+          "unknown argument: " + arg +
+          "\nusage: [--frames-in-flight=1..4] "
+          "[--present-mode=low-latency|throughput|vsync|immediate] [--print-wait-stats] "
+          "[--headless] [--frames=N] [--capture-frame=N] [--capture-path=file.png] "
+          "[--benchmark] [--camera-path=file] [--benchmark-frames=N] [--warmup-frames=N] "
+          "[--fixed-dt=seconds] [--scene-copies=N] [--stream-bytes=N] "
+          "[--benchmark-report=file.json] [--workers=N] [--parallel-recording] [--pipelined] "
+          "[--cluster-culling] [--lod-error=pixels] [--static-batching] " +
+          PROFILER_USAGE +
+          "[--job-scaling[=transforms]] [--entity-benchmark[=entities]] "
+          "[--transform-benchmark[=transforms]] "
+          "[--hierarchy-benchmark[=nodes]] [--bvh-benchmark[=objects]] "
+          "[--triangle-bvh-benchmark[=triangles]] [--lod-benchmark[=triangles]] "
+          "[--compare-pipelining <options>]");
+    }
+  }
+  // without a window nothing would ever stop a headless run
+  if (config.headless && config.frameCount == 0) {
+    config.frameCount = 300;
+  }
+  return config;
+}
+
+// "benchmark.json" with suffix "serial" becomes "benchmark-serial.json"
+std::string withSuffix(const std::string &path, const std::string &suffix) {
+  const auto extension = path.rfind('.');
+  if (extension == std::string::npos || path.find_first_of("/\\", extension) != std::string::npos) {
+    return path + "-" + suffix;
+  }
+  return path.substr(0, extension) + "-" + suffix + path.substr(extension);
+}
+
+// Runs the benchmark with the serial loop and again with the simulation on its own thread, each
+// writing its own report, and prints the throughput gain of pipelining.
+void comparePipelining(lve::FirstAppConfigInfo config) {
+  config.benchmark.enabled = true;
+  const std::string reportPath = config.benchmark.reportPath;
+  double frameMs[2]{};
+  for (int pipelined = 0; pipelined < 2; pipelined++) {
+    config.pipelinedRendering = pipelined == 1;
+    config.benchmark.reportPath = withSuffix(reportPath, pipelined ? "pipelined" : "serial");
+    lve::FirstApp app{config};
+    app.run();
+    frameMs[pipelined] = app.getBenchmarkFrameMs();
+  }
+
+  if (frameMs[0] <= 0.0 || frameMs[1] <= 0.0) {
+    throw std::runtime_error("no frames measured, nothing to compare");
+  }
+  std::cout << "serial: " << frameMs[0] << " ms (" << 1000.0 / frameMs[0] << " fps)"
+            << " | pipelined: " << frameMs[1] << " ms (" << 1000.0 / frameMs[1] << " fps)"
+            << " | throughput gain: " << (frameMs[0] / frameMs[1] - 1.0) * 100.0 << "%"
+            << std::endl;
+}
+
+int hardwareThreads() {
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// benchmarks that run on their own, given as the only argument with an optional count
+struct StandaloneBenchmark {
+  const char *name;
+  size_t defaultCount;
+  void (*run)(size_t count);
+};
 
-int main() {
-  lve::FirstApp app{};
+const StandaloneBenchmark STANDALONE_BENCHMARKS[] = {
+    {"--job-scaling", 100000,
+     [](size_t count) { lve::runJobScalingBenchmark(count, hardwareThreads()); }},
+    {"--entity-benchmark", 1000000, [](size_t count) { lve::runEntityStorageBenchmark(count); }},
+    {"--transform-benchmark", 100000,
+     [](size_t count) { lve::runTransformBatchBenchmark(count); }},
+    {"--hierarchy-benchmark", 100000,
+     [](size_t count) { lve::runHierarchyBenchmark(count, hardwareThreads()); }},
+    {"--bvh-benchmark", 1000000, [](size_t count) { lve::runBvhBenchmark(count); }},
+    {"--triangle-bvh-benchmark", 1000000,
+     [](size_t count) { lve::runTriangleBvhBenchmark(count, hardwareThreads()); }},
+    {"--lod-benchmark", 100000, [](size_t count) { lve::runMeshLodBenchmark(count); }},
+};
+
+// Runs the benchmark arg names, "--name" or "--name=count", false if it names none. A count
+// that isn't a positive number throws with the benchmark's usage.
+bool runStandaloneBenchmark(const std::string &arg) {
+  const auto separator = arg.find('=');
+  const std::string name = arg.substr(0, separator);
+  for (const StandaloneBenchmark &benchmark : STANDALONE_BENCHMARKS) {
+    if (name != benchmark.name) {
+      continue;
+    }
+    size_t count = benchmark.defaultCount;
+    if (separator != std::string::npos) {
+      const std::string value = arg.substr(separator + 1);
+      const bool digits = !value.empty() &&
+                          std::all_of(value.begin(), value.end(), [](unsigned char c) {
+                            return std::isdigit(c) != 0;
+                          });
+      try {
+        count = digits ? std::stoul(value) : 0;
+      } catch (const std::out_of_range &) {
+        count = 0;
+      }
+      if (count == 0) {
+        throw std::invalid_argument(
+            "invalid count: " + arg + "\nusage: " + name + "[=count], count > 0");
+      }
+    }
+    benchmark.run(count);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef LVE_ENABLE_PROFILER
+  if (argc == 2 && std::string{argv[1]} == "--profiler-overhead") {
+    std::cout << "profiler zone overhead: " << lve::LveProfiler::measureScopeOverheadNs()
+              << " ns\n";
+    return EXIT_SUCCESS;
+  }
+#endif
 
   try {
+    if (argc == 2 && runStandaloneBenchmark(argv[1])) {
+      return EXIT_SUCCESS;
+    }
+    if (argc >= 2 && std::string{argv[1]} == "--compare-pipelining") {
+      comparePipelining(parseArguments(argc - 1, argv + 1));
+      return EXIT_SUCCESS;
+    }
+    lve::FirstApp app{parseArguments(argc, argv)};
     app.run();
   } catch (const std::exception &e) {
     std::cerr << e.what() << '\n';
@@ -17,4 +227,4 @@ int main() {
   }
 
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}